@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Benchmarks of mailz-content over a generated maildir.
+ * Each benchmark runs every letter through one request type and
+ * reports letters and input megabytes per second, along with the
+ * latency percentiles of single requests.
+ *	scan-cold	summaries from a newly started process
+ *	scan-warm	summaries from a process which already read them
+ *	render		letters decoded as by the more command
+ *	reply		reply templates
+ * Run from the top of the tree, after building mailz-content.
+ */
+
+#include <sys/stat.h>
+
+#include <dirent.h>
+#include <err.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../content-proc.h"
+#include "gen.h"
+
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+struct bench {
+	const char *dir;
+	size_t count;
+	uint64_t *lat; /* nanoseconds of each request */
+	size_t nlat;
+	off_t bytes;
+	uint64_t start;
+};
+
+static void bench_begin(struct bench *);
+static void bench_end(struct bench *, const char *);
+static int bench_open(struct bench *, size_t);
+static void bench_render(struct bench *);
+static void bench_reply(struct bench *);
+static void bench_scan(struct bench *, size_t);
+static int lat_cmp(const void *, const void *);
+static int mask_parse(const char *, int *, const char *, const char **,
+	const int *, size_t);
+static uint64_t now(void);
+static void remove_maildir(const char *);
+static void usage(void);
+
+static void
+bench_begin(struct bench *b)
+{
+	b->nlat = 0;
+	b->bytes = 0;
+	b->start = now();
+}
+
+static void
+bench_end(struct bench *b, const char *name)
+{
+	double secs;
+
+	secs = (now() - b->start) / 1e9;
+	qsort(b->lat, b->nlat, sizeof(*b->lat), lat_cmp);
+
+	printf("%-10s %8zu letters %10.0f letters/s %8.2f MB/s "
+	       "p50 %6.0fus p90 %6.0fus p99 %6.0fus max %6.0fus\n",
+	       name, b->nlat, b->nlat / secs, b->bytes / 1e6 / secs,
+	       b->lat[b->nlat * 50 / 100] / 1e3,
+	       b->lat[b->nlat * 90 / 100] / 1e3,
+	       b->lat[b->nlat * 99 / 100] / 1e3,
+	       b->lat[b->nlat - 1] / 1e3);
+}
+
+/*
+ * Open the nth letter, counting its size towards the benchmark.
+ */
+static int
+bench_open(struct bench *b, size_t nth)
+{
+	struct stat sb;
+	char name[NAME_MAX + 1], path[PATH_MAX];
+	int fd, n;
+
+	if (gen_name(name, sizeof(name), nth) == -1)
+		errx(1, "gen_name");
+	n = snprintf(path, sizeof(path), "%s/cur/%s", b->dir, name);
+	if (n < 0 || (size_t)n >= sizeof(path))
+		errx(1, "snprintf overflow");
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		err(1, "%s", path);
+	if (fstat(fd, &sb) == -1)
+		err(1, "%s", path);
+	b->bytes += sb.st_size;
+	return fd;
+}
+
+static void
+bench_render(struct bench *b)
+{
+	struct content_proc pr;
+	size_t i;
+
+	if (content_proc_init(&pr, "./mailz-content") == -1)
+		errx(1, "content_proc_init");
+
+	bench_begin(b);
+	for (i = 0; i < b->count; i++) {
+		struct content_letter lr;
+		uint64_t t;
+		char buf[4];
+		int n;
+
+		t = now();
+		if (content_letter_init(&pr, &lr, bench_open(b, i)) == -1)
+			errx(1, "content_letter_init");
+		while ((n = content_letter_getc(&lr, buf)) > 0)
+			;
+		if (n == -1 || content_letter_finish(&lr) == -1)
+			errx(1, "letter %zu failed to render", i);
+		content_letter_close(&lr);
+		b->lat[b->nlat++] = now() - t;
+	}
+	bench_end(b, "render");
+
+	content_proc_kill(&pr);
+}
+
+static void
+bench_reply(struct bench *b)
+{
+	struct content_proc pr;
+	FILE *out;
+	size_t i;
+
+	if ((out = fopen("/dev/null", "w")) == NULL)
+		err(1, "/dev/null");
+	if (content_proc_init(&pr, "./mailz-content") == -1)
+		errx(1, "content_proc_init");
+
+	bench_begin(b);
+	for (i = 0; i < b->count; i++) {
+		uint64_t t;
+
+		t = now();
+		if (content_proc_reply(&pr, out, "bench@bench.invalid", 1,
+				       bench_open(b, i)) == -1)
+			errx(1, "letter %zu failed to reply", i);
+		b->lat[b->nlat++] = now() - t;
+	}
+	bench_end(b, "reply");
+
+	content_proc_kill(&pr);
+	fclose(out);
+}
+
+/*
+ * Read the summary of every letter once in a new process, then rounds
+ * more times in the same process.
+ */
+static void
+bench_scan(struct bench *b, size_t rounds)
+{
+	struct content_proc pr;
+	size_t i, r;
+
+	bench_begin(b);
+	if (content_proc_init(&pr, "./mailz-content") == -1)
+		errx(1, "content_proc_init");
+	for (i = 0; i < b->count; i++) {
+		struct content_summary sm;
+		uint64_t t;
+
+		t = now();
+		if (content_proc_summary(&pr, &sm, bench_open(b, i),
+					 CNT_SUMMARY_ALL) == -1)
+			errx(1, "letter %zu failed to summarize", i);
+		b->lat[b->nlat++] = now() - t;
+	}
+	bench_end(b, "scan-cold");
+
+	for (r = 0; r < rounds; r++) {
+		bench_begin(b);
+		for (i = 0; i < b->count; i++) {
+			struct content_summary sm;
+			uint64_t t;
+
+			t = now();
+			if (content_proc_summary(&pr, &sm, bench_open(b, i),
+						 CNT_SUMMARY_ALL) == -1)
+				errx(1, "letter %zu failed to summarize", i);
+			b->lat[b->nlat++] = now() - t;
+		}
+		bench_end(b, "scan-warm");
+	}
+
+	content_proc_kill(&pr);
+}
+
+static int
+lat_cmp(const void *one, const void *two)
+{
+	uint64_t n1, n2;
+
+	n1 = *(const uint64_t *)one;
+	n2 = *(const uint64_t *)two;
+
+	if (n1 > n2)
+		return 1;
+	else if (n1 == n2)
+		return 0;
+	else
+		return -1;
+}
+
+/*
+ * Parse a comma separated list of the names in idents into the mask of
+ * their values.
+ */
+static int
+mask_parse(const char *s, int *mask, const char *what,
+	const char **idents, const int *values, size_t n)
+{
+	char *dup, *p, *tok;
+	size_t i;
+
+	if ((dup = strdup(s)) == NULL)
+		err(1, NULL);
+
+	*mask = 0;
+	for (p = dup; (tok = strsep(&p, ",")) != NULL;) {
+		for (i = 0; i < n; i++) {
+			if (!strcmp(tok, idents[i]))
+				break;
+		}
+		if (i == n) {
+			warnx("unknown %s %s", what, tok);
+			free(dup);
+			return -1;
+		}
+		*mask |= values[i];
+	}
+
+	free(dup);
+	return 0;
+}
+
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+		err(1, "clock_gettime");
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Remove a maildir made by gen_maildir.
+ */
+static void
+remove_maildir(const char *dir)
+{
+	static const char *subdirs[] = { "cur", "new", "tmp" };
+	char path[PATH_MAX];
+	size_t i;
+	int n;
+
+	for (i = 0; i < nitems(subdirs); i++) {
+		struct dirent *dp;
+		DIR *d;
+
+		n = snprintf(path, sizeof(path), "%s/%s", dir, subdirs[i]);
+		if (n < 0 || (size_t)n >= sizeof(path))
+			errx(1, "snprintf overflow");
+		if ((d = opendir(path)) == NULL)
+			err(1, "%s", path);
+		while ((dp = readdir(d)) != NULL) {
+			if (dp->d_name[0] == '.')
+				continue;
+			if (unlinkat(dirfd(d), dp->d_name, 0) == -1)
+				err(1, "%s/%s", path, dp->d_name);
+		}
+		closedir(d);
+		if (rmdir(path) == -1)
+			err(1, "%s", path);
+	}
+	if (rmdir(dir) == -1)
+		err(1, "%s", dir);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: bench-run [-c charsets] [-e encodings] "
+	    "[-H headers] [-n count]\n"
+	    "                 [-r rounds] [-s size] [maildir]\n");
+	exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const char *charsets[] = { "ascii", "latin1", "utf8" };
+	static const int charset_masks[] = {
+		GEN_CHARSET_ASCII, GEN_CHARSET_LATIN1, GEN_CHARSET_UTF8,
+	};
+	static const char *encodings[] = { "8bit", "base64", "qp" };
+	static const int encoding_masks[] = {
+		GEN_ENCODING_8BIT, GEN_ENCODING_BASE64, GEN_ENCODING_QP,
+	};
+	struct bench b;
+	struct gen gen;
+	const char *errstr;
+	char tmpdir[] = "/tmp/mailz-bench.XXXXXX";
+	size_t rounds;
+	int ch, keep;
+
+	gen.count = 1000;
+	gen.headers = 4;
+	gen.size = 2000;
+	gen.charsets = GEN_CHARSET_ASCII | GEN_CHARSET_LATIN1 |
+	    GEN_CHARSET_UTF8;
+	gen.encodings = GEN_ENCODING_8BIT | GEN_ENCODING_BASE64 |
+	    GEN_ENCODING_QP;
+	gen.seed = 1;
+	rounds = 3;
+
+	while ((ch = getopt(argc, argv, "c:e:H:n:r:s:")) != -1) {
+		switch (ch) {
+		case 'c':
+			if (mask_parse(optarg, &gen.charsets, "charset",
+				       charsets, charset_masks,
+				       nitems(charsets)) == -1)
+				usage();
+			break;
+		case 'e':
+			if (mask_parse(optarg, &gen.encodings, "encoding",
+				       encodings, encoding_masks,
+				       nitems(encodings)) == -1)
+				usage();
+			break;
+		case 'H':
+			gen.headers = strtonum(optarg, 0, 10000, &errstr);
+			if (errstr != NULL)
+				errx(1, "headers %s: %s", errstr, optarg);
+			break;
+		case 'n':
+			gen.count = strtonum(optarg, 1, 10000000, &errstr);
+			if (errstr != NULL)
+				errx(1, "count %s: %s", errstr, optarg);
+			break;
+		case 'r':
+			rounds = strtonum(optarg, 0, 1000, &errstr);
+			if (errstr != NULL)
+				errx(1, "rounds %s: %s", errstr, optarg);
+			break;
+		case 's':
+			gen.size = strtonum(optarg, 0, 100000000, &errstr);
+			if (errstr != NULL)
+				errx(1, "size %s: %s", errstr, optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc > 1)
+		usage();
+
+	if (setlocale(LC_CTYPE, "C.UTF-8") == NULL)
+		errx(1, "setlocale");
+
+	/* A maildir given by the user is kept for later runs. */
+	if ((keep = argc == 1))
+		b.dir = argv[0];
+	else {
+		if (mkdtemp(tmpdir) == NULL)
+			err(1, "mkdtemp");
+		b.dir = tmpdir;
+	}
+
+	if (gen_maildir(b.dir, &gen) == -1)
+		err(1, "%s", b.dir);
+
+	b.count = gen.count;
+	if ((b.lat = reallocarray(NULL, gen.count,
+				  sizeof(*b.lat))) == NULL)
+		err(1, NULL);
+
+	bench_scan(&b, rounds);
+	bench_render(&b);
+	bench_reply(&b);
+
+	free(b.lat);
+	if (!keep)
+		remove_maildir(b.dir);
+	return 0;
+}
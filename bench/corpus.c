@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Throughput of the header parsers over the fuzzing corpus, which
+ * has a directory of inputs for each fuzz target.
+ * The results of every input can be written to a file of sums and
+ * later runs checked against it, so that a faster parser can be shown
+ * to agree with the one it replaces.
+ */
+
+#include <sys/stat.h>
+
+#include <dirent.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../fuzz/fuzz.h"
+
+struct input {
+	char name[NAME_MAX + 1];
+	uint8_t *data;
+	size_t len;
+};
+
+struct sum {
+	char name[PATH_MAX];
+	uint64_t sum;
+};
+
+struct sums {
+	struct sum *sums;
+	size_t nsum;
+	size_t sumsz;
+};
+
+static int check(const struct sums *, const char *, const struct input *,
+	uint64_t);
+static int input_cmp(const void *, const void *);
+static int load_inputs(int, struct input **, size_t *);
+static int load_sums(const char *, struct sums *);
+static uint64_t now(void);
+static int read_input(int, struct input *);
+static void usage(void);
+
+/*
+ * Compare the sum of the input of target to the one loaded, returning
+ * -1 if they differ or there was none.
+ */
+static int
+check(const struct sums *sums, const char *target, const struct input *in,
+	uint64_t sum)
+{
+	char name[PATH_MAX];
+	size_t i;
+
+	(void)snprintf(name, sizeof(name), "%s/%s", target, in->name);
+	for (i = 0; i < sums->nsum; i++) {
+		if (strcmp(sums->sums[i].name, name) != 0)
+			continue;
+		if (sums->sums[i].sum != sum) {
+			warnx("%s: results differ", name);
+			return -1;
+		}
+		return 0;
+	}
+	warnx("%s: no sum", name);
+	return -1;
+}
+
+static int
+input_cmp(const void *one, const void *two)
+{
+	const struct input *i1, *i2;
+
+	i1 = one;
+	i2 = two;
+	return strcmp(i1->name, i2->name);
+}
+
+/*
+ * Read every file in the directory dfd, which is consumed, sorted by
+ * name.
+ */
+static int
+load_inputs(int dfd, struct input **inputsp, size_t *ninputp)
+{
+	DIR *dir;
+	struct dirent *de;
+	struct input *inputs, *t;
+	size_t ninput, inputsz;
+	int rv;
+
+	if ((dir = fdopendir(dfd)) == NULL) {
+		warn("fdopendir");
+		close(dfd);
+		return -1;
+	}
+
+	rv = -1;
+	inputs = NULL;
+	ninput = 0;
+	inputsz = 0;
+	for (;;) {
+		errno = 0;
+		if ((de = readdir(dir)) == NULL) {
+			if (errno != 0) {
+				warn("readdir");
+				goto inputs;
+			}
+			break;
+		}
+		if (de->d_name[0] == '.')
+			continue;
+
+		if (ninput == inputsz) {
+			if ((t = reallocarray(inputs, inputsz + 64,
+			    sizeof(*inputs))) == NULL) {
+				warn(NULL);
+				goto inputs;
+			}
+			inputs = t;
+			inputsz += 64;
+		}
+
+		strlcpy(inputs[ninput].name, de->d_name,
+			sizeof(inputs[ninput].name));
+		if (read_input(dirfd(dir), &inputs[ninput]) == -1)
+			goto inputs;
+		ninput++;
+	}
+
+	qsort(inputs, ninput, sizeof(*inputs), input_cmp);
+	*inputsp = inputs;
+	*ninputp = ninput;
+	rv = 0;
+	inputs:
+	if (rv == -1) {
+		while (ninput > 0)
+			free(inputs[--ninput].data);
+		free(inputs);
+	}
+	closedir(dir);
+	return rv;
+}
+
+static int
+load_sums(const char *path, struct sums *sums)
+{
+	FILE *fp;
+	struct sum *t;
+	char name[PATH_MAX];
+	unsigned long long sum;
+	int n;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		warn("%s", path);
+		return -1;
+	}
+
+	while ((n = fscanf(fp, "%1023s %llx", name, &sum)) == 2) {
+		if (sums->nsum == sums->sumsz) {
+			if ((t = reallocarray(sums->sums, sums->sumsz + 64,
+			    sizeof(*sums->sums))) == NULL) {
+				warn(NULL);
+				fclose(fp);
+				return -1;
+			}
+			sums->sums = t;
+			sums->sumsz += 64;
+		}
+		strlcpy(sums->sums[sums->nsum].name, name,
+			sizeof(sums->sums[sums->nsum].name));
+		sums->sums[sums->nsum].sum = sum;
+		sums->nsum++;
+	}
+	if (ferror(fp) || n != EOF) {
+		warnx("%s: invalid sums", path);
+		fclose(fp);
+		return -1;
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+		err(1, "clock_gettime");
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int
+read_input(int dfd, struct input *in)
+{
+	struct stat sb;
+	ssize_t n;
+	int fd;
+
+	if ((fd = openat(dfd, in->name, O_RDONLY | O_CLOEXEC)) == -1) {
+		warn("%s", in->name);
+		return -1;
+	}
+	if (fstat(fd, &sb) == -1) {
+		warn("%s", in->name);
+		goto fd;
+	}
+	if ((in->data = malloc(sb.st_size + 1)) == NULL) {
+		warn(NULL);
+		goto fd;
+	}
+
+	in->len = 0;
+	while ((n = read(fd, in->data + in->len,
+	    sb.st_size + 1 - in->len)) > 0)
+		in->len += n;
+	if (n == -1) {
+		warn("%s", in->name);
+		free(in->data);
+		goto fd;
+	}
+
+	close(fd);
+	return 0;
+
+	fd:
+	close(fd);
+	return -1;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: bench-corpus [-c sums | -w sums] "
+	    "[-r rounds] corpus\n");
+	exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct dirent **targets;
+	struct sums sums;
+	FILE *save;
+	const char *errstr, *load, *store;
+	size_t rounds;
+	int ch, cfd, failed, i, ntarget;
+
+	load = NULL;
+	store = NULL;
+	rounds = 20;
+
+	while ((ch = getopt(argc, argv, "c:r:w:")) != -1) {
+		switch (ch) {
+		case 'c':
+			load = optarg;
+			break;
+		case 'r':
+			rounds = strtonum(optarg, 1, 100000, &errstr);
+			if (errstr != NULL)
+				errx(1, "rounds %s: %s", errstr, optarg);
+			break;
+		case 'w':
+			store = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc != 1 || (load != NULL && store != NULL))
+		usage();
+
+	if (setlocale(LC_CTYPE, "C.UTF-8") == NULL)
+		errx(1, "setlocale");
+
+	memset(&sums, 0, sizeof(sums));
+	if (load != NULL && load_sums(load, &sums) == -1)
+		return 1;
+
+	save = NULL;
+	if (store != NULL && (save = fopen(store, "w")) == NULL)
+		err(1, "%s", store);
+
+	if ((cfd = open(argv[0], O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+		err(1, "%s", argv[0]);
+	if ((ntarget = scandir(argv[0], &targets, NULL, alphasort)) == -1)
+		err(1, "%s", argv[0]);
+
+	failed = 0;
+	for (i = 0; i < ntarget; i++) {
+		const struct fuzz_target *target;
+		struct input *inputs;
+		uint64_t best, t;
+		size_t bytes, j, ninput, r;
+		int dfd;
+
+		if (targets[i]->d_name[0] == '.')
+			continue;
+		if ((target = fuzz_target(targets[i]->d_name)) == NULL)
+			errx(1, "%s: unknown target", targets[i]->d_name);
+
+		if ((dfd = openat(cfd, target->name,
+		    O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+			err(1, "%s/%s", argv[0], target->name);
+		if (load_inputs(dfd, &inputs, &ninput) == -1)
+			return 1;
+
+		bytes = 0;
+		for (j = 0; j < ninput; j++) {
+			uint64_t sum;
+
+			bytes += inputs[j].len;
+
+			sum = FUZZ_SUM_INIT;
+			target->fn(inputs[j].data, inputs[j].len, &sum);
+			if (save != NULL)
+				fprintf(save, "%s/%s %016llx\n", target->name,
+				    inputs[j].name, (unsigned long long)sum);
+			if (load != NULL &&
+			    check(&sums, target->name, &inputs[j], sum) == -1)
+				failed = 1;
+		}
+
+		best = UINT64_MAX;
+		for (r = 0; r < rounds; r++) {
+			t = now();
+			for (j = 0; j < ninput; j++)
+				target->fn(inputs[j].data, inputs[j].len, NULL);
+			t = now() - t;
+			if (t < best)
+				best = t;
+		}
+		if (best == 0)
+			best = 1;
+
+		printf("%-18s %6zu inputs %9.1f MB/s %11.0f inputs/s\n",
+		    target->name, ninput, bytes / 1e6 / (best / 1e9),
+		    ninput / (best / 1e9));
+
+		for (j = 0; j < ninput; j++)
+			free(inputs[j].data);
+		free(inputs);
+	}
+
+	for (i = 0; i < ntarget; i++)
+		free(targets[i]);
+	free(targets);
+	close(cfd);
+	free(sums.sums);
+	if (save != NULL && fclose(save) == EOF)
+		err(1, "%s", store);
+	return failed;
+}
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Throughput of the transfer encoding and charset decoders, reading
+ * generated text from memory through charset_getc as mailz-content
+ * does when rendering a letter.
+ * Each pair of encoding and charset is timed over several rounds and
+ * the fastest is kept. Results can be written to a baseline file and
+ * later runs compared against it, failing if any pair got slower by
+ * more than the tolerance.
+ */
+
+#include <err.h>
+#include <locale.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../charset.h"
+#include "../encoding.h"
+#include "gen.h"
+
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+#define DECODE_NAME_MAX 32
+
+static const struct {
+	const char *name;
+	enum encoding_type type;
+	int gen;
+} encodings[] = {
+	{ "7bit",	ENCODING_7BIT,		GEN_ENCODING_8BIT },
+	{ "8bit",	ENCODING_8BIT,		GEN_ENCODING_8BIT },
+	{ "binary",	ENCODING_BINARY,	GEN_ENCODING_8BIT },
+	{ "base64",	ENCODING_BASE64,	GEN_ENCODING_BASE64 },
+	{ "qp",		ENCODING_QP,		GEN_ENCODING_QP },
+};
+
+static const struct {
+	const char *name;
+	enum charset_type type;
+	int gen; /* the text decoded */
+} charsets[] = {
+	{ "ascii",	CHARSET_ASCII,		GEN_CHARSET_ASCII },
+	{ "latin1",	CHARSET_ISO_8859_1,	GEN_CHARSET_LATIN1 },
+	{ "utf8",	CHARSET_UTF8,		GEN_CHARSET_UTF8 },
+	{ "other",	CHARSET_OTHER,		GEN_CHARSET_LATIN1 },
+};
+
+struct baseline {
+	char name[DECODE_NAME_MAX];
+	double mbs;
+};
+
+static int baseline_load(const char *, struct baseline *, size_t *);
+static double decode(char *, size_t, size_t, enum encoding_type,
+	enum charset_type);
+static uint64_t now(void);
+static void usage(void);
+
+/*
+ * Read the results in path into base, which has room for one result
+ * for each pair.
+ */
+static int
+baseline_load(const char *path, struct baseline *base, size_t *nbase)
+{
+	FILE *fp;
+	char name[DECODE_NAME_MAX];
+	double mbs;
+	int n;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		warn("%s", path);
+		return -1;
+	}
+
+	*nbase = 0;
+	while ((n = fscanf(fp, "%31s %lf", name, &mbs)) == 2) {
+		if (*nbase == nitems(encodings) * nitems(charsets))
+			break;
+		strlcpy(base[*nbase].name, name, sizeof(base[*nbase].name));
+		base[*nbase].mbs = mbs;
+		(*nbase)++;
+	}
+	if (ferror(fp) || (n != EOF && n != 2)) {
+		warnx("%s: invalid baseline", path);
+		fclose(fp);
+		return -1;
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+/*
+ * Decode the len bytes of buf rounds times, returning the best
+ * throughput in megabytes of input per second.
+ */
+static double
+decode(char *buf, size_t len, size_t rounds, enum encoding_type encoding,
+	enum charset_type charset)
+{
+	uint64_t best;
+	size_t r;
+
+	best = UINT64_MAX;
+	for (r = 0; r < rounds; r++) {
+		struct charset cs;
+		struct encoding e;
+		FILE *fp;
+		uint64_t t;
+		char out[4];
+		int n;
+
+		if ((fp = fmemopen(buf, len, "r")) == NULL)
+			err(1, "fmemopen");
+		encoding_from_type(&e, encoding);
+		charset_from_type(&cs, charset);
+
+		t = now();
+		while ((n = charset_getc(&cs, &e, fp, out)) > 0)
+			;
+		t = now() - t;
+		if (n == -1)
+			errx(1, "decoding failed");
+
+		fclose(fp);
+		if (t < best)
+			best = t;
+	}
+
+	if (best == 0)
+		best = 1;
+	return len / 1e6 / (best / 1e9);
+}
+
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+		err(1, "clock_gettime");
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: bench-decode [-b baseline | -w baseline] "
+	    "[-n size] [-r rounds]\n"
+	    "                    [-t tolerance]\n");
+	exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct baseline base[nitems(encodings) * nitems(charsets)];
+	FILE *save;
+	const char *errstr, *load, *store;
+	char *text;
+	size_t e, i, nbase, rounds, size;
+	uint32_t state;
+	int ch, failed, tolerance;
+
+	load = NULL;
+	store = NULL;
+	size = 4 * 1024 * 1024;
+	rounds = 5;
+	tolerance = 20;
+
+	while ((ch = getopt(argc, argv, "b:n:r:t:w:")) != -1) {
+		switch (ch) {
+		case 'b':
+			load = optarg;
+			break;
+		case 'n':
+			size = strtonum(optarg, 2, 1024 * 1024 * 1024, &errstr);
+			if (errstr != NULL)
+				errx(1, "size %s: %s", errstr, optarg);
+			break;
+		case 'r':
+			rounds = strtonum(optarg, 1, 1000, &errstr);
+			if (errstr != NULL)
+				errx(1, "rounds %s: %s", errstr, optarg);
+			break;
+		case 't':
+			tolerance = strtonum(optarg, 0, 100, &errstr);
+			if (errstr != NULL)
+				errx(1, "tolerance %s: %s", errstr, optarg);
+			break;
+		case 'w':
+			store = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (argc != optind || (load != NULL && store != NULL))
+		usage();
+
+	if (setlocale(LC_CTYPE, "C.UTF-8") == NULL)
+		errx(1, "setlocale");
+
+	nbase = 0;
+	if (load != NULL && baseline_load(load, base, &nbase) == -1)
+		return 1;
+
+	save = NULL;
+	if (store != NULL && (save = fopen(store, "w")) == NULL)
+		err(1, "%s", store);
+
+	if ((text = malloc(size)) == NULL)
+		err(1, NULL);
+
+	failed = 0;
+	for (e = 0; e < nitems(encodings); e++) {
+		for (i = 0; i < nitems(charsets); i++) {
+			FILE *fp;
+			char *buf, name[DECODE_NAME_MAX];
+			size_t bufsz, len, j;
+			double mbs;
+			int gen;
+
+			/* 7bit cannot carry anything but ASCII. */
+			gen = charsets[i].gen;
+			if (encodings[e].type == ENCODING_7BIT)
+				gen = GEN_CHARSET_ASCII;
+
+			state = 1;
+			len = gen_text(text, size, &state, gen);
+
+			if ((fp = open_memstream(&buf, &bufsz)) == NULL)
+				err(1, "open_memstream");
+			gen_encode(fp, encodings[e].gen, text, len);
+			if (fclose(fp) == EOF)
+				err(1, "open_memstream");
+
+			mbs = decode(buf, bufsz, rounds, encodings[e].type,
+				     charsets[i].type);
+			free(buf);
+
+			(void)snprintf(name, sizeof(name), "%s-%s",
+			    encodings[e].name, charsets[i].name);
+			printf("%-16s %9.1f MB/s %7.3f ns/byte\n", name, mbs,
+			       1e3 / mbs);
+			if (save != NULL)
+				fprintf(save, "%s %.1f\n", name, mbs);
+
+			for (j = 0; j < nbase; j++) {
+				if (strcmp(base[j].name, name) != 0)
+					continue;
+				if (mbs < base[j].mbs * (100 - tolerance) / 100) {
+					warnx("%s: %.1f MB/s is more than %d%% "
+					      "below the baseline %.1f MB/s",
+					      name, mbs, tolerance,
+					      base[j].mbs);
+					failed = 1;
+				}
+			}
+		}
+	}
+
+	free(text);
+	if (save != NULL && fclose(save) == EOF)
+		err(1, "%s", store);
+	return failed;
+}
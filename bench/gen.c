@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Generator of synthetic maildirs for the benchmarks.
+ * Letters cycle through the enabled charsets and transfer encodings,
+ * and every third letter is a reply to the one before it, so that the
+ * same options always generate the same maildir.
+ */
+
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gen.h"
+
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+#define GEN_DATE 1700000000
+
+static const struct {
+	int charset;
+	const char *name;
+	const char *word; /* a word outside ASCII, in this charset */
+} charsets[] = {
+	{ GEN_CHARSET_ASCII,	"us-ascii",	"cafe" },
+	{ GEN_CHARSET_LATIN1,	"iso-8859-1",	"caf\xe9" },
+	{ GEN_CHARSET_UTF8,	"utf-8",	"caf\xc3\xa9" },
+};
+
+static const int encodings[] = {
+	GEN_ENCODING_8BIT,
+	GEN_ENCODING_BASE64,
+	GEN_ENCODING_QP,
+};
+
+static const char *words[] = {
+	"archive", "benchmark", "boundary", "decode", "folder", "header",
+	"letter", "mailbox", "message", "quoted", "reply", "sender",
+	"summary", "thread",
+};
+
+static void gen_base64(FILE *, const char *, size_t);
+static int gen_letter(FILE *, const struct gen *, size_t, uint32_t *);
+static void gen_qp(FILE *, const char *, size_t);
+
+static void
+gen_base64(FILE *fp, const char *s, size_t len)
+{
+	static const char b64[] =
+	    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	size_t col, i;
+
+	col = 0;
+	for (i = 0; i < len; i += 3) {
+		uint32_t v;
+		size_t n;
+
+		n = len - i < 3 ? len - i : 3;
+		v = (unsigned char)s[i] << 16;
+		if (n > 1)
+			v |= (unsigned char)s[i + 1] << 8;
+		if (n > 2)
+			v |= (unsigned char)s[i + 2];
+
+		putc(b64[(v >> 18) & 0x3f], fp);
+		putc(b64[(v >> 12) & 0x3f], fp);
+		putc(n > 1 ? b64[(v >> 6) & 0x3f] : '=', fp);
+		putc(n > 2 ? b64[v & 0x3f] : '=', fp);
+
+		if ((col += 4) == 76) {
+			putc('\n', fp);
+			col = 0;
+		}
+	}
+	if (col != 0)
+		putc('\n', fp);
+}
+
+/*
+ * Write the len bytes of s to fp in encoding, one of GEN_ENCODING_*.
+ */
+void
+gen_encode(FILE *fp, int encoding, const char *s, size_t len)
+{
+	switch (encoding) {
+	case GEN_ENCODING_BASE64:
+		gen_base64(fp, s, len);
+		break;
+	case GEN_ENCODING_QP:
+		gen_qp(fp, s, len);
+		break;
+	default:
+		fwrite(s, len, 1, fp);
+		break;
+	}
+}
+
+static int
+gen_letter(FILE *fp, const struct gen *gen, size_t nth, uint32_t *state)
+{
+	struct tm tm;
+	time_t date;
+	char *body, datestr[64];
+	const char *cte;
+	size_t i, len, ncharset, nencoding;
+	int charset, encoding, n;
+
+	/* Cycle through every pair of enabled charset and encoding. */
+	for (i = 0, ncharset = 0; i < nitems(charsets); i++)
+		ncharset += (gen->charsets & charsets[i].charset) != 0;
+	for (i = 0, nencoding = 0; i < nitems(encodings); i++)
+		nencoding += (gen->encodings & encodings[i]) != 0;
+	if (ncharset == 0 || nencoding == 0)
+		return -1;
+
+	n = nth % ncharset;
+	for (charset = 0; charset < (int)nitems(charsets); charset++) {
+		if ((gen->charsets & charsets[charset].charset) && n-- == 0)
+			break;
+	}
+	n = nth / ncharset % nencoding;
+	for (encoding = 0; encoding < (int)nitems(encodings); encoding++) {
+		if ((gen->encodings & encodings[encoding]) && n-- == 0)
+			break;
+	}
+
+	date = GEN_DATE + nth * 60;
+	if (gmtime_r(&date, &tm) == NULL)
+		return -1;
+	if (strftime(datestr, sizeof(datestr),
+		     "%a, %d %b %Y %H:%M:%S +0000", &tm) == 0)
+		return -1;
+
+	for (i = 0; i < gen->headers; i++) {
+		fprintf(fp, "Received: from relay%zu.bench.invalid "
+			"(relay%zu.bench.invalid [192.0.2.%zu])\n"
+			"\tby mx.bench.invalid with ESMTP id %08x;\n"
+			"\t%s\n", i, i, i % 256,
+			(unsigned int)gen_rand(state), datestr);
+	}
+
+	fprintf(fp, "Date: %s\n", datestr);
+	n = gen_rand(state) % 100;
+	fprintf(fp, "From: User %d <user%d@bench.invalid>\n", n, n);
+	fprintf(fp, "To: list@bench.invalid\n");
+	fprintf(fp, "Subject: %sbench letter %zu %s\n",
+		nth % 3 != 0 ? "Re: " : "", nth - nth % 3,
+		words[nth % nitems(words)]);
+	fprintf(fp, "Message-ID: <%zu@bench.invalid>\n", nth);
+	if (nth % 3 != 0)
+		fprintf(fp, "In-Reply-To: <%zu@bench.invalid>\n", nth - 1);
+	fprintf(fp, "MIME-Version: 1.0\n");
+	fprintf(fp, "Content-Type: text/plain; charset=%s\n",
+		charsets[charset].name);
+
+	switch (encodings[encoding]) {
+	case GEN_ENCODING_BASE64:
+		cte = "base64";
+		break;
+	case GEN_ENCODING_QP:
+		cte = "quoted-printable";
+		break;
+	default:
+		cte = charsets[charset].charset == GEN_CHARSET_ASCII
+		    ? "7bit" : "8bit";
+		break;
+	}
+	fprintf(fp, "Content-Transfer-Encoding: %s\n\n", cte);
+
+	if ((body = malloc(gen->size + 2)) == NULL)
+		return -1;
+	len = gen_text(body, gen->size + 2, state, charsets[charset].charset);
+	gen_encode(fp, encodings[encoding], body, len);
+
+	free(body);
+	return ferror(fp) ? -1 : 0;
+}
+
+/*
+ * Create the maildir dir and fill its cur directory with the letters
+ * described by gen, named by gen_name.
+ * Returns 0 on success, returns -1 and sets errno on failure.
+ */
+int
+gen_maildir(const char *dir, const struct gen *gen)
+{
+	static const char *subdirs[] = { "cur", "new", "tmp" };
+	char path[PATH_MAX];
+	size_t i;
+	uint32_t state;
+	int n;
+
+	if (mkdir(dir, 0700) == -1 && errno != EEXIST)
+		return -1;
+	for (i = 0; i < nitems(subdirs); i++) {
+		n = snprintf(path, sizeof(path), "%s/%s", dir, subdirs[i]);
+		if (n < 0 || (size_t)n >= sizeof(path)) {
+			errno = ENAMETOOLONG;
+			return -1;
+		}
+		if (mkdir(path, 0700) == -1 && errno != EEXIST)
+			return -1;
+	}
+
+	state = gen->seed != 0 ? gen->seed : 1;
+	for (i = 0; i < gen->count; i++) {
+		FILE *fp;
+		char name[NAME_MAX + 1];
+
+		if (gen_name(name, sizeof(name), i) == -1) {
+			errno = ENAMETOOLONG;
+			return -1;
+		}
+		n = snprintf(path, sizeof(path), "%s/cur/%s", dir, name);
+		if (n < 0 || (size_t)n >= sizeof(path)) {
+			errno = ENAMETOOLONG;
+			return -1;
+		}
+
+		if ((fp = fopen(path, "w")) == NULL)
+			return -1;
+		if (gen_letter(fp, gen, i, &state) == -1) {
+			fclose(fp);
+			errno = EINVAL;
+			return -1;
+		}
+		if (fclose(fp) == EOF)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Write the file name of the nth generated letter to buf.
+ * Returns 0 on success and -1 if buf is too small.
+ */
+int
+gen_name(char *buf, size_t bufsz, size_t nth)
+{
+	int n;
+
+	n = snprintf(buf, bufsz, "%zu.bench:2,%s", nth, nth % 2 ? "S" : "");
+	if (n < 0 || (size_t)n >= bufsz)
+		return -1;
+	return 0;
+}
+
+static void
+gen_qp(FILE *fp, const char *s, size_t len)
+{
+	size_t col, i;
+
+	col = 0;
+	for (i = 0; i < len; i++) {
+		unsigned char ch;
+
+		ch = s[i];
+		if (ch == '\n') {
+			putc('\n', fp);
+			col = 0;
+			continue;
+		}
+
+		if (col >= 72) {
+			fputs("=\n", fp);
+			col = 0;
+		}
+		if (ch == '=' || ch < ' ' || ch > '~') {
+			fprintf(fp, "=%02X", ch);
+			col += 3;
+		}
+		else {
+			putc(ch, fp);
+			col++;
+		}
+	}
+}
+
+/*
+ * The xorshift32 generator, so that letters are the same on every
+ * system.
+ */
+uint32_t
+gen_rand(uint32_t *state)
+{
+	uint32_t x;
+
+	x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/*
+ * Fill buf with lines of words ending in a newline, one in eight of
+ * them being outside ASCII in charset, one of GEN_CHARSET_*.
+ * bufsz must be at least 2.
+ * Returns the length of the text.
+ */
+size_t
+gen_text(char *buf, size_t bufsz, uint32_t *state, int charset)
+{
+	const char *word;
+	size_t col, i, len, n;
+
+	word = charsets[0].word;
+	for (i = 0; i < nitems(charsets); i++) {
+		if (charsets[i].charset == charset)
+			word = charsets[i].word;
+	}
+
+	n = 0;
+	col = 0;
+	for (;;) {
+		const char *w;
+
+		if (gen_rand(state) % 8 == 0)
+			w = word;
+		else
+			w = words[gen_rand(state) % nitems(words)];
+		len = strlen(w);
+
+		/* Leave room for the separator and the final newline. */
+		if (n + len + 2 >= bufsz)
+			break;
+
+		if (col != 0 && col + len + 1 > 72) {
+			buf[n++] = '\n';
+			col = 0;
+		}
+		else if (col != 0) {
+			buf[n++] = ' ';
+			col++;
+		}
+		memcpy(&buf[n], w, len);
+		n += len;
+		col += len;
+	}
+	buf[n++] = '\n';
+	return n;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef BENCH_GEN_H
+#define BENCH_GEN_H
+
+#define GEN_CHARSET_ASCII 0x1
+#define GEN_CHARSET_LATIN1 0x2
+#define GEN_CHARSET_UTF8 0x4
+
+#define GEN_ENCODING_8BIT 0x1 /* 7bit for ASCII letters */
+#define GEN_ENCODING_BASE64 0x2
+#define GEN_ENCODING_QP 0x4
+
+struct gen {
+	size_t count;
+	size_t headers; /* Received headers added to each letter */
+	size_t size; /* approximate body size in bytes */
+	int charsets;
+	int encodings;
+	uint32_t seed;
+};
+
+void gen_encode(FILE *, int, const char *, size_t);
+int gen_maildir(const char *, const struct gen *);
+int gen_name(char *, size_t, size_t);
+uint32_t gen_rand(uint32_t *);
+size_t gen_text(char *, size_t, uint32_t *, int);
+
+#endif /* BENCH_GEN_H */
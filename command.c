@@ -17,6 +17,7 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "command.h"
 
@@ -27,13 +28,25 @@ command_init(struct command_lexer *lex, FILE *fp)
 	lex->fp = fp;
 }
 
+/*
+ * Read the next letter selector from the current line.
+ * A selector is one of:
+ *	N	the letter numbered N
+ *	N-M	the letters numbered N through M
+ *	N-	the letters numbered N through the last letter
+ *	*	every letter
+ *	%	the letters found by the last filter command
+ *	:F	letters with the maildir flag F set
+ *	:!F	letters without the maildir flag F set
+ *	/text	letters whose subject contains text
+ * optionally prefixed with 't' to select the threads of those letters.
+ */
 int
 command_letter(struct command_lexer *lex, struct command_letter *lp)
 {
 	size_t n;
-	long long num;
 	int thread;
-	char buf[21];
+	char buf[COMMAND_SUBJECT_LEN + 1], *dash;
 	const char *errstr;
 
 	if (lex->eol)
@@ -53,8 +66,11 @@ command_letter(struct command_lexer *lex, struct command_letter *lp)
 			break;
 		}
 
-		if ((ch == ' ' || ch == '\t') && n != 0)
-			break;
+		if (ch == ' ' || ch == '\t') {
+			if (n != 0)
+				break;
+			continue;
+		}
 		if (ch == '\n') {
 			lex->eol = 1;
 			if (n == 0) {
@@ -65,7 +81,7 @@ command_letter(struct command_lexer *lex, struct command_letter *lp)
 			break;
 		}
 
-		if (ch == 't' && n == 0) {
+		if (ch == 't' && n == 0 && !thread) {
 			thread = 1;
 			continue;
 		}
@@ -79,12 +95,71 @@ command_letter(struct command_lexer *lex, struct command_letter *lp)
 		return COMMAND_LONG;
 	buf[n] = '\0';
 
-	num = strtonum(buf, 1, LLONG_MAX, &errstr);
+	lp->thread = thread;
+	lp->num = 0;
+	lp->end = 0;
+	lp->flag = '\0';
+	lp->negate = 0;
+	lp->subject[0] = '\0';
+
+	if (!strcmp(buf, "*")) {
+		lp->type = COMMAND_LETTER_ALL;
+		return COMMAND_OK;
+	}
+
+	if (!strcmp(buf, "%")) {
+		lp->type = COMMAND_LETTER_RESULT;
+		return COMMAND_OK;
+	}
+
+	if (buf[0] == ':') {
+		const char *f;
+
+		f = &buf[1];
+		if (*f == '!') {
+			lp->negate = 1;
+			f++;
+		}
+		if (f[0] < 33 || f[0] > 126 || f[1] != '\0')
+			return COMMAND_INVALID;
+
+		lp->type = COMMAND_LETTER_FLAG;
+		lp->flag = f[0];
+		return COMMAND_OK;
+	}
+
+	if (buf[0] == '/') {
+		if (buf[1] == '\0')
+			return COMMAND_INVALID;
+		if (strlcpy(lp->subject, &buf[1], sizeof(lp->subject))
+			    >= sizeof(lp->subject))
+			return COMMAND_LONG;
+		lp->type = COMMAND_LETTER_SUBJECT;
+		return COMMAND_OK;
+	}
+
+	if ((dash = strchr(buf, '-')) != NULL) {
+		*dash++ = '\0';
+
+		lp->num = strtonum(buf, 1, LLONG_MAX, &errstr);
+		if (errstr != NULL)
+			return COMMAND_INVALID;
+
+		if (*dash != '\0') {
+			lp->end = strtonum(dash, lp->num, LLONG_MAX, &errstr);
+			if (errstr != NULL)
+				return COMMAND_INVALID;
+		}
+
+		lp->type = COMMAND_LETTER_RANGE;
+		return COMMAND_OK;
+	}
+
+	lp->num = strtonum(buf, 1, LLONG_MAX, &errstr);
 	if (errstr != NULL)
 		return COMMAND_INVALID;
 
-	lp->num = num;
-	lp->thread = thread;
+	lp->type = COMMAND_LETTER_NUM;
 	return COMMAND_OK;
 }
 
@@ -115,8 +190,11 @@ command_name(struct command_lexer *lex, char *buf, size_t bufsz)
 			break;
 		}
 
-		if ((ch == ' ' || ch == '\t') && n != 0)
+		if (ch == ' ' || ch == '\t') {
+			if (n == 0)
+				continue;
 			break;
+		}
 		if (ch == '\n') {
 			lex->eol = 1;
 			if (n == 0)
@@ -134,3 +212,88 @@ command_name(struct command_lexer *lex, char *buf, size_t bufsz)
 	buf[n] = '\0';
 	return COMMAND_OK;
 }
+
+/*
+ * Read the rest of the current line as free form text, with leading
+ * and trailing space and tab characters removed.
+ */
+int
+command_text(struct command_lexer *lex, char *buf, size_t bufsz)
+{
+	size_t n;
+	int toolong;
+
+	if (lex->eol)
+		return COMMAND_EOF;
+
+	n = 0;
+	toolong = 0;
+	for (;;) {
+		int ch;
+
+		if ((ch = fgetc(lex->fp)) == EOF)
+			break;
+		if (ch == '\n') {
+			lex->eol = 1;
+			break;
+		}
+
+		if (n == 0 && (ch == ' ' || ch == '\t'))
+			continue;
+
+		if (n + 1 >= bufsz) {
+			toolong = 1;
+			continue;
+		}
+		buf[n++] = ch;
+	}
+
+	if (toolong)
+		return COMMAND_LONG;
+
+	while (n != 0 && (buf[n - 1] == ' ' || buf[n - 1] == '\t'))
+		n--;
+	if (n == 0)
+		return COMMAND_EOF;
+	buf[n] = '\0';
+	return COMMAND_OK;
+}
+
+/*
+ * Read the next word of the current line, a run of characters other
+ * than space and tab.
+ */
+int
+command_word(struct command_lexer *lex, char *buf, size_t bufsz)
+{
+	size_t n;
+
+	if (lex->eol)
+		return COMMAND_EOF;
+
+	n = 0;
+	for (;;) {
+		int ch;
+
+		if ((ch = fgetc(lex->fp)) == EOF)
+			break;
+		if (ch == ' ' || ch == '\t') {
+			if (n != 0)
+				break;
+			continue;
+		}
+		if (ch == '\n') {
+			lex->eol = 1;
+			break;
+		}
+
+		if (n + 1 >= bufsz)
+			return COMMAND_LONG;
+		buf[n++] = ch;
+	}
+
+	if (n == 0)
+		return COMMAND_EOF;
+	buf[n] = '\0';
+	return COMMAND_OK;
+}
@@ -26,9 +26,29 @@ enum {
 	COMMAND_THREAD_EOF,
 };
 
+/*
+ * Longest subject text accepted by a '/' selector, including the
+ * terminating NUL byte.
+ */
+#define COMMAND_SUBJECT_LEN 256
+
+enum command_letter_type {
+	COMMAND_LETTER_ALL,
+	COMMAND_LETTER_FLAG,
+	COMMAND_LETTER_NUM,
+	COMMAND_LETTER_RANGE,
+	COMMAND_LETTER_RESULT,
+	COMMAND_LETTER_SUBJECT,
+};
+
 struct command_letter {
+	enum command_letter_type type;
 	size_t num;
+	size_t end; /* 0 for an open range */
+	int flag;
+	int negate;
 	int thread;
+	char subject[COMMAND_SUBJECT_LEN];
 };
 
 struct command_lexer {
@@ -39,5 +59,7 @@ struct command_lexer {
 void command_init(struct command_lexer *, FILE *);
 int command_letter(struct command_lexer *, struct command_letter *);
 int command_name(struct command_lexer *, char *, size_t);
+int command_text(struct command_lexer *, char *, size_t);
+int command_word(struct command_lexer *, char *, size_t);
 
 #endif /* COMMAND_H */
@@ -36,9 +36,16 @@ struct mailz_conf {
 		int type;
 	} ignore;
 	RB_HEAD(mailz_conf_mailboxes, mailz_conf_mailbox) mailboxes;
+	struct mailz_summary {
+		char **fields;
+		size_t nfield;
+	} summary;
+	char *template;
 };
 
 struct mailz_conf_mailbox *mailz_conf_mailbox(struct mailz_conf *, char *);
+struct mailz_conf_mailbox *mailz_conf_mailbox_next(struct mailz_conf *,
+						   struct mailz_conf_mailbox *);
 void mailz_conf_free(struct mailz_conf *);
 int mailz_conf_init(struct mailz_conf *);
 
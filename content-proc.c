@@ -31,6 +31,7 @@
 #include "content.h"
 #include "content-proc.h"
 #include "err-fork.h"
+#include "ignore.h"
 #include "imsg-blocking.h"
 #include "printable.h"
 
@@ -133,37 +134,140 @@ content_letter_init(struct content_proc *pr,
 	return -1;
 }
 
+/*
+ * Set the pattern matched by later grep requests.
+ * If fixed is set the pattern is a plain string, otherwise it is an
+ * extended regular expression.
+ */
 int
-content_proc_ignore(struct content_proc *pr, const char *s, int type)
+content_proc_grep_pattern(struct content_proc *pr, const char *pattern,
+			  int fixed)
 {
-	struct content_header hdr;
-	uint32_t msg_type;
+	struct content_pattern cp;
 
-	switch (type) {
-	case CNT_IGNORE_IGNORE:
-		msg_type = IMSG_CNT_IGNORE;
-		break;
-	case CNT_IGNORE_RETAIN:
-		msg_type = IMSG_CNT_RETAIN;
-		break;
-	default:
+	memset(&cp, 0, sizeof(cp));
+	if (strlcpy(cp.pattern, pattern, sizeof(cp.pattern))
+		    >= sizeof(cp.pattern))
 		return -1;
-	}
+	cp.fixed = fixed;
 
-	memset(&hdr, 0, sizeof(hdr));
-	if (strlcpy(hdr.name, s, sizeof(hdr.name)) >= sizeof(hdr.name))
+	if (imsg_compose(&pr->msgbuf, IMSG_CNT_PATTERN, 0, -1, -1,
+			 &cp, sizeof(cp)) == -1)
 		return -1;
 
-	if (imsg_compose(&pr->msgbuf, msg_type, 0, -1, -1,
-			 &hdr, sizeof(hdr)) == -1)
+	if (imsgbuf_flush(&pr->msgbuf) == -1)
 		return -1;
 
-	if (imsgbuf_flush(&pr->msgbuf) == -1)
+	return 0;
+}
+
+/*
+ * Read whatever replies mailz-content has sent, for use once
+ * poll(2) reports its socket as readable.
+ * Returns -1 on failure or if mailz-content has exited.
+ */
+int
+content_proc_grep_read(struct content_proc *pr)
+{
+	if (imsgbuf_read(&pr->msgbuf) != 1)
 		return -1;
+	return 0;
+}
 
+/*
+ * Take the reply to the oldest outstanding grep request out of those
+ * already read by content_proc_grep_read, without blocking.
+ * Returns 1 and sets *match if there was one, 0 if there was not,
+ * and -1 on failure.
+ */
+int
+content_proc_grep_recv(struct content_proc *pr, int *match)
+{
+	struct content_grep cg;
+	struct imsg msg;
+	int n, rv;
+
+	if ((n = imsgbuf_get(&pr->msgbuf, &msg)) <= 0)
+		return n;
+
+	rv = -1;
+
+	if (imsg_get_type(&msg) != IMSG_CNT_GREP)
+		goto msg;
+	if (imsg_get_data(&msg, &cg, sizeof(cg)) == -1)
+		goto msg;
+	if (cg.match < -1 || cg.match > 1)
+		goto msg;
+
+	*match = cg.match;
+	rv = 1;
+	msg:
+	imsg_free(&msg);
+	return rv;
+}
+
+/*
+ * Queue a grep request for fd without waiting for the reply.
+ * The fd is always consumed.
+ */
+int
+content_proc_grep_send(struct content_proc *pr, int fd)
+{
+	if (imsg_compose(&pr->msgbuf, IMSG_CNT_GREP, 0, -1, fd,
+			 NULL, 0) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	if (imsgbuf_flush(&pr->msgbuf) == -1)
+		return -1;
 	return 0;
 }
 
+/*
+ * Send the compiled ignore set, written to a pipe so its size is not
+ * limited by that of an imsg.
+ */
+int
+content_proc_ignore(struct content_proc *pr, const struct ignore *ignore)
+{
+	struct content_ignore ci;
+	const char *buf;
+	size_t off;
+	ssize_t n;
+	int p[2], rv;
+
+	if (ignore->bufsz == 0)
+		return 0;
+	if (ignore->bufsz > IGNORE_SET_MAX)
+		return -1;
+
+	if (pipe2(p, O_CLOEXEC) == -1)
+		return -1;
+
+	ci.size = ignore->bufsz;
+	if (imsg_compose(&pr->msgbuf, IMSG_CNT_IGNORE, 0, -1, p[0],
+			 &ci, sizeof(ci)) == -1) {
+		close(p[0]);
+		close(p[1]);
+		return -1;
+	}
+
+	rv = -1;
+	if (imsgbuf_flush(&pr->msgbuf) == -1)
+		goto p;
+
+	buf = ignore->buf;
+	for (off = 0; off < ignore->bufsz; off += n)
+		if ((n = write(p[1], buf + off, ignore->bufsz - off)) == -1)
+			goto p;
+
+	rv = 0;
+	p:
+	close(p[1]);
+	return rv;
+}
+
 int
 content_proc_init(struct content_proc *pr, const char *exe)
 {
@@ -319,45 +423,107 @@ content_proc_reply(struct content_proc *pr, FILE *out,
 	return -1;
 }
 
+/*
+ * Ask mailz-content for the work it has done parsing summaries, with
+ * no requests outstanding.
+ */
 int
-content_proc_summary(struct content_proc *pr,
-		     struct content_summary *sm, int fd)
+content_proc_stats(struct content_proc *pr, struct content_stats *stats)
 {
 	struct imsg msg;
-	struct tm tm;
 	int rv;
 
-	rv = -1;
+	if (imsg_compose(&pr->msgbuf, IMSG_CNT_STATS, 0, -1, -1,
+			 NULL, 0) == -1)
+		return -1;
+	if (imsgbuf_flush(&pr->msgbuf) == -1)
+		return -1;
 
-	if (imsg_compose(&pr->msgbuf, IMSG_CNT_SUMMARY, 0, -1, fd,
-			 NULL, 0) == -1) {
-		close(fd);
+	if (imsgbuf_get_blocking(&pr->msgbuf, &msg) != 1)
 		return -1;
-	}
 
-	if (imsgbuf_flush(&pr->msgbuf) == -1)
+	rv = -1;
+	if (imsg_get_type(&msg) != IMSG_CNT_STATS)
+		goto msg;
+	if (imsg_get_data(&msg, stats, sizeof(*stats)) == -1)
+		goto msg;
+
+	rv = 0;
+	msg:
+	imsg_free(&msg);
+	return rv;
+}
+
+int
+content_proc_summary(struct content_proc *pr,
+		     struct content_summary *sm, int fd, int fields)
+{
+	if (content_proc_summary_send(pr, fd, fields) == -1)
 		return -1;
+	return content_proc_summary_recv(pr, sm);
+}
+
+/*
+ * Read the reply to the oldest outstanding summary request.
+ * Replies arrive in the order the requests were sent.
+ */
+int
+content_proc_summary_recv(struct content_proc *pr,
+			  struct content_summary *sm)
+{
+	struct content_summary_head head;
+	struct imsg msg;
+	struct tm tm;
+	unsigned char data[sizeof(head) + CNT_TEXT_COUNT * CNT_TEXT_MAX];
+	size_t i, len, n;
+	char *p;
+	int rv;
+
+	rv = -1;
 
 	if (imsgbuf_get_blocking(&pr->msgbuf, &msg) != 1)
 		return -1;
 
 	if (imsg_get_type(&msg) != IMSG_CNT_SUMMARY)
 		goto bad;
-	if (imsg_get_data(&msg, sm, sizeof(*sm)) == -1)
+	len = imsg_get_len(&msg);
+	if (len < sizeof(head) || len > sizeof(data))
+		goto bad;
+	if (imsg_get_data(&msg, data, len) == -1)
 		goto bad;
+	memcpy(&head, data, sizeof(head));
 
-	if (localtime_r(&sm->date, &tm) == NULL)
+	if (localtime_r(&head.date, &tm) == NULL)
+		goto bad;
+	if (head.fields & ~CNT_SUMMARY_ALL)
+		goto bad;
+	if (head.size < -1 || head.parsed < 0)
+		goto bad;
+	if ((head.size != -1) != !!(head.fields & CNT_SUMMARY_SIZE))
 		goto bad;
 
-	if (!string_printable(sm->from, sizeof(sm->from)))
+	n = sizeof(head);
+	p = sm->buf;
+	for (i = 0; i < CNT_TEXT_COUNT; i++) {
+		if (head.len[i] > CNT_TEXT_MAX || head.len[i] > len - n)
+			goto bad;
+		memcpy(p, &data[n], head.len[i]);
+		p[head.len[i]] = '\0';
+		if (!string_printable(p, head.len[i] + 1))
+			goto bad;
+		sm->text[i] = p;
+		p += head.len[i] + 1;
+		n += head.len[i];
+	}
+	if (n != len)
 		goto bad;
 
-	if (!string_printable(sm->subject, sizeof(sm->subject)))
+	if (head.len[CNT_TEXT_FROM] == 0)
 		goto bad;
 
-	switch (sm->have_subject) {
+	switch (head.have_subject) {
 	case 0:
-		if (strcmp(sm->subject, "") != 0)
+		if (head.len[CNT_TEXT_SUBJECT] != 0)
 			goto bad;
 		break;
 	case 1:
@@ -366,8 +532,40 @@ content_proc_summary(struct content_proc *pr,
 		goto bad;
 	}
 
+	sm->date = head.date;
+	sm->fields = head.fields;
+	sm->have_subject = head.have_subject;
+	sm->ns = head.ns;
+	sm->parsed = head.parsed;
+	sm->size = head.size;
+
 	rv = 0;
 	bad:
 	imsg_free(&msg);
 	return rv;
 }
+
+/*
+ * Queue a summary request for fd without waiting for the reply, so
+ * that several letters can be in flight at once.
+ * fields is a mask of the optional CNT_SUMMARY_* fields to fill in.
+ * The fd is always consumed.
+ */
+int
+content_proc_summary_send(struct content_proc *pr, int fd, int fields)
+{
+	struct content_summary_setup setup;
+
+	memset(&setup, 0, sizeof(setup));
+	setup.fields = fields;
+
+	if (imsg_compose(&pr->msgbuf, IMSG_CNT_SUMMARY, 0, -1, fd,
+			 &setup, sizeof(setup)) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	if (imsgbuf_flush(&pr->msgbuf) == -1)
+		return -1;
+	return 0;
+}
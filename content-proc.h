@@ -22,20 +22,25 @@
 #include <imsg.h>
 
 #include "content.h"
+#include "ignore.h"
 
 struct content_proc {
 	struct imsgbuf msgbuf;
 	pid_t pid;
 };
 
-#define CNT_IGNORE_IGNORE 0
-#define CNT_IGNORE_RETAIN 1
-
-int content_proc_ignore(struct content_proc *, const char *, int);
+int content_proc_grep_pattern(struct content_proc *, const char *, int);
+int content_proc_grep_read(struct content_proc *);
+int content_proc_grep_recv(struct content_proc *, int *);
+int content_proc_grep_send(struct content_proc *, int);
+int content_proc_ignore(struct content_proc *, const struct ignore *);
 int content_proc_init(struct content_proc *, const char *);
 int content_proc_kill(struct content_proc *);
 int content_proc_reply(struct content_proc *, FILE *, const char *, int, int);
-int content_proc_summary(struct content_proc *, struct content_summary *, int);
+int content_proc_stats(struct content_proc *, struct content_stats *);
+int content_proc_summary(struct content_proc *, struct content_summary *, int, int);
+int content_proc_summary_recv(struct content_proc *, struct content_summary *);
+int content_proc_summary_send(struct content_proc *, int, int);
 
 struct content_letter {
 	struct content_proc *pr;
@@ -15,6 +15,7 @@
  */
 
 #include <sys/queue.h>
+#include <sys/time.h>
 
 #include <ctype.h>
 #include <err.h>
@@ -23,6 +24,7 @@
 #include <imsg.h>
 #include <limits.h>
 #include <locale.h>
+#include <regex.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,7 +37,9 @@
 #include "content.h"
 #include "encoding.h"
 #include "header.h"
+#include "ignore.h"
 #include "imsg-blocking.h"
+#include "mime.h"
 #include "pathnames.h"
 
 /*
@@ -55,111 +59,251 @@
  */
 #define MSGID_LEN 995
 
-struct ignore {
-	char **headers;
-	size_t nheader;
-	#define IGNORE_IGNORE 0
-	#define IGNORE_RETAIN 1
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+/*
+ * The unfolded value of a header captured while building a reply.
+ */
+struct reply_header {
+	char *buf;
+	size_t len;
+};
+
+/*
+ * What the headers of the letter or of one of its parts say about
+ * the body that follows them.
+ */
+struct part {
+	struct charset charset;
+	struct encoding encoding;
+	#define PART_TEXT 0
+	#define PART_MULTIPART 1
+	#define PART_OTHER 2
 	int type;
+	char name[64]; /* type/subtype, "" if too long */
+	char subtype[32]; /* "" if too long */
+	char boundary[MIME_BOUNDARY_MAX + 1];
+	int attachment;
 };
 
-static int handle_ignore(struct imsg *, struct ignore *, int);
+/*
+ * Where handle_multipart is in walking the parts of a multipart body.
+ */
+struct multipart {
+	int alternative;
+	int depth;
+	int shown;
+	char *saved; /* the first text alternative that is not plain */
+	size_t savedsz;
+};
+
+/*
+ * The pattern letters are matched against by grep requests.
+ */
+struct grep {
+	struct content_pattern pattern;
+	regex_t re;
+	int have;
+};
+
+static int handle_content_type(FILE *, FILE *, struct part *);
+static int handle_encoding(FILE *, FILE *, struct encoding *);
+static int handle_grep(struct imsgbuf *, struct imsg *, struct ignore *,
+		       struct grep *);
+static int handle_headers(FILE *, FILE *, struct ignore *, struct part *);
+static int handle_ignore(struct imsg *, struct ignore *);
 static int handle_letter(struct imsgbuf *, struct imsg *, struct ignore *);
-static int handle_letter_under(FILE *, FILE *, struct ignore *, int);
+static int handle_letter_body(FILE *, FILE *, struct charset *,
+			      struct encoding *, int);
+static int handle_letter_under(FILE *, FILE *, struct ignore *);
+static int handle_multipart(FILE *, FILE *, const struct part *, int,
+			    int *);
+static int handle_multipart_part(FILE *, FILE *, struct part *,
+				 struct multipart *);
+static int handle_pattern(struct imsg *, struct grep *);
 static int handle_reply(struct imsgbuf *, struct imsg *);
 static int handle_reply_body(FILE *, FILE *, time_t, const char *,
-			     const char *);
-static int handle_reply_references(FILE *, FILE *, const char *, off_t, off_t);
-static int handle_reply_to(FILE *, FILE *, const char *, off_t, off_t, off_t);
-static int handle_summary(struct imsgbuf *, struct imsg *);
-static int ignore_header(const char *, struct ignore *);
+			     const char *, struct charset *,
+			     struct encoding *);
+static int handle_reply_references(FILE *, const char *,
+				   struct reply_header *,
+				   struct reply_header *);
+static int handle_reply_to(FILE *, const char *, struct reply_header *,
+			   struct reply_header *, struct reply_header *);
+static int handle_stats(struct imsgbuf *, struct imsg *,
+	const struct content_stats *);
+static int handle_summary(struct imsgbuf *, struct imsg *,
+	struct content_stats *);
 static FILE *imsg_get_fp(struct imsg *, const char *);
+static int msgid_first(char *);
+static void part_init(struct part *);
+static FILE *reply_header_fp(struct reply_header *);
+static int reply_header_get(FILE *, struct reply_header *);
 static void usage(void);
 
 static int
-handle_ignore(struct imsg *msg, struct ignore *ignore, int type)
+handle_content_type(FILE *in, FILE *echo, struct part *part)
 {
-	struct content_header header;
-	char *s, **t;
-
-	if (ignore->nheader == SIZE_MAX)
+	struct content_type ct;
+	struct content_type_var vt;
+	char type[16], subtype[sizeof(part->subtype)], var[9];
+	char val[MIME_BOUNDARY_MAX + 1];
+	int eof, hv, n;
+
+	ct.type = type;
+	ct.typesz = sizeof(type);
+	ct.subtype = subtype;
+	ct.subtypesz = sizeof(subtype);
+
+	eof = 0;
+	hv = header_content_type(in, echo, &ct, &eof);
+	if (hv < 0)
 		return -1;
 
-	if (imsg_get_data(msg, &header, sizeof(header)) == -1)
-		return -1;
+	if (ct.type_trunc)
+		part->type = PART_OTHER;
+	else if (!strcasecmp(type, "text"))
+		part->type = PART_TEXT;
+	else if (!strcasecmp(type, "multipart"))
+		part->type = PART_MULTIPART;
+	else
+		part->type = PART_OTHER;
+
+	if (ct.subtype_trunc)
+		subtype[0] = '\0';
+	memcpy(part->subtype, subtype, sizeof(subtype));
+
+	part->name[0] = '\0';
+	if (!ct.type_trunc && !ct.subtype_trunc) {
+		n = snprintf(part->name, sizeof(part->name), "%s/%s",
+			     type, subtype);
+		if (n < 0 || (size_t)n >= sizeof(part->name))
+			part->name[0] = '\0';
+	}
 
-	if (strnlen(header.name, sizeof(header.name))
-			== sizeof(header.name))
-		return -1;
+	if (part->type != PART_TEXT) {
+		charset_from_type(&part->charset, CHARSET_OTHER);
+		encoding_from_type(&part->encoding, ENCODING_BINARY);
+	}
 
-	if ((s = strdup(header.name)) == NULL)
-		return -1;
+	vt.var = var;
+	vt.varsz = sizeof(var);
+	vt.val = val;
+	vt.valsz = sizeof(val);
+	for (;;) {
+		hv = header_content_type_var(in, echo, &vt, &eof);
+		if (hv == HEADER_EOF)
+			break;
+		if (hv < 0)
+			return -1;
+		if (vt.var_trunc)
+			continue;
 
-	t = reallocarray(ignore->headers, ignore->nheader + 1,
-			 sizeof(*ignore->headers));
-	if (t == NULL) {
-		free(s);
-		return -1;
+		if (part->type == PART_TEXT && !strcasecmp(var, "charset")) {
+			int ctype;
+
+			if (!vt.val_trunc
+			    && (ctype = charset_from_name(val)) != CHARSET_UNKNOWN)
+				charset_from_type(&part->charset, ctype);
+			else
+				charset_from_type(&part->charset, CHARSET_OTHER);
+		}
+		else if (!strcasecmp(var, "boundary")) {
+			if (!vt.val_trunc)
+				memcpy(part->boundary, val, sizeof(val));
+		}
 	}
 
-	ignore->headers = t;
-	ignore->headers[ignore->nheader++] = s;
-	ignore->type = type;
+	/* Without a boundary the parts cannot be told apart. */
+	if (part->type == PART_MULTIPART && part->boundary[0] == '\0')
+		part->type = PART_OTHER;
+
 	return 0;
 }
 
 static int
-handle_letter(struct imsgbuf *msgbuf, struct imsg *msg,
-	      struct ignore *ignore)
+handle_encoding(FILE *in, FILE *echo, struct encoding *encoding)
 {
-	struct imsg msg2;
-	FILE *in, *out;
-	int rv;
-
-	rv = -1;
+	char buf[17];
+	int enc;
 
-	if (imsgbuf_get_blocking(msgbuf, &msg2) != 1)
+	if (header_encoding(in, echo, buf, sizeof(buf)) < 0)
+		return -1;
+	if ((enc = encoding_from_name(buf)) == ENCODING_UNKNOWN)
 		return -1;
+	encoding_from_type(encoding, enc);
+	return 0;
+}
 
-	if (imsg_get_type(&msg2) != IMSG_CNT_LETTERPIPE)
-		goto msg2;
-	if ((out = imsg_get_fp(&msg2, "w")) == NULL)
-		goto msg2;
+/*
+ * Decode the letter as the more command shows it and report whether
+ * it matches the pattern set by handle_pattern.
+ */
+static int
+handle_grep(struct imsgbuf *msgbuf, struct imsg *msg, struct ignore *ignore,
+	    struct grep *grep)
+{
+	struct content_grep cg;
+	FILE *in, *out;
+	char *buf;
+	size_t bufsz;
+	int decoded, rv;
+
+	if (!grep->have)
+		return -1;
 
 	if ((in = imsg_get_fp(msg, "r")) == NULL)
-		goto out;
+		return -1;
 
-	if (handle_letter_under(in, out, ignore, 0) == -1)
-		goto in;
+	rv = -1;
 
-	if (imsg_compose(msgbuf, IMSG_CNT_OK, 0, -1, -1, NULL, 0) == -1)
+	buf = NULL;
+	bufsz = 0;
+	if ((out = open_memstream(&buf, &bufsz)) == NULL)
 		goto in;
+
+	decoded = handle_letter_under(in, out, ignore) == 0;
+	if (fclose(out) == EOF)
+		goto buf;
+
+	memset(&cg, 0, sizeof(cg));
+	if (grep->pattern.fixed)
+		cg.match = memmem(buf, bufsz, grep->pattern.pattern,
+				  strlen(grep->pattern.pattern)) != NULL;
+	else
+		cg.match = regexec(&grep->re, buf, 0, NULL, 0) == 0;
+
+	/* A partially decoded letter can still match. */
+	if (!cg.match && !decoded)
+		cg.match = -1;
+
+	if (imsg_compose(msgbuf, IMSG_CNT_GREP, 0, -1, -1,
+			 &cg, sizeof(cg)) == -1)
+		goto buf;
 	if (imsgbuf_flush(msgbuf) == -1)
-		goto in;
+		goto buf;
 
+	rv = 0;
+	buf:
+	free(buf);
 	in:
 	fclose(in);
-	out:
-	fclose(out);
-	msg2:
-	imsg_free(&msg2);
 	return rv;
 }
 
+/*
+ * Read the headers of the letter or of a part into part, echoing
+ * those not hidden by ignore to out if it is not NULL.
+ */
 static int
-handle_letter_under(FILE *in, FILE *out, struct ignore *ignore,
-		    int reply)
+handle_headers(FILE *in, FILE *out, struct ignore *ignore, struct part *part)
 {
-	struct charset charset;
-	struct encoding encoding;
 	int got_content_type, got_encoding;
 
-	charset_from_type(&charset, CHARSET_ASCII);
-	encoding_from_type(&encoding, ENCODING_7BIT);
 	got_content_type = 0;
 	got_encoding = 0;
 	for (;;) {
-		char buf[HEADER_NAME_LEN];
+		char buf[HEADER_NAME_LEN], disp[11];
 		FILE *echo;
 		int hv;
 
@@ -168,7 +312,7 @@ handle_letter_under(FILE *in, FILE *out, struct ignore *ignore,
 		if (hv != HEADER_OK)
 			return -1;
 
-		if (reply || (ignore != NULL && ignore_header(buf, ignore)))
+		if (ignore != NULL && ignore_match(ignore, buf))
 			echo = NULL;
 		else
 			echo = out;
@@ -178,90 +322,127 @@ handle_letter_under(FILE *in, FILE *out, struct ignore *ignore,
 				return -1;
 		}
 
-		if (!strcasecmp(buf, "content-transfer-encoding")) {
-			char buf[17];
-			int enc;
-
-			if (got_encoding)
+		switch (header_field(buf)) {
+		case HEADER_FIELD_CONTENT_DISPOSITION:
+			if (header_disposition(in, echo, disp,
+					       sizeof(disp)) < 0)
 				return -1;
-			hv = header_encoding(in, echo, buf,
-						  sizeof(buf));
-			if (hv < 0)
+			part->attachment = !strcasecmp(disp, "attachment");
+			break;
+		case HEADER_FIELD_CONTENT_TRANSFER_ENCODING:
+			if (got_encoding)
 				return -1;
-			if ((enc = encoding_from_name(buf)) == ENCODING_UNKNOWN)
+			if (handle_encoding(in, echo, &part->encoding) == -1)
 				return -1;
-			encoding_from_type(&encoding, enc);
-
 			got_encoding = 1;
-		}
-		else if (!strcasecmp(buf, "content-type")) {
-			struct content_type ct;
-			struct content_type_var vt;
-			char type[5], var[8], val[11];
-			int eof;
-
+			break;
+		case HEADER_FIELD_CONTENT_TYPE:
 			if (got_content_type)
 				return -1;
-
-			ct.type = type;
-			ct.typesz = sizeof(type);
-			ct.subtype = NULL;
-			ct.subtypesz = 0;
-
-			eof = 0;
-			hv = header_content_type(in, echo, &ct, &eof);
-			if (hv < 0)
+			if (handle_content_type(in, echo, part) == -1)
 				return -1;
-
-			if (ct.type_trunc || strcasecmp(type, "text") != 0) {
-				charset_from_type(&charset, CHARSET_OTHER);
-				encoding_from_type(&encoding, ENCODING_BINARY);
-			}
-
-			vt.var = var;
-			vt.varsz = sizeof(var);
-			vt.val = val;
-			vt.valsz = sizeof(val);
-			for (;;) {
-				hv = header_content_type_var(in, echo, &vt, &eof);
-				if (hv == HEADER_EOF)
-					break;
-				if (hv < 0)
-					return -1;
-
-				if (!vt.var_trunc && !strcasecmp(var, "charset")) {
-					int ctype;
-
-					if (!vt.val_trunc
-					    && (ctype = charset_from_name(val)) != CHARSET_UNKNOWN)
-						charset_from_type(&charset, ctype);
-					else
-						charset_from_type(&charset, CHARSET_OTHER);
-				}
-			}
-
 			got_content_type = 1;
-		}
-		else {
+			break;
+		default:
 			if (header_skip(in, echo) < 0)
 				return -1;
+			break;
 		}
 	}
 
+	return 0;
+}
+
+/*
+ * Load the ignore set compiled by the parent, which is read from the
+ * pipe passed with the message.
+ */
+static int
+handle_ignore(struct imsg *msg, struct ignore *ignore)
+{
+	struct content_ignore ci;
+	FILE *fp;
+	void *buf;
+	int rv;
+
+	if (imsg_get_data(msg, &ci, sizeof(ci)) == -1)
+		return -1;
+	if (ci.size == 0 || ci.size > IGNORE_SET_MAX)
+		return -1;
+
+	if ((fp = imsg_get_fp(msg, "r")) == NULL)
+		return -1;
+
+	rv = -1;
+	if ((buf = malloc(ci.size)) == NULL)
+		goto fp;
+	if (fread(buf, ci.size, 1, fp) != 1 || fgetc(fp) != EOF)
+		goto buf;
+	if (ignore_load(ignore, buf, ci.size) == -1)
+		goto buf;
+	buf = NULL;
+
+	rv = 0;
+	buf:
+	free(buf);
+	fp:
+	fclose(fp);
+	return rv;
+}
+
+static int
+handle_letter(struct imsgbuf *msgbuf, struct imsg *msg,
+	      struct ignore *ignore)
+{
+	struct imsg msg2;
+	FILE *in, *out;
+	int rv;
+
+	rv = -1;
+
+	if (imsgbuf_get_blocking(msgbuf, &msg2) != 1)
+		return -1;
+
+	if (imsg_get_type(&msg2) != IMSG_CNT_LETTERPIPE)
+		goto msg2;
+	if ((out = imsg_get_fp(&msg2, "w")) == NULL)
+		goto msg2;
+
+	if ((in = imsg_get_fp(msg, "r")) == NULL)
+		goto out;
+
+	if (handle_letter_under(in, out, ignore) == -1)
+		goto in;
+
+	if (imsg_compose(msgbuf, IMSG_CNT_OK, 0, -1, -1, NULL, 0) == -1)
+		goto in;
+	if (imsgbuf_flush(msgbuf) == -1)
+		goto in;
+
+	rv = 0;
+	in:
+	fclose(in);
+	out:
+	fclose(out);
+	msg2:
+	imsg_free(&msg2);
+	return rv;
+}
+
+static int
+handle_letter_body(FILE *in, FILE *out, struct charset *charset,
+		   struct encoding *encoding, int reply)
+{
 	if (reply) {
 		if (fprintf(out, "> ") < 0)
 			return -1;
 	}
-	else {
-		if (fputc('\n', out) == EOF)
-			return -1;
-	}
 
 	for (;;) {
 		char buf[4];
 		int n;
 
-		if ((n = charset_getc(&charset, &encoding, in,
+		if ((n = charset_getc(charset, encoding, in,
 				      buf)) == -1)
 			return -1;
 		if (n == 0)
@@ -299,20 +480,204 @@ handle_letter_under(FILE *in, FILE *out, struct ignore *ignore,
 	return 0;
 }
 
+static int
+handle_letter_under(FILE *in, FILE *out, struct ignore *ignore)
+{
+	struct part part;
+	int shown;
+
+	part_init(&part);
+	if (handle_headers(in, out, ignore, &part) == -1)
+		return -1;
+
+	if (fputc('\n', out) == EOF)
+		return -1;
+
+	if (part.type == PART_MULTIPART)
+		return handle_multipart(in, out, &part, 0, &shown);
+	return handle_letter_body(in, out, &part.charset, &part.encoding, 0);
+}
+
+/*
+ * Show the parts of the multipart body in that can be read as text,
+ * and a line in place of each of the others.
+ * Of a multipart/alternative only the first text/plain part is shown,
+ * or failing that the first other text part, which is kept aside in
+ * case a text/plain part follows it.
+ * Parts that are not shown are skipped without being decoded.
+ * *shown is set if any part was shown.
+ */
+static int
+handle_multipart(FILE *in, FILE *out, const struct part *whole, int depth,
+		 int *shown)
+{
+	struct mime mime;
+	struct multipart mp;
+	struct part part;
+	FILE *fp;
+	int hv, mv, rv;
+
+	if (mime_init(&mime, in, whole->boundary) == -1)
+		return -1;
+
+	memset(&mp, 0, sizeof(mp));
+	mp.alternative = !strcasecmp(whole->subtype, "alternative");
+	mp.depth = depth;
+
+	rv = -1;
+	while ((mv = mime_next(&mime)) == 1) {
+		if ((fp = mime_part(&mime)) == NULL)
+			goto mime;
+
+		part_init(&part);
+		if (handle_headers(fp, NULL, NULL, &part) == -1)
+			part.type = PART_OTHER;
+
+		hv = handle_multipart_part(fp, out, &part, &mp);
+		fclose(fp);
+		if (hv == -1)
+			goto mime;
+	}
+	if (mv == -1)
+		goto mime;
+
+	if (mp.alternative && !mp.shown && mp.saved != NULL) {
+		if (fwrite(mp.saved, mp.savedsz, 1, out) != 1)
+			goto mime;
+		mp.shown = 1;
+	}
+	else if (mp.alternative && !mp.shown) {
+		if (fprintf(out, "[%s not shown]\n", whole->name) < 0)
+			goto mime;
+	}
+
+	*shown = mp.shown;
+	rv = 0;
+	mime:
+	free(mp.saved);
+	mime_free(&mime);
+	return rv;
+}
+
+/*
+ * Show, keep aside or skip a part read from in, for handle_multipart.
+ */
+static int
+handle_multipart_part(FILE *in, FILE *out, struct part *part,
+		      struct multipart *mp)
+{
+	FILE *save;
+	int inner;
+
+	if (mp->alternative && mp->shown)
+		return 0;
+
+	if (part->type == PART_MULTIPART && !part->attachment
+	    && mp->depth < MIME_DEPTH_MAX) {
+		if (handle_multipart(in, out, part, mp->depth + 1,
+				     &inner) == -1)
+			return -1;
+		mp->shown |= inner;
+		return 0;
+	}
+
+	if (part->type != PART_TEXT || part->attachment) {
+		if (mp->alternative)
+			return 0;
+		if (fprintf(out, "[%s%snot shown]\n", part->name,
+			    part->name[0] != '\0' ? " " : "") < 0)
+			return -1;
+		return 0;
+	}
+
+	if (mp->alternative && strcasecmp(part->subtype, "plain") != 0) {
+		if (mp->saved != NULL)
+			return 0;
+		if ((save = open_memstream(&mp->saved, &mp->savedsz)) == NULL)
+			return -1;
+		if (handle_letter_body(in, save, &part->charset,
+				       &part->encoding, 0) == -1
+		    || fputc('\n', save) == EOF) {
+			fclose(save);
+			return -1;
+		}
+		if (fclose(save) == EOF)
+			return -1;
+		return 0;
+	}
+
+	if (handle_letter_body(in, out, &part->charset, &part->encoding,
+			       0) == -1)
+		return -1;
+	if (fputc('\n', out) == EOF)
+		return -1;
+	mp->shown = 1;
+	return 0;
+}
+
+/*
+ * Set the pattern that grep requests match letters against.
+ */
+static int
+handle_pattern(struct imsg *msg, struct grep *grep)
+{
+	struct content_pattern pattern;
+
+	if (imsg_get_data(msg, &pattern, sizeof(pattern)) == -1)
+		return -1;
+
+	if (strnlen(pattern.pattern, sizeof(pattern.pattern))
+			== sizeof(pattern.pattern))
+		return -1;
+
+	if (grep->have) {
+		if (!grep->pattern.fixed)
+			regfree(&grep->re);
+		grep->have = 0;
+	}
+
+	if (!pattern.fixed) {
+		if (regcomp(&grep->re, pattern.pattern,
+			    REG_EXTENDED | REG_NOSUB | REG_NEWLINE) != 0)
+			return -1;
+	}
+
+	grep->pattern = pattern;
+	grep->have = 1;
+	return 0;
+}
+
+/*
+ * Build a reply in a single pass over the letter.
+ * The values of the headers that are copied into the reply are
+ * captured as they are seen, and the quoted body is written straight
+ * from where the headers end.
+ */
 static int
 handle_reply(struct imsgbuf *msgbuf, struct imsg *msg)
 {
 	struct content_reply_setup setup;
+	struct header_address from_p;
 	struct imsg msg2;
-	FILE *in, *out;
+	struct part part;
+	struct reply_header cc, from, in_reply_to, references, reply_to;
+	struct reply_header subject, to;
+	FILE *fp, *in, *out;
 	char addr_buf[255], *addr, msgid[MSGID_LEN];
 	char from_addr[255], from_name[256];
 	time_t date;
-	off_t cc, from, in_reply_to, references, reply_to, subject, to;
-	int rv;
+	int got_content_type, got_encoding, rv;
 
 	rv = -1;
 
+	memset(&cc, 0, sizeof(cc));
+	memset(&from, 0, sizeof(from));
+	memset(&in_reply_to, 0, sizeof(in_reply_to));
+	memset(&references, 0, sizeof(references));
+	memset(&reply_to, 0, sizeof(reply_to));
+	memset(&subject, 0, sizeof(subject));
+	memset(&to, 0, sizeof(to));
+
 	if ((in = imsg_get_fp(msg, "r")) == NULL)
 		return -1;
 
@@ -343,15 +708,12 @@ handle_reply(struct imsgbuf *msgbuf, struct imsg *msg)
 	else
 		addr = setup.addr;
 
-	cc = -1;
+	part_init(&part);
+	got_content_type = 0;
+	got_encoding = 0;
+
 	date = -1;
-	from = -1;
-	in_reply_to = -1;
 	msgid[0] = '\0';
-	references = -1;
-	reply_to = -1;
-	subject = -1;
-	to = -1;
 	for (;;) {
 		char buf[HEADER_NAME_LEN];
 		int hv;
@@ -361,116 +723,118 @@ handle_reply(struct imsgbuf *msgbuf, struct imsg *msg)
 		if (hv != HEADER_OK)
 			goto out;
 
-		if (!strcasecmp(buf, "cc")) {
-			if (cc != -1)
-				goto out;
-			if ((cc = ftello(in)) == -1)
+		switch (header_field(buf)) {
+		case HEADER_FIELD_CC:
+			if (reply_header_get(in, &cc) == -1)
 				goto out;
-			if (header_skip(in, NULL) < 0)
-				goto out;
-		}
-		else if (!strcasecmp(buf, "date")) {
-			if (date != -1)
+			break;
+		case HEADER_FIELD_CONTENT_TRANSFER_ENCODING:
+			if (got_encoding)
 				goto out;
-			if (header_date(in, &date) != HEADER_OK)
+			if (handle_encoding(in, NULL, &part.encoding) == -1)
 				goto out;
-		}
-		else if (!strcasecmp(buf, "from")) {
-			struct header_address from_p;
-
-			if (from != -1)
+			got_encoding = 1;
+			break;
+		case HEADER_FIELD_CONTENT_TYPE:
+			if (got_content_type)
 				goto out;
-			if ((from = ftello(in)) == -1)
+			if (handle_content_type(in, NULL, &part) == -1)
 				goto out;
-
-			from_p.addr = from_addr;
-			from_p.addrsz = sizeof(from_addr);
-
-			from_p.name = from_name;
-			from_p.namesz = sizeof(from_name);
-
-			if (header_from(in, &from_p) < 0)
+			got_content_type = 1;
+			break;
+		case HEADER_FIELD_DATE:
+			if (date != -1)
 				goto out;
-		}
-		else if (!strcasecmp(buf, "in-reply-to")) {
-			if (in_reply_to != -1)
+			if (header_date(in, &date) != HEADER_OK)
 				goto out;
-			if ((in_reply_to = ftello(in)) == -1)
+			break;
+		case HEADER_FIELD_FROM:
+			if (reply_header_get(in, &from) == -1)
 				goto out;
-			if (header_skip(in, NULL) < 0)
+			break;
+		case HEADER_FIELD_IN_REPLY_TO:
+			if (reply_header_get(in, &in_reply_to) == -1)
 				goto out;
-		}
-		else if (!strcasecmp(buf, "message-id")) {
+			break;
+		case HEADER_FIELD_MESSAGE_ID:
 			if (strlen(msgid) != 0)
 				goto out;
 			if (header_message_id(in, msgid,
 					      sizeof(msgid)) < 0)
 				goto out;
-		}
-		else if (!strcasecmp(buf, "references")) {
-			if (references != -1)
-				goto out;
-			if ((references = ftello(in)) == -1)
-				goto out;
-			if (header_skip(in, NULL) < 0)
-				goto out;
-		}
-		else if (!strcasecmp(buf, "reply-to")) {
-			if (reply_to != -1)
-				goto out;
-			if ((reply_to = ftello(in)) == -1)
-				goto out;
-			if (header_skip(in, NULL) < 0)
-				goto out;
-		}
-		else if (!strcasecmp(buf, "subject")) {
-			if (subject != -1)
-				goto out;
-			if ((subject = ftello(in)) == -1)
-				goto out;
-			if (header_skip(in, NULL) < 0)
-				goto out;
-		}
-		else if (setup.group && !strcasecmp(buf, "to")) {
-			if (to != -1)
+			break;
+		case HEADER_FIELD_REFERENCES:
+			if (reply_header_get(in, &references) == -1)
 				goto out;
-			if ((to = ftello(in)) == -1)
+			break;
+		case HEADER_FIELD_REPLY_TO:
+			if (reply_header_get(in, &reply_to) == -1)
 				goto out;
-			if (header_skip(in, NULL) < 0)
+			break;
+		case HEADER_FIELD_SUBJECT:
+			if (reply_header_get(in, &subject) == -1)
 				goto out;
-		}
-		else {
+			break;
+		case HEADER_FIELD_TO:
+			if (setup.group) {
+				if (reply_header_get(in, &to) == -1)
+					goto out;
+				break;
+			}
+			/* FALLTHROUGH */
+		default:
 			if (header_skip(in, NULL) < 0)
 				goto out;
+			break;
 		}
 	}
 
-	if (date == -1 || from == -1)
+	if (date == -1 || from.buf == NULL)
 		goto out;
 
-	if (subject != -1) {
-		if (fseeko(in, subject, SEEK_SET) == -1)
+	from_p.addr = from_addr;
+	from_p.addrsz = sizeof(from_addr);
+
+	from_p.name = from_name;
+	from_p.namesz = sizeof(from_name);
+
+	if ((fp = reply_header_fp(&from)) == NULL)
+		goto out;
+	if (header_from(fp, &from_p) < 0) {
+		fclose(fp);
+		goto out;
+	}
+	fclose(fp);
+
+	if (subject.buf != NULL) {
+		if ((fp = reply_header_fp(&subject)) == NULL)
 			goto out;
-		if (header_subject_reply(in, out) < 0)
+		if (header_subject_reply(fp, out) < 0) {
+			fclose(fp);
 			goto out;
+		}
+		fclose(fp);
 	}
 	else {
 		if (fprintf(out, "Subject: Re: No Subject\n") < 0)
 			goto out;
 	}
 
-	if (handle_reply_to(in, out, addr, from, to, reply_to) == -1)
+	if (handle_reply_to(out, addr, &from, &to, &reply_to) == -1)
 		goto out;
-	if (setup.group && cc != -1) {
+	if (setup.group && cc.buf != NULL) {
 		int any;
 
 		if (fprintf(out, "Cc:") < 0)
 			goto out;
-		if (fseeko(in, cc, SEEK_SET) == -1)
+		if ((fp = reply_header_fp(&cc)) == NULL)
 			goto out;
 		any = 0;
-		if (header_copy_addresses(in, out, addr, &any) < 0)
+		if (header_copy_addresses(fp, out, addr, &any) < 0) {
+			fclose(fp);
 			goto out;
+		}
+		fclose(fp);
 		if (fprintf(out, "\n") < 0)
 			goto out;
 	}
@@ -478,8 +842,8 @@ handle_reply(struct imsgbuf *msgbuf, struct imsg *msg)
 	if (fprintf(out, "From: %s\n", setup.addr) < 0)
 		goto out;
 
-	if (handle_reply_references(in, out, msgid, in_reply_to,
-				    references) == -1)
+	if (handle_reply_references(out, msgid, &in_reply_to,
+				    &references) == -1)
 		goto out;
 
 	if (fprintf(out, "Content-Transfer-Encoding: 8bit\n") < 0)
@@ -487,7 +851,8 @@ handle_reply(struct imsgbuf *msgbuf, struct imsg *msg)
 	if (fprintf(out, "Content-Type: text/plain; charset=utf-8\n") < 0)
 		goto out;
 
-	if (handle_reply_body(in, out, date, from_addr, from_name) == -1)
+	if (handle_reply_body(in, out, date, from_addr, from_name,
+			      &part.charset, &part.encoding) == -1)
 		goto out;
 
 	if (imsg_compose(msgbuf, IMSG_CNT_REPLY, 0, -1, -1,
@@ -502,13 +867,21 @@ handle_reply(struct imsgbuf *msgbuf, struct imsg *msg)
 	msg2:
 	imsg_free(&msg2);
 	in:
+	free(cc.buf);
+	free(from.buf);
+	free(in_reply_to.buf);
+	free(references.buf);
+	free(reply_to.buf);
+	free(subject.buf);
+	free(to.buf);
 	fclose(in);
 	return rv;
 }
 
 static int
 handle_reply_body(FILE *in, FILE *out, time_t date, const char *addr,
-		  const char *name)
+		  const char *name, struct charset *charset,
+		  struct encoding *encoding)
 {
 	char datebuf[39];
 	struct tm tm;
@@ -534,15 +907,15 @@ handle_reply_body(FILE *in, FILE *out, time_t date, const char *addr,
 			return -1;
 	}
 
-	if (fseeko(in, 0, SEEK_SET) == -1)
-		return -1;
-	return handle_letter_under(in, out, NULL, 1);
+	return handle_letter_body(in, out, charset, encoding, 1);
 }
 
 static int
-handle_reply_references(FILE *in, FILE *out, const char *msgid,
-			off_t in_reply_to, off_t refs)
+handle_reply_references(FILE *out, const char *msgid,
+			struct reply_header *in_reply_to,
+			struct reply_header *refs)
 {
+	struct reply_header *copy;
 	int putref;
 
 	if (strlen(msgid) != 0) {
@@ -550,23 +923,26 @@ handle_reply_references(FILE *in, FILE *out, const char *msgid,
 			return -1;
 	}
 
+	if (refs->buf != NULL)
+		copy = refs;
+	else if (in_reply_to->buf != NULL)
+		copy = in_reply_to;
+	else
+		copy = NULL;
+
 	putref = 0;
-	if (refs != -1) {
-		if (fprintf(out, "References:") < 0)
-			return -1;
-		if (fseeko(in, refs, SEEK_SET) == -1)
-			return -1;
-		if (header_copy(in, out) < 0)
-			return -1;
-		putref = 1;
-	}
-	else if (in_reply_to != -1) {
+	if (copy != NULL) {
+		FILE *fp;
+
 		if (fprintf(out, "References:") < 0)
 			return -1;
-		if (fseeko(in, in_reply_to, SEEK_SET) == -1)
+		if ((fp = reply_header_fp(copy)) == NULL)
 			return -1;
-		if (header_copy(in, out) < 0)
+		if (header_copy(fp, out) < 0) {
+			fclose(fp);
 			return -1;
+		}
+		fclose(fp);
 		putref = 1;
 	}
 
@@ -588,33 +964,33 @@ handle_reply_references(FILE *in, FILE *out, const char *msgid,
 }
 
 static int
-handle_reply_to(FILE *in, FILE *out, const char *addr, off_t from,
-		off_t to, off_t reply_to)
+handle_reply_to(FILE *out, const char *addr, struct reply_header *from,
+		struct reply_header *to, struct reply_header *reply_to)
 {
+	struct reply_header *hdrs[2];
+	size_t i;
 	int any;
 
 	if (fprintf(out, "To:") < 0)
 		return -1;
 
+	hdrs[0] = reply_to->buf != NULL ? reply_to : from;
+	hdrs[1] = to;
+
 	any = 0;
-	if (reply_to != -1) {
-		if (fseeko(in, reply_to, SEEK_SET) == -1)
-			return -1;
-		if (header_copy_addresses(in, out, addr, &any) < 0)
-			return -1;
-	}
-	else {
-		if (fseeko(in, from, SEEK_SET) == -1)
-			return -1;
-		if (header_copy_addresses(in, out, addr, &any) < 0)
-			return -1;
-	}
+	for (i = 0; i < nitems(hdrs); i++) {
+		FILE *fp;
 
-	if (to != -1) {
-		if (fseeko(in, to, SEEK_SET) == -1)
+		if (hdrs[i]->buf == NULL)
+			continue;
+
+		if ((fp = reply_header_fp(hdrs[i])) == NULL)
 			return -1;
-		if (header_copy_addresses(in, out, addr, &any) < 0)
+		if (header_copy_addresses(fp, out, addr, &any) < 0) {
+			fclose(fp);
 			return -1;
+		}
+		fclose(fp);
 	}
 
 	if (fprintf(out, "\n") < 0)
@@ -623,42 +999,84 @@ handle_reply_to(FILE *in, FILE *out, const char *addr, off_t from,
 }
 
 static int
-handle_summary(struct imsgbuf *msgbuf, struct imsg *msg)
+handle_stats(struct imsgbuf *msgbuf, struct imsg *msg,
+	const struct content_stats *stats)
 {
-	struct content_summary sm;
+	if (imsg_get_len(msg) != 0)
+		return -1;
+	if (imsg_compose(msgbuf, IMSG_CNT_STATS, 0, -1, -1,
+			 stats, sizeof(*stats)) == -1)
+		return -1;
+	if (imsgbuf_flush(msgbuf) == -1)
+		return -1;
+	return 0;
+}
+
+static int
+handle_summary(struct imsgbuf *msgbuf, struct imsg *msg,
+	struct content_stats *stats)
+{
+	struct content_summary_head head;
+	struct content_summary_setup setup;
+	struct header_address from;
+	struct timespec begin, end;
 	FILE *fp;
-	int rv;
+	char text[CNT_TEXT_COUNT][CNT_TEXT_MAX + 1];
+	unsigned char data[sizeof(head) + CNT_TEXT_COUNT * CNT_TEXT_MAX];
+	size_t i, n;
+	int rv, want;
 
 	rv = -1;
 
+	if (clock_gettime(CLOCK_MONOTONIC, &begin) == -1)
+		return -1;
+
 	if ((fp = imsg_get_fp(msg, "r")) == NULL)
 		return -1;
 
-	memset(&sm, 0, sizeof(sm));
-	sm.date = -1;
+	if (imsg_get_data(msg, &setup, sizeof(setup)) == -1)
+		goto fp;
+	if (setup.fields & ~CNT_SUMMARY_ALL)
+		goto fp;
+
+	memset(&head, 0, sizeof(head));
+	head.date = -1;
+	head.size = -1;
+	for (i = 0; i < nitems(text); i++)
+		text[i][0] = '\0';
+
+	if (setup.fields & CNT_SUMMARY_SIZE) {
+		if (fseeko(fp, 0, SEEK_END) == -1)
+			goto fp;
+		if ((head.size = ftello(fp)) == -1)
+			goto fp;
+		if (fseeko(fp, 0, SEEK_SET) == -1)
+			goto fp;
+		head.fields |= CNT_SUMMARY_SIZE;
+	}
+
 	for (;;) {
 		char buf[HEADER_NAME_LEN];
-		int n;
+		int error, field, msgid, type;
 
-		if ((n = header_name(fp, buf, sizeof(buf))) == HEADER_EOF)
+		if ((error = header_name(fp, buf, sizeof(buf))) == HEADER_EOF)
 			break;
-		if (n != HEADER_OK)
+		if (error != HEADER_OK)
 			goto fp;
 
-		if (!strcasecmp(buf, "date")) {
-			if (sm.date != -1)
+		field = header_field(buf);
+		if (field == HEADER_FIELD_DATE) {
+			if (head.date != -1)
 				goto fp;
-			if (header_date(fp, &sm.date) != HEADER_OK)
+			if (header_date(fp, &head.date) != HEADER_OK)
 				goto fp;
 		}
-		else if (!strcasecmp(buf, "from")) {
-			struct header_address from;
-
-			if (strlen(sm.from) != 0)
+		else if (field == HEADER_FIELD_FROM) {
+			if (strlen(text[CNT_TEXT_FROM]) != 0)
 				goto fp;
 
-			from.addr = sm.from;
-			from.addrsz = sizeof(sm.from);
+			from.addr = text[CNT_TEXT_FROM];
+			from.addrsz = sizeof(text[CNT_TEXT_FROM]);
 
 			from.name = NULL;
 			from.namesz = 0;
@@ -666,59 +1084,99 @@ handle_summary(struct imsgbuf *msgbuf, struct imsg *msg)
 			if (header_from(fp, &from) < 0)
 				goto fp;
 		}
-		else if (!strcasecmp(buf, "subject")) {
-			if (sm.have_subject)
+		else if (field == HEADER_FIELD_SUBJECT) {
+			if (head.have_subject)
 				goto fp;
-			if (header_subject(fp, sm.subject,
-					   sizeof(sm.subject)) < 0)
+			if (header_subject(fp, text[CNT_TEXT_SUBJECT],
+					   sizeof(text[CNT_TEXT_SUBJECT])) < 0)
 				goto fp;
-			sm.have_subject = 1;
+			head.have_subject = 1;
 		}
 		else {
-			if (header_skip(fp, NULL) < 0)
+			msgid = 0;
+			switch (field) {
+			case HEADER_FIELD_CC:
+				type = CNT_SUMMARY_CC;
+				i = CNT_TEXT_CC;
+				break;
+			case HEADER_FIELD_IN_REPLY_TO:
+				type = CNT_SUMMARY_IN_REPLY_TO;
+				i = CNT_TEXT_IN_REPLY_TO;
+				msgid = 1;
+				break;
+			case HEADER_FIELD_LIST_ID:
+				type = CNT_SUMMARY_LIST_ID;
+				i = CNT_TEXT_LIST_ID;
+				break;
+			case HEADER_FIELD_MESSAGE_ID:
+				type = CNT_SUMMARY_MESSAGE_ID;
+				i = CNT_TEXT_MESSAGE_ID;
+				msgid = 1;
+				break;
+			case HEADER_FIELD_TO:
+				type = CNT_SUMMARY_TO;
+				i = CNT_TEXT_TO;
+				break;
+			default:
+				type = 0;
+				break;
+			}
+
+			/* Only the first of a repeated field is kept. */
+			if (!(setup.fields & type) || (head.fields & type)) {
+				if (header_skip(fp, NULL) < 0)
+					goto fp;
+				continue;
+			}
+
+			if (header_subject(fp, text[i], sizeof(text[i])) < 0)
 				goto fp;
-			continue;
+			if (!msgid || msgid_first(text[i]) == 0)
+				head.fields |= type;
 		}
 
-		if (sm.date != -1 && strlen(sm.from) != 0
-				  && sm.have_subject)
+		want = setup.fields & ~CNT_SUMMARY_SIZE;
+		if (head.date != -1 && strlen(text[CNT_TEXT_FROM]) != 0
+				    && head.have_subject
+				    && (head.fields & want) == want)
 			break;
 	}
 
-	if (sm.date == -1)
+	if (head.date == -1)
+		goto fp;
+	if (strlen(text[CNT_TEXT_FROM]) == 0)
+		goto fp;
+	if ((head.parsed = ftello(fp)) == -1)
 		goto fp;
-	if (strlen(sm.from) == 0)
+	if (clock_gettime(CLOCK_MONOTONIC, &end) == -1)
 		goto fp;
+	timespecsub(&end, &begin, &end);
+	head.ns = (uint64_t)end.tv_sec * 1000000000 + end.tv_nsec;
+
+	n = sizeof(head);
+	for (i = 0; i < nitems(text); i++) {
+		head.len[i] = strlen(text[i]);
+		memcpy(&data[n], text[i], head.len[i]);
+		n += head.len[i];
+	}
+	memcpy(data, &head, sizeof(head));
 
 	if (imsg_compose(msgbuf, IMSG_CNT_SUMMARY, 0, -1, -1,
-			 &sm, sizeof(sm)) == -1)
+			 data, n) == -1)
 		goto fp;
 	if (imsgbuf_flush(msgbuf) == -1)
 		goto fp;
 
+	stats->bytes += head.parsed;
+	stats->letters++;
+	stats->ns += head.ns;
+
 	rv = 0;
 	fp:
 	fclose(fp);
 	return rv;
 }
 
-static int
-ignore_header(const char *name, struct ignore *ignore)
-{
-	size_t i;
-	int rv;
-
-	if (ignore->type == IGNORE_RETAIN)
-		rv = 0;
-	else
-		rv = 1;
-
-	for (i = 0; i < ignore->nheader; i++)
-		if (!strcasecmp(name, ignore->headers[i]))
-			return rv;
-	return !rv;
-}
-
 static FILE *
 imsg_get_fp(struct imsg *msg, const char *perm)
 {
@@ -736,6 +1194,81 @@ imsg_get_fp(struct imsg *msg, const char *perm)
 	return rv;
 }
 
+/*
+ * Replace the unfolded value of a header holding message identifiers
+ * with the first identifier, without its angle brackets.
+ * Returns -1 if the value does not hold one.
+ */
+static int
+msgid_first(char *buf)
+{
+	char *end, *start;
+
+	if ((start = strchr(buf, '<')) == NULL)
+		return -1;
+	start++;
+	if ((end = strchr(start, '>')) == NULL || end == start)
+		return -1;
+
+	memmove(buf, start, end - start);
+	buf[end - start] = '\0';
+	return 0;
+}
+
+/*
+ * A part with no headers, which is plain US-ASCII text.
+ */
+static void
+part_init(struct part *part)
+{
+	memset(part, 0, sizeof(*part));
+	charset_from_type(&part->charset, CHARSET_ASCII);
+	encoding_from_type(&part->encoding, ENCODING_7BIT);
+	part->type = PART_TEXT;
+	strlcpy(part->name, "text/plain", sizeof(part->name));
+	strlcpy(part->subtype, "plain", sizeof(part->subtype));
+}
+
+static FILE *
+reply_header_fp(struct reply_header *rh)
+{
+	return fmemopen(rh->buf, rh->len, "r");
+}
+
+/*
+ * Capture the (unfolded) value of the current header into rh.
+ * It is an error for the header to have been captured already.
+ */
+static int
+reply_header_get(FILE *in, struct reply_header *rh)
+{
+	FILE *fp;
+	int rv;
+
+	if (rh->buf != NULL)
+		return -1;
+
+	if ((fp = open_memstream(&rh->buf, &rh->len)) == NULL)
+		return -1;
+
+	rv = -1;
+	if (header_copy(in, fp) < 0)
+		goto fp;
+	/* Terminate the value as header_lex expects */
+	if (fputc('\n', fp) == EOF)
+		goto fp;
+
+	rv = 0;
+	fp:
+	if (fclose(fp) == EOF)
+		rv = -1;
+	if (rv == -1) {
+		free(rh->buf);
+		rh->buf = NULL;
+	}
+	return rv;
+}
+
 static void
 usage(void)
 {
@@ -746,6 +1279,8 @@ usage(void)
 int
 main(int argc, char *argv[])
 {
+	struct content_stats stats;
+	struct grep grep;
 	struct ignore ignore;
 	struct imsgbuf msgbuf;
 	size_t i;
@@ -789,7 +1324,9 @@ main(int argc, char *argv[])
 	if (pledge("stdio recvfd", NULL) == -1)
 		err(1, "pledge");
 
-	memset(&ignore, 0, sizeof(ignore));
+	memset(&grep, 0, sizeof(grep));
+	ignore_init(&ignore);
+	memset(&stats, 0, sizeof(stats));
 	if (imsgbuf_init(&msgbuf, CONTENT_PARENT_SOCKET) == -1)
 		err(1, "imsgbuf_init");
 	imsgbuf_allow_fdpass(&msgbuf);
@@ -803,20 +1340,26 @@ main(int argc, char *argv[])
 			break;
 
 		switch (imsg_get_type(&msg)) {
+		case IMSG_CNT_GREP:
+			hv = handle_grep(&msgbuf, &msg, &ignore, &grep);
+			break;
 		case IMSG_CNT_IGNORE:
-			hv = handle_ignore(&msg, &ignore, IGNORE_IGNORE);
+			hv = handle_ignore(&msg, &ignore);
 			break;
 		case IMSG_CNT_LETTER:
 			hv = handle_letter(&msgbuf, &msg, &ignore);
 			break;
+		case IMSG_CNT_PATTERN:
+			hv = handle_pattern(&msg, &grep);
+			break;
 		case IMSG_CNT_REPLY:
 			hv = handle_reply(&msgbuf, &msg);
 			break;
-		case IMSG_CNT_RETAIN:
-			hv = handle_ignore(&msg, &ignore, IGNORE_RETAIN);
+		case IMSG_CNT_STATS:
+			hv = handle_stats(&msgbuf, &msg, &stats);
 			break;
 		case IMSG_CNT_SUMMARY:
-			hv = handle_summary(&msgbuf, &msg);
+			hv = handle_summary(&msgbuf, &msg, &stats);
 			break;
 		default:
 			hv = -1;
@@ -830,9 +1373,9 @@ main(int argc, char *argv[])
 
 	msgbuf:
 	imsgbuf_clear(&msgbuf);
-	for (i = 0; i < ignore.nheader; i++)
-		free(ignore.headers[i]);
-	free(ignore.headers);
+	if (grep.have && !grep.pattern.fixed)
+		regfree(&grep.re);
+	ignore_free(&ignore);
 	close(CONTENT_PARENT_SOCKET);
 	close(null);
 }
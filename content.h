@@ -20,18 +20,42 @@
 enum {
 	IMSG_CNT_IGNORE,
 	IMSG_CNT_OK,
-	IMSG_CNT_RETAIN,
 	IMSG_CNT_LETTER,
 	IMSG_CNT_LETTERPIPE,
 	IMSG_CNT_REPLY,
 	IMSG_CNT_REPLYPIPE,
-	IMSG_CNT_SUMMARY
+	IMSG_CNT_SUMMARY,
+	IMSG_CNT_GREP,
+	IMSG_CNT_PATTERN,
+	IMSG_CNT_STATS
 };
 
 #define CONTENT_PARENT_SOCKET 3
 
-struct content_header {
-	char name[996];
+/*
+ * Sent with a pipe that the compiled ignore set, size bytes long,
+ * is written to.
+ */
+struct content_ignore {
+	uint32_t size;
+};
+
+struct content_grep {
+	int match; /* -1 if the letter could not be decoded */
+};
+
+struct content_pattern {
+	char pattern[996];
+	int fixed;
+};
+
+/*
+ * Work done parsing summaries since mailz-content was started.
+ */
+struct content_stats {
+	uint64_t letters;
+	uint64_t bytes; /* read from the letters */
+	uint64_t ns;
 };
 
 struct content_reply_setup {
@@ -39,11 +63,64 @@ struct content_reply_setup {
 	int group;
 };
 
+/*
+ * Optional fields of a summary, requested with
+ * struct content_summary_setup.
+ */
+#define CNT_SUMMARY_CC 0x01
+#define CNT_SUMMARY_IN_REPLY_TO 0x02
+#define CNT_SUMMARY_LIST_ID 0x04
+#define CNT_SUMMARY_MESSAGE_ID 0x08
+#define CNT_SUMMARY_SIZE 0x10
+#define CNT_SUMMARY_TO 0x20
+#define CNT_SUMMARY_ALL 0x3f
+
+struct content_summary_setup {
+	int fields;
+};
+
+/*
+ * Text fields of a summary, in the order they follow
+ * struct content_summary_head in an IMSG_CNT_SUMMARY message.
+ */
+enum {
+	CNT_TEXT_FROM,
+	CNT_TEXT_SUBJECT,
+	CNT_TEXT_CC,
+	CNT_TEXT_IN_REPLY_TO,
+	CNT_TEXT_LIST_ID,
+	CNT_TEXT_MESSAGE_ID,
+	CNT_TEXT_TO,
+	CNT_TEXT_COUNT
+};
+
+/* Longest text field of a summary, longer fields are truncated. */
+#define CNT_TEXT_MAX 998
+
+/*
+ * A summary is sent as this header followed by each text field,
+ * len[i] bytes long and without a terminating NUL, so that letters
+ * with short headers make for short messages.
+ */
+struct content_summary_head {
+	time_t date;
+	off_t size; /* -1 if not requested */
+	off_t parsed; /* bytes read to make the summary */
+	uint64_t ns; /* time taken to make it */
+	int fields; /* optional fields present in the letter */
+	int have_subject;
+	uint16_t len[CNT_TEXT_COUNT];
+};
+
 struct content_summary {
 	time_t date;
-	char from[255];
-	char subject[120];
+	off_t size;
+	off_t parsed;
+	uint64_t ns;
+	int fields;
 	int have_subject;
+	const char *text[CNT_TEXT_COUNT]; /* "" if missing */
+	char buf[CNT_TEXT_COUNT * (CNT_TEXT_MAX + 1)];
 };
 
 #endif /* ! CONTENT_H */
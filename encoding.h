@@ -29,7 +29,7 @@ enum encoding_type {
 struct encoding {
 	union {
 		struct encoding_base64 {
-			char buf[2];
+			unsigned char buf[2];
 			int start;
 			int end;
 		} base64;
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Predicates over the summary fields of the letters in a mailbox.
+ * A filter is a list of terms of the form [!]field:value, every one of
+ * which must hold for a letter to match.
+ * Each term is checked against one field of every letter before
+ * moving on to the next term, rather than checking every term against
+ * one letter at a time.
+ */
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "filter.h"
+#include "mailbox.h"
+
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+static int filter_date(const char *, time_t *);
+static const char *letter_field(const struct letter *, enum filter_field);
+static int term_match(const struct filter_term *, const struct letter *);
+
+static const struct {
+	const char *name;
+	enum filter_field field;
+	int letter_field;
+} fields[] = {
+	{ "before",		FILTER_BEFORE,		0 },
+	{ "cc",			FILTER_CC,		LETTER_CC },
+	{ "from",		FILTER_FROM,		0 },
+	{ "in-reply-to",	FILTER_IN_REPLY_TO,	LETTER_IN_REPLY_TO },
+	{ "list-id",		FILTER_LIST_ID,		LETTER_LIST_ID },
+	{ "message-id",		FILTER_MESSAGE_ID,	LETTER_MESSAGE_ID },
+	{ "since",		FILTER_SINCE,		0 },
+	{ "subject",		FILTER_SUBJECT,		0 },
+	{ "to",			FILTER_TO,		LETTER_TO },
+};
+
+/*
+ * Parse a YYYY-MM-DD date as the start of that day in local time.
+ */
+static int
+filter_date(const char *s, time_t *dp)
+{
+	struct tm tm;
+	const char *errstr;
+	char buf[5];
+	size_t i;
+
+	if (strlen(s) != 10 || s[4] != '-' || s[7] != '-')
+		return -1;
+	for (i = 0; i < 10; i++) {
+		if (i != 4 && i != 7 && !isdigit((unsigned char)s[i]))
+			return -1;
+	}
+
+	memset(&tm, 0, sizeof(tm));
+
+	memcpy(buf, s, 4);
+	buf[4] = '\0';
+	tm.tm_year = strtonum(buf, 1970, 9999, &errstr) - 1900;
+	if (errstr != NULL)
+		return -1;
+
+	memcpy(buf, &s[5], 2);
+	buf[2] = '\0';
+	tm.tm_mon = strtonum(buf, 1, 12, &errstr) - 1;
+	if (errstr != NULL)
+		return -1;
+
+	memcpy(buf, &s[8], 2);
+	buf[2] = '\0';
+	tm.tm_mday = strtonum(buf, 1, 31, &errstr);
+	if (errstr != NULL)
+		return -1;
+
+	tm.tm_isdst = -1;
+	if ((*dp = mktime(&tm)) == -1)
+		return -1;
+	return 0;
+}
+
+/*
+ * Returns the mask of the optional LETTER_* fields used by filter.
+ */
+int
+filter_fields(const struct filter *filter)
+{
+	size_t i, j;
+	int mask;
+
+	mask = 0;
+	for (i = 0; i < filter->nterm; i++) {
+		for (j = 0; j < nitems(fields); j++) {
+			if (fields[j].field == filter->terms[i].field)
+				mask |= fields[j].letter_field;
+		}
+	}
+	return mask;
+}
+
+/*
+ * Returns 1 if letter is matched by filter, 0 otherwise.
+ */
+int
+filter_letter(const struct filter *filter, const struct letter *letter)
+{
+	size_t t;
+
+	for (t = 0; t < filter->nterm; t++) {
+		if (!term_match(&filter->terms[t], letter))
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Parse text into filter.
+ * Values containing spaces can be double quoted, as in
+ * subject:"weekly report".
+ * Returns 0 on success and -1 if text is not a valid filter.
+ */
+int
+filter_parse(struct filter *filter, const char *text)
+{
+	const char *p;
+
+	filter->nterm = 0;
+	for (p = text;;) {
+		struct filter_term *term;
+		const char *colon, *end, *value;
+		size_t i, len;
+
+		p += strspn(p, " \t");
+		if (*p == '\0')
+			break;
+
+		if (filter->nterm == FILTER_TERM_MAX)
+			return -1;
+		term = &filter->terms[filter->nterm];
+
+		term->negate = 0;
+		if (*p == '!') {
+			term->negate = 1;
+			p++;
+		}
+
+		if ((colon = strchr(p, ':')) == NULL)
+			return -1;
+		for (i = 0; i < nitems(fields); i++) {
+			len = strlen(fields[i].name);
+			if ((size_t)(colon - p) == len &&
+			    !strncmp(p, fields[i].name, len))
+				break;
+		}
+		if (i == nitems(fields))
+			return -1;
+		term->field = fields[i].field;
+
+		value = colon + 1;
+		if (*value == '"') {
+			value++;
+			if ((end = strchr(value, '"')) == NULL)
+				return -1;
+			p = end + 1;
+			if (*p != '\0' && *p != ' ' && *p != '\t')
+				return -1;
+		}
+		else {
+			end = value + strcspn(value, " \t");
+			p = end;
+		}
+
+		len = end - value;
+		if (len == 0 || len >= sizeof(term->text))
+			return -1;
+		memcpy(term->text, value, len);
+		term->text[len] = '\0';
+
+		if (term->field == FILTER_BEFORE || term->field == FILTER_SINCE) {
+			if (filter_date(term->text, &term->date) == -1)
+				return -1;
+		}
+
+		filter->nterm++;
+	}
+
+	if (filter->nterm == 0)
+		return -1;
+	return 0;
+}
+
+/*
+ * Set match[i] to 1 for each letter of mailbox matched by filter and to
+ * 0 for the others, returning the number of letters matched.
+ * match must have mailbox->nletter elements.
+ */
+size_t
+filter_run(const struct filter *filter, const struct mailbox *mailbox,
+	unsigned char *match)
+{
+	size_t i, n, t;
+
+	memset(match, 1, mailbox->nletter);
+
+	for (t = 0; t < filter->nterm; t++) {
+		const struct filter_term *term;
+
+		term = &filter->terms[t];
+		for (i = 0; i < mailbox->nletter; i++) {
+			if (match[i] &&
+			    !term_match(term, &mailbox->letters[i]))
+				match[i] = 0;
+		}
+	}
+
+	for (i = 0, n = 0; i < mailbox->nletter; i++)
+		n += match[i];
+	return n;
+}
+
+static const char *
+letter_field(const struct letter *letter, enum filter_field field)
+{
+	switch (field) {
+	case FILTER_CC:
+		return letter->cc;
+	case FILTER_FROM:
+		return letter->from;
+	case FILTER_IN_REPLY_TO:
+		return letter->in_reply_to;
+	case FILTER_LIST_ID:
+		return letter->list_id;
+	case FILTER_MESSAGE_ID:
+		return letter->message_id;
+	case FILTER_SUBJECT:
+		return letter->subject;
+	case FILTER_TO:
+		return letter->to;
+	default:
+		return NULL;
+	}
+}
+
+static int
+term_match(const struct filter_term *term, const struct letter *letter)
+{
+	const char *field;
+	int v;
+
+	switch (term->field) {
+	case FILTER_BEFORE:
+		v = letter->date < term->date;
+		break;
+	case FILTER_SINCE:
+		v = letter->date >= term->date;
+		break;
+	default:
+		field = letter_field(letter, term->field);
+		v = field != NULL && strcasestr(field, term->text) != NULL;
+		break;
+	}
+
+	return v != term->negate;
+}
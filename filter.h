@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+struct letter;
+struct mailbox;
+
+#define FILTER_TERM_MAX 16
+#define FILTER_TEXT_LEN 256
+
+enum filter_field {
+	FILTER_BEFORE,
+	FILTER_CC,
+	FILTER_FROM,
+	FILTER_IN_REPLY_TO,
+	FILTER_LIST_ID,
+	FILTER_MESSAGE_ID,
+	FILTER_SINCE,
+	FILTER_SUBJECT,
+	FILTER_TO,
+};
+
+struct filter_term {
+	enum filter_field field;
+	int negate;
+	char text[FILTER_TEXT_LEN];
+	time_t date;
+};
+
+struct filter {
+	struct filter_term terms[FILTER_TERM_MAX];
+	size_t nterm;
+};
+
+int filter_fields(const struct filter *);
+int filter_letter(const struct filter *, const struct letter *);
+int filter_parse(struct filter *, const char *);
+size_t filter_run(const struct filter *, const struct mailbox *,
+	unsigned char *);
+
+#endif /* FILTER_H */
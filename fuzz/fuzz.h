@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef FUZZ_FUZZ_H
+#define FUZZ_FUZZ_H
+
+/*
+ * A parser driven over one input.
+ * If sum is not NULL the results are folded into it, so that two
+ * implementations can be checked to agree on a corpus.
+ */
+struct fuzz_target {
+	const char *name;
+	void (*fn)(const uint8_t *, size_t, uint64_t *);
+};
+
+#define FUZZ_SUM_INIT 0xcbf29ce484222325ULL
+
+const struct fuzz_target *fuzz_target(const char *);
+
+#endif /* FUZZ_FUZZ_H */
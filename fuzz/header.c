@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Fuzz targets for the parsers of header.c, shared by the libFuzzer
+ * and AFL drivers and by bench-corpus.
+ * Each reads the input as the body of a header field, as
+ * mailz-content does after header_name.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../header.h"
+#include "fuzz.h"
+
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+static void fuzz_address(const uint8_t *, size_t, uint64_t *);
+static void fuzz_content_type_var(const uint8_t *, size_t, uint64_t *);
+static void fuzz_date(const uint8_t *, size_t, uint64_t *);
+static void fuzz_lex(const uint8_t *, size_t, uint64_t *);
+static FILE *fuzz_open(const uint8_t *, size_t);
+static void fuzz_sum(uint64_t *, const char *, ...)
+	__attribute__((__format__(printf, 2, 3)));
+static void fuzz_sum_buf(uint64_t *, const char *, size_t);
+
+static const struct fuzz_target targets[] = {
+	{ "address",		fuzz_address },
+	{ "content-type-var",	fuzz_content_type_var },
+	{ "date",		fuzz_date },
+	{ "lex",		fuzz_lex },
+};
+
+static void
+fuzz_address(const uint8_t *data, size_t size, uint64_t *sum)
+{
+	struct header_address from;
+	FILE *fp;
+	char addr[255], name[256];
+	int eof, rv;
+
+	if ((fp = fuzz_open(data, size)) == NULL)
+		return;
+
+	from.addr = addr;
+	from.addrsz = sizeof(addr);
+	from.name = name;
+	from.namesz = sizeof(name);
+
+	eof = 0;
+	while ((rv = header_address(fp, &from, &eof)) == HEADER_OK) {
+		fuzz_sum_buf(sum, name, strlen(name));
+		fuzz_sum(sum, " <");
+		fuzz_sum_buf(sum, addr, strlen(addr));
+		fuzz_sum(sum, ">\n");
+	}
+	fuzz_sum(sum, "%d\n", rv);
+
+	fclose(fp);
+}
+
+/*
+ * The buffers are as small as those of mailz-content, so that
+ * truncation is exercised.
+ */
+static void
+fuzz_content_type_var(const uint8_t *data, size_t size, uint64_t *sum)
+{
+	struct content_type_var vt;
+	FILE *fp;
+	char var[8], val[11];
+	int eof, rv;
+
+	if ((fp = fuzz_open(data, size)) == NULL)
+		return;
+
+	vt.var = var;
+	vt.varsz = sizeof(var);
+	vt.val = val;
+	vt.valsz = sizeof(val);
+
+	eof = 0;
+	while ((rv = header_content_type_var(fp, NULL, &vt, &eof))
+	    == HEADER_OK) {
+		fuzz_sum(sum, "%d %d ", vt.var_trunc, vt.val_trunc);
+		fuzz_sum_buf(sum, var, strnlen(var, sizeof(var)));
+		fuzz_sum(sum, "=");
+		fuzz_sum_buf(sum, val, strnlen(val, sizeof(val)));
+		fuzz_sum(sum, "\n");
+	}
+	fuzz_sum(sum, "%d\n", rv);
+
+	fclose(fp);
+}
+
+static void
+fuzz_date(const uint8_t *data, size_t size, uint64_t *sum)
+{
+	FILE *fp;
+	time_t date;
+	int rv;
+
+	if ((fp = fuzz_open(data, size)) == NULL)
+		return;
+
+	if ((rv = header_date(fp, &date)) == HEADER_OK)
+		fuzz_sum(sum, "%lld\n", (long long)date);
+	fuzz_sum(sum, "%d\n", rv);
+
+	fclose(fp);
+}
+
+/*
+ * Lex the input both as structured text, skipping comments and quotes,
+ * and raw, echoing each.
+ */
+static void
+fuzz_lex(const uint8_t *data, size_t size, uint64_t *sum)
+{
+	size_t i;
+
+	for (i = 0; i < 2; i++) {
+		struct header_lex lex;
+		FILE *fp;
+		char *echo;
+		size_t echosz;
+		int ch;
+
+		if ((fp = fuzz_open(data, size)) == NULL)
+			return;
+		if ((lex.echo = open_memstream(&echo, &echosz)) == NULL) {
+			fclose(fp);
+			return;
+		}
+		lex.cstate = i == 0 ? 0 : -1;
+		lex.qstate = i == 0 ? 0 : -1;
+		lex.skipws = i == 0;
+
+		while ((ch = header_lex(fp, &lex)) >= 0)
+			fuzz_sum(sum, "%d ", ch);
+		fuzz_sum(sum, "%d\n", ch);
+
+		if (fclose(lex.echo) == 0) {
+			fuzz_sum_buf(sum, echo, echosz);
+			free(echo);
+		}
+		fclose(fp);
+	}
+}
+
+static FILE *
+fuzz_open(const uint8_t *data, size_t size)
+{
+	/* fmemopen(3) refuses empty buffers. */
+	if (size == 0)
+		return NULL;
+	return fmemopen((void *)data, size, "r");
+}
+
+static void
+fuzz_sum(uint64_t *sum, const char *fmt, ...)
+{
+	va_list ap;
+	char buf[64];
+	int n;
+
+	if (sum == NULL)
+		return;
+
+	va_start(ap, fmt);
+	n = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		abort();
+	if ((size_t)n >= sizeof(buf))
+		n = sizeof(buf) - 1;
+	fuzz_sum_buf(sum, buf, n);
+}
+
+/*
+ * FNV-1a.
+ */
+static void
+fuzz_sum_buf(uint64_t *sum, const char *buf, size_t len)
+{
+	size_t i;
+
+	if (sum == NULL)
+		return;
+
+	for (i = 0; i < len; i++) {
+		*sum ^= (unsigned char)buf[i];
+		*sum *= 0x100000001b3ULL;
+	}
+}
+
+const struct fuzz_target *
+fuzz_target(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < nitems(targets); i++) {
+		if (!strcmp(targets[i].name, name))
+			return &targets[i];
+	}
+	return NULL;
+}
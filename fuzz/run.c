@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Run a fuzz target over each file, or standard input, once.
+ * This is the driver for AFL, built with its compiler, and replays
+ * inputs found by either fuzzer.
+ */
+
+#include <err.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "fuzz.h"
+
+/* Longest input read, longer inputs are cut short. */
+#define FUZZ_INPUT_MAX (1024 * 1024)
+
+static int run(const struct fuzz_target *, int, uint8_t *);
+static void usage(void);
+
+static int
+run(const struct fuzz_target *target, int fd, uint8_t *buf)
+{
+	size_t len;
+	ssize_t n;
+
+	len = 0;
+	while (len < FUZZ_INPUT_MAX) {
+		if ((n = read(fd, buf + len, FUZZ_INPUT_MAX - len)) == -1)
+			return -1;
+		if (n == 0)
+			break;
+		len += n;
+	}
+
+	target->fn(buf, len, NULL);
+	return 0;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: fuzz-run target [file ...]\n");
+	exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct fuzz_target *target;
+	uint8_t *buf;
+	int fd, i;
+
+	if (argc < 2)
+		usage();
+
+	if (setlocale(LC_CTYPE, "C.UTF-8") == NULL)
+		errx(1, "setlocale");
+
+	if ((target = fuzz_target(argv[1])) == NULL)
+		errx(1, "unknown target: %s", argv[1]);
+	if ((buf = malloc(FUZZ_INPUT_MAX)) == NULL)
+		err(1, NULL);
+
+	if (argc == 2 && run(target, STDIN_FILENO, buf) == -1)
+		err(1, "stdin");
+	for (i = 2; i < argc; i++) {
+		if ((fd = open(argv[i], O_RDONLY | O_CLOEXEC)) == -1)
+			err(1, "%s", argv[i]);
+		if (run(target, fd, buf) == -1)
+			err(1, "%s", argv[i]);
+		close(fd);
+	}
+
+	free(buf);
+	return 0;
+}
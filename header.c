@@ -16,28 +16,235 @@
 
 #include <ctype.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <time.h>
 
 #include "header.h"
 
 #define nitems(a) (sizeof((a)) / sizeof(*(a)))
 
+static int date_number(const char *, long long, long long, long long *);
+static uint32_t date_pack(const char *);
 static long header_date_timezone(const char *);
 static long header_date_timezone_std(const char *, size_t);
-static long header_date_timezone_usa(const char *, size_t);
 static int header_token(FILE *, struct header_lex *, char *, size_t, int *);
+static int lex_state(const struct header_lex *);
 static size_t strip_trailing(const char *, size_t);
 
-static const char *days[] = {
-	"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat",
+/*
+ * Names of days, months and zones are matched as up to three bytes
+ * packed into an integer by date_pack.
+ */
+#define DATE_PACK(a, b, c) \
+	((uint32_t)(a) << 16 | (uint32_t)(b) << 8 | (uint32_t)(c))
+
+static const uint32_t days[] = {
+	DATE_PACK('S', 'u', 'n'), DATE_PACK('M', 'o', 'n'),
+	DATE_PACK('T', 'u', 'e'), DATE_PACK('W', 'e', 'd'),
+	DATE_PACK('T', 'h', 'u'), DATE_PACK('F', 'r', 'i'),
+	DATE_PACK('S', 'a', 't'),
+};
+static const uint32_t months[] = {
+	DATE_PACK('J', 'a', 'n'), DATE_PACK('F', 'e', 'b'),
+	DATE_PACK('M', 'a', 'r'), DATE_PACK('A', 'p', 'r'),
+	DATE_PACK('M', 'a', 'y'), DATE_PACK('J', 'u', 'n'),
+	DATE_PACK('J', 'u', 'l'), DATE_PACK('A', 'u', 'g'),
+	DATE_PACK('S', 'e', 'p'), DATE_PACK('O', 'c', 't'),
+	DATE_PACK('N', 'o', 'v'), DATE_PACK('D', 'e', 'c'),
+};
+
+/* Days in the months of a year before each, leap days aside. */
+static const int month_days[] = {
+	0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334,
+};
+
+/*
+ * Zones named in RFC 5322, in a perfect hash table indexed by
+ * DATE_ZONE_HASH of their packed name.
+ * Daylight time is taken to be an hour behind standard time, as
+ * mailz always has.
+ */
+#define DATE_ZONE_HASH(z) ((uint32_t)((z) * 18921U) >> 28)
+
+static const struct {
+	uint32_t name; /* 0 for an empty slot */
+	int hours;
+} zones[16] = {
+	[0] =	{ DATE_PACK('E', 'S', 'T'), -5 },
+	[2] =	{ DATE_PACK('P', 'D', 'T'), -9 },
+	[3] =	{ DATE_PACK('P', 'S', 'T'), -8 },
+	[4] =	{ DATE_PACK('M', 'D', 'T'), -8 },
+	[5] =	{ DATE_PACK('M', 'S', 'T'), -7 },
+	[6] =	{ DATE_PACK('C', 'D', 'T'), -7 },
+	[7] =	{ DATE_PACK('C', 'S', 'T'), -6 },
+	[9] =	{ DATE_PACK('G', 'M', 'T'), 0 },
+	[10] =	{ DATE_PACK('U', 'T', '\0'), 0 },
+	[15] =	{ DATE_PACK('E', 'D', 'T'), -6 },
+};
+
+/*
+ * The names of the fields of header_field, in a perfect hash table
+ * indexed by FIELD_HASH of the name, which ignores the case of
+ * letters. Its multipliers were found by trying each until no two
+ * names collided, and must be found again if a name is added.
+ */
+#define FIELD_HASH(s, len) \
+	(((len) + ((s)[0] | 0x20) * 4 + ((s)[(len) - 1] | 0x20)) & 31)
+
+static const struct {
+	const char *name; /* NULL for an empty slot */
+	enum header_field field;
+} fields[32] = {
+	[1] =	{ "to",			HEADER_FIELD_TO },
+	[2] =	{ "message-id",		HEADER_FIELD_MESSAGE_ID },
+	[5] =	{ "references",		HEADER_FIELD_REFERENCES },
+	[7] =	{ "subject",		HEADER_FIELD_SUBJECT },
+	[9] =	{ "from",		HEADER_FIELD_FROM },
+	[12] =	{ "content-transfer-encoding",
+		  HEADER_FIELD_CONTENT_TRANSFER_ENCODING },
+	[13] =	{ "content-disposition", HEADER_FIELD_CONTENT_DISPOSITION },
+	[17] =	{ "cc",			HEADER_FIELD_CC },
+	[25] =	{ "date",		HEADER_FIELD_DATE },
+	[27] =	{ "list-id",		HEADER_FIELD_LIST_ID },
+	[29] =	{ "content-type",	HEADER_FIELD_CONTENT_TYPE },
+	[30] =	{ "in-reply-to",	HEADER_FIELD_IN_REPLY_TO },
+	[31] =	{ "reply-to",		HEADER_FIELD_REPLY_TO },
 };
-static const char *months[] = {
-	"Jan", "Feb", "Mar", "Apr", "May", "Jun",
-	"Jul", "Aug", "Sep", "Oct", "Nov", "Dec",
+
+/*
+ * header_lex is a table driven state machine: each byte has a class,
+ * and the state of the lexer with the class of the byte decides what
+ * is done with it.
+ */
+enum {
+	LEX_CHAR,
+	LEX_WS,
+	LEX_NL,
+	LEX_OPEN,
+	LEX_CLOSE,
+	LEX_QUOTE,
+	LEX_NCLASS
 };
+#define LEX_CLASS 0x0f
+#define LEX_ECHO 0x10 /* echoed if header_lex.echo is set */
+
+#define X LEX_CHAR
+#define P (LEX_CHAR | LEX_ECHO)
+#define W (LEX_WS | LEX_ECHO)
+#define N LEX_NL
+#define O (LEX_OPEN | LEX_ECHO)
+#define C (LEX_CLOSE | LEX_ECHO)
+#define Q (LEX_QUOTE | LEX_ECHO)
+static const unsigned char lex_classes[256] = {
+	X, X, X, X, X, X, X, X, X, W, N, X, X, X, X, X,
+	X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	W, P, Q, P, P, P, P, P, O, C, P, P, P, P, P, P,
+	P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+	P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+	P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+	P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, P,
+	P, P, P, P, P, P, P, P, P, P, P, P, P, P, P, X,
+	X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+};
+#undef X
+#undef P
+#undef W
+#undef N
+#undef O
+#undef C
+#undef Q
+
+enum {
+	LEX_EMIT,	/* return the byte */
+	LEX_SKIP,	/* drop the byte */
+	LEX_BEGIN,	/* begin a comment */
+	LEX_END,	/* end a comment */
+	LEX_TOGGLE,	/* begin or end a quoted string */
+};
+
+/*
+ * Indexed by lex_state. Comments are disabled, outside one or inside
+ * one, quotes are disabled or enabled, and whitespace is kept or
+ * skipped.
+ */
+#define E LEX_EMIT
+#define S LEX_SKIP
+#define B LEX_BEGIN
+#define D LEX_END
+#define T LEX_TOGGLE
+static const unsigned char lex_actions[12][LEX_NCLASS] = {
+	/* CHAR WS NL OPEN CLOSE QUOTE */
+	{ E, E, E, E, E, E },
+	{ E, S, E, E, E, E },
+	{ E, E, E, E, E, T },
+	{ E, S, E, E, E, T },
+	{ E, E, E, B, E, E },
+	{ E, S, E, B, E, E },
+	{ E, E, E, B, E, T },
+	{ E, S, E, B, E, T },
+	{ S, S, S, B, D, S },
+	{ S, S, S, B, D, S },
+	{ S, S, S, B, D, S },
+	{ S, S, S, B, D, S },
+};
+#undef E
+#undef S
+#undef B
+#undef D
+#undef T
+
+/*
+ * Parse s as strtonum(3) does, without calling it for plain digits.
+ */
+static int
+date_number(const char *s, long long min, long long max, long long *np)
+{
+	const char *errstr;
+	long long n;
+	size_t i;
+
+	n = 0;
+	for (i = 0; s[i] >= '0' && s[i] <= '9' && i < 9; i++)
+		n = n * 10 + (s[i] - '0');
+
+	if (i == 0 || s[i] != '\0') {
+		n = strtonum(s, min, max, &errstr);
+		if (errstr != NULL)
+			return -1;
+	}
+	else if (n < min || n > max)
+		return -1;
+
+	*np = n;
+	return 0;
+}
+
+/*
+ * Pack a name of two or three bytes, returning 0 for any other.
+ */
+static uint32_t
+date_pack(const char *s)
+{
+	if (s[0] == '\0' || s[1] == '\0')
+		return 0;
+	if (s[2] == '\0')
+		return DATE_PACK((unsigned char)s[0], (unsigned char)s[1], 0);
+	if (s[3] != '\0')
+		return 0;
+	return DATE_PACK((unsigned char)s[0], (unsigned char)s[1],
+	    (unsigned char)s[2]);
+}
 
 int
 header_address(FILE *fp, struct header_address *from, int *eof)
@@ -307,12 +514,12 @@ int
 header_date(FILE *fp, time_t *dp)
 {
 	struct header_lex lex;
-	struct tm tm;
 	char buf[100], *bufp, *e, *s;
-	const char *errstr;
 	size_t i;
 	time_t date;
+	long long day, hour, min, mon, sec, year;
 	long off;
+	uint32_t name;
 	int eof;
 
 	lex.cstate = 0;
@@ -320,58 +527,51 @@ header_date(FILE *fp, time_t *dp)
 	lex.qstate = 0;
 	lex.skipws = 1;
 
-	memset(&tm, 0, sizeof(tm));
-
 	eof = 0;
 	if (header_token(fp, &lex, buf, sizeof(buf), &eof) != HEADER_OK)
 		return HEADER_INVALID;
 
+	/* The day of the week is optional, and not checked. */
 	if ((e = strchr(buf, ',')) != NULL) {
 		if (e[1] != '\0')
 			return HEADER_INVALID;
 		*e = '\0';
-		tm.tm_wday = -1;
+		name = date_pack(buf);
 		for (i = 0; i < nitems(days); i++) {
-			if (!strcmp(buf, days[i])) {
-				tm.tm_wday = i;
+			if (name == days[i])
 				break;
-			}
 		}
-		if (tm.tm_wday == -1)
+		if (i == nitems(days))
 			return HEADER_INVALID;
 
 		if (header_token(fp, &lex, buf, sizeof(buf), &eof) != HEADER_OK)
 			return HEADER_INVALID;
 	}
 
-	tm.tm_mday = strtonum(buf, 1, 31, &errstr);
-	if (errstr != NULL)
+	if (date_number(buf, 1, 31, &day) == -1)
 		return HEADER_INVALID;
 
 	if (header_token(fp, &lex, buf, sizeof(buf), &eof) != HEADER_OK)
 		return HEADER_INVALID;
 
-	tm.tm_mon = -1;
+	name = date_pack(buf);
 	for (i = 0; i < nitems(months); i++) {
-		if (!strcmp(buf, months[i])) {
-			tm.tm_mon = i;
+		if (name == months[i])
 			break;
-		}
 	}
-	if (tm.tm_mon == -1)
+	if (i == nitems(months))
 		return HEADER_INVALID;
+	mon = i;
 
 	if (header_token(fp, &lex, buf, sizeof(buf), &eof) != HEADER_OK)
 		return HEADER_INVALID;
 
-	tm.tm_year = strtonum(buf, 0, 9999, &errstr);
-	if (errstr != NULL)
+	if (date_number(buf, 0, 9999, &year) == -1)
 		return HEADER_INVALID;
-	if (tm.tm_year <= 49)
-		tm.tm_year += 2000;
-	else if (tm.tm_year <= 999)
-		tm.tm_year += 1900;
-	tm.tm_year -= 1900;
+	if (year <= 49)
+		year += 2000;
+	else if (year <= 999)
+		year += 1900;
 
 	if (header_token(fp, &lex, buf, sizeof(buf), &eof) != HEADER_OK)
 		return HEADER_INVALID;
@@ -380,19 +580,17 @@ header_date(FILE *fp, time_t *dp)
 
 	if ((s = strsep(&bufp, ":")) == NULL)
 		return HEADER_INVALID;
-	tm.tm_hour = strtonum(s, 0, 23, &errstr);
-	if (errstr != NULL)
+	if (date_number(s, 0, 23, &hour) == -1)
 		return HEADER_INVALID;
 
 	if ((s = strsep(&bufp, ":")) == NULL)
 		return HEADER_INVALID;
-	tm.tm_min = strtonum(s, 0, 59, &errstr);
-	if (errstr != NULL)
+	if (date_number(s, 0, 59, &min) == -1)
 		return HEADER_INVALID;
 
+	sec = 0;
 	if ((s = bufp) != NULL) {
-		tm.tm_sec = strtonum(s, 0, 60, &errstr);
-		if (errstr != NULL)
+		if (date_number(s, 0, 60, &sec) == -1)
 			return HEADER_INVALID;
 	}
 
@@ -404,7 +602,20 @@ header_date(FILE *fp, time_t *dp)
 	if (header_token(fp, &lex, buf, sizeof(buf), &eof) != HEADER_EOF)
 		return HEADER_INVALID;
 
-	if ((date = timegm(&tm)) == -1)
+	/*
+	 * Days since the epoch, as timegm(3) counts them. Days past the
+	 * end of the month and a leap second carry over the same way.
+	 */
+	date = (year - 1970) * 365
+	    + ((year - 1) / 4 - (year - 1) / 100 + (year - 1) / 400)
+	    - (1969 / 4 - 1969 / 100 + 1969 / 400)
+	    + month_days[mon] + day - 1;
+	if (mon > 1 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))
+		date++;
+	date = date * 24 * 60 * 60 + hour * 60 * 60 + min * 60 + sec;
+
+	/* timegm(3) cannot tell this date from failure. */
+	if (date == -1)
 		return HEADER_INVALID;
 
 	*dp = date - off;
@@ -414,18 +625,15 @@ header_date(FILE *fp, time_t *dp)
 static long
 header_date_timezone(const char *s)
 {
-	size_t len;
+	uint32_t name;
 	long rv;
 
-	len = strlen(s);
-
-	if ((rv = header_date_timezone_std(s, len)) != -1)
-		return rv;
-	if ((rv = header_date_timezone_usa(s, len)) != -1)
+	if ((rv = header_date_timezone_std(s, strlen(s))) != -1)
 		return rv;
 
-	if (!strcmp(s, "UT") || !strcmp(s, "GMT"))
-		return 0;
+	name = date_pack(s);
+	if (name != 0 && zones[DATE_ZONE_HASH(name)].name == name)
+		return zones[DATE_ZONE_HASH(name)].hours * 60 * 60;
 
 	return -1;
 }
@@ -433,69 +641,65 @@ header_date_timezone(const char *s)
 static long
 header_date_timezone_std(const char *s, size_t len)
 {
-	const char *errstr;
 	char nbuf[3];
-	long rv;
+	long long hr, min;
 
 	if (len != 5)
 		return -1;
 
 	memcpy(nbuf, &s[1], 2);
 	nbuf[2] = '\0';
-
-	rv = strtonum(nbuf, 0, 99, &errstr) * 60 * 60;
-	if (errstr != NULL)
+	if (date_number(nbuf, 0, 99, &hr) == -1)
 		return -1;
 
 	memcpy(nbuf, &s[3], 2);
 	nbuf[2] = '\0';
-
-	rv += strtonum(nbuf, 0, 59, &errstr) * 60;
-	if (errstr != NULL)
+	if (date_number(nbuf, 0, 59, &min) == -1)
 		return -1;
 
 	if (s[0] == '-')
-		rv = -rv;
+		return -(hr * 60 * 60 + min * 60);
 	else if (s[0] != '+')
 		return -1;
 
-	return rv;
+	return hr * 60 * 60 + min * 60;
 }
 
-static long
-header_date_timezone_usa(const char *s, size_t len)
+/*
+ * The disposition type of a Content-Disposition header, without its
+ * parameters.
+ * A type too long for buf is returned as the empty string.
+ */
+int
+header_disposition(FILE *fp, FILE *echo, char *buf, size_t bufsz)
 {
-	long hr;
-
-	if (len != 3)
-		return -1;
+	struct header_lex lex;
+	size_t n;
+	int ch, trunc;
 
-	switch (s[0]) {
-	case 'E':
-		hr = -5;
-		break;
-	case 'C':
-		hr = -6;
-		break;
-	case 'M':
-		hr = -7;
-		break;
-	case 'P':
-		hr = -8;
-		break;
-	default:
-		return -1;
-	}
+	if (bufsz == 0)
+		return HEADER_INVALID;
 
-	if (s[1] == 'D')
-		hr -= 1;
-	else if (s[1] != 'S')
-		return -1;
+	lex.cstate = 0;
+	lex.echo = echo;
+	lex.qstate = 0;
+	lex.skipws = 1;
 
-	if (s[2] != 'T')
-		return -1;
+	n = 0;
+	trunc = 0;
+	while ((ch = header_lex(fp, &lex)) != HEADER_EOF && ch != ';') {
+		if (ch < 0)
+			return ch;
+		if (n == bufsz - 1)
+			trunc = 1;
+		else
+			buf[n++] = ch;
+	}
+	buf[trunc ? 0 : n] = '\0';
 
-	return hr * 60 * 60;
+	if (ch == ';')
+		return header_skip(fp, echo);
+	return HEADER_OK;
 }
 
 int
@@ -525,6 +729,26 @@ header_encoding(FILE *fp, FILE *echo, char *buf, size_t bufsz)
 	return HEADER_OK;
 }
 
+/*
+ * Return the HEADER_FIELD_* named by name, ignoring case, or
+ * HEADER_FIELD_OTHER if it is not one of them.
+ */
+int
+header_field(const char *name)
+{
+	const unsigned char *s;
+	size_t i, len;
+
+	if ((len = strlen(name)) == 0)
+		return HEADER_FIELD_OTHER;
+
+	s = (const unsigned char *)name;
+	i = FIELD_HASH(s, len);
+	if (fields[i].name == NULL || strcasecmp(fields[i].name, name) != 0)
+		return HEADER_FIELD_OTHER;
+	return fields[i].field;
+}
+
 int
 header_from(FILE *fp, struct header_address *from)
 {
@@ -544,56 +768,45 @@ int
 header_lex(FILE *fp, struct header_lex *lex)
 {
 	for (;;) {
-		int ch;
+		int ch, cls;
 
-		if ((ch = fgetc(fp)) == EOF)
+		if ((ch = getc_unlocked(fp)) == EOF)
 			goto eof;
-		if (ch == '\n') {
-			if ((ch = fgetc(fp)) == EOF)
+		cls = lex_classes[ch];
+		if ((cls & LEX_CLASS) == LEX_NL) {
+			if ((ch = getc_unlocked(fp)) == EOF)
 				goto eof;
-			if (ch != ' ' && ch != '\t') {
+			cls = lex_classes[ch];
+			if ((cls & LEX_CLASS) != LEX_WS) {
 				if (ungetc(ch, fp) == EOF)
 					return HEADER_INPUT;
 				goto eof;
 			}
 		}
 
-		if (lex->echo != NULL) {
-			if (isprint(ch) || ch == ' ' || ch == '\t') {
-				if (fputc(ch, lex->echo) == EOF)
-					return HEADER_OUTPUT;
-			}
-		}
-
-		if (lex->cstate != -1) {
-			if (ch == '(') {
-				if (lex->cstate == INT_MAX)
-					return HEADER_INVALID;
-				lex->cstate++;
-				continue;
-			}
-
-			if (lex->cstate > 0) {
-				if (ch == ')')
-					lex->cstate--;
-				continue;
-			}
-		}
-
-		if (lex->qstate != -1) {
-			if (ch == '\"') {
-				lex->qstate = !lex->qstate;
-				continue;
-			}
+		if (lex->echo != NULL && (cls & LEX_ECHO)) {
+			if (putc_unlocked(ch, lex->echo) == EOF)
+				return HEADER_OUTPUT;
 		}
 
-		if (lex->skipws) {
-			if (ch == ' ' || ch == '\t')
-				continue;
+		switch (lex_actions[lex_state(lex)][cls & LEX_CLASS]) {
+		case LEX_EMIT:
 			lex->skipws = 0;
+			return ch;
+		case LEX_SKIP:
+			break;
+		case LEX_BEGIN:
+			if (lex->cstate == INT_MAX)
+				return HEADER_INVALID;
+			lex->cstate++;
+			break;
+		case LEX_END:
+			lex->cstate--;
+			break;
+		case LEX_TOGGLE:
+			lex->qstate = !lex->qstate;
+			break;
 		}
-
-		return ch;
 	}
 
 	eof:
@@ -823,6 +1036,24 @@ header_token(FILE *fp, struct header_lex *lex, char *buf,
 	return HEADER_OK;
 }
 
+/*
+ * The row of lex_actions for the state of lex.
+ */
+static int
+lex_state(const struct header_lex *lex)
+{
+	int comment;
+
+	if (lex->cstate == -1)
+		comment = 0;
+	else if (lex->cstate == 0)
+		comment = 1;
+	else
+		comment = 2;
+
+	return (comment * 2 + (lex->qstate != -1)) * 2 + (lex->skipws != 0);
+}
+
 static size_t
 strip_trailing(const char *s, size_t n)
 {
@@ -39,13 +39,35 @@ struct header_lex {
 	FILE *echo;
 };
 
+/*
+ * Header fields known to header_field.
+ */
+enum header_field {
+	HEADER_FIELD_OTHER,
+	HEADER_FIELD_CC,
+	HEADER_FIELD_CONTENT_DISPOSITION,
+	HEADER_FIELD_CONTENT_TRANSFER_ENCODING,
+	HEADER_FIELD_CONTENT_TYPE,
+	HEADER_FIELD_DATE,
+	HEADER_FIELD_FROM,
+	HEADER_FIELD_IN_REPLY_TO,
+	HEADER_FIELD_LIST_ID,
+	HEADER_FIELD_MESSAGE_ID,
+	HEADER_FIELD_REFERENCES,
+	HEADER_FIELD_REPLY_TO,
+	HEADER_FIELD_SUBJECT,
+	HEADER_FIELD_TO,
+};
+
 int header_address(FILE *, struct header_address *, int *);
 int header_content_type(FILE *, FILE *, struct content_type *, int *);
 int header_content_type_var(FILE *, FILE *, struct content_type_var *, int *);
 int header_copy(FILE *, FILE *);
 int header_copy_addresses(FILE *, FILE *, const char *, int *);
 int header_date(FILE *, time_t *);
+int header_disposition(FILE *, FILE *, char *, size_t);
 int header_encoding(FILE *, FILE *, char *, size_t);
+int header_field(const char *);
 int header_from(FILE *, struct header_address *);
 int header_name(FILE *, char *, size_t);
 int header_message_id(FILE *, char *, size_t);
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "ignore.h"
+
+static uint32_t ignore_hash(const char *);
+static size_t ignore_slot(const struct ignore *, const char *);
+static void ignore_view(struct ignore *);
+
+/*
+ * Compile the nheader names of headers into ignore.
+ * Repeated names are only stored once.
+ */
+int
+ignore_build(struct ignore *ignore, char *const *headers, size_t nheader,
+	int type)
+{
+	struct ignore_head head;
+	uint32_t *tab;
+	size_t i, j, len, strsz, tabsz;
+	char *buf, *str;
+
+	ignore_init(ignore);
+	ignore->type = type;
+	if (nheader == 0)
+		return 0;
+
+	strsz = 0;
+	for (i = 0; i < nheader; i++) {
+		len = strlen(headers[i]) + 1;
+		if (len > IGNORE_SET_MAX - strsz)
+			return -1;
+		strsz += len;
+	}
+
+	for (tabsz = 8; tabsz < nheader * 2; tabsz *= 2)
+		if (tabsz > IGNORE_SET_MAX / sizeof(*tab))
+			return -1;
+	if (sizeof(head) + tabsz * sizeof(*tab) > IGNORE_SET_MAX - strsz)
+		return -1;
+
+	ignore->bufsz = sizeof(head) + tabsz * sizeof(*tab) + strsz;
+	if ((ignore->buf = calloc(1, ignore->bufsz)) == NULL)
+		return -1;
+	buf = ignore->buf;
+
+	ignore->tabsz = tabsz;
+	ignore->tab = tab = (uint32_t *)(buf + sizeof(head));
+	ignore->str = str = buf + sizeof(head) + tabsz * sizeof(*tab);
+
+	strsz = 0;
+	for (i = 0; i < nheader; i++) {
+		if (tab[j = ignore_slot(ignore, headers[i])] != 0)
+			continue;
+		len = strlen(headers[i]) + 1;
+		memcpy(str + strsz, headers[i], len);
+		tab[j] = strsz + 1;
+		ignore->strsz = strsz += len;
+	}
+
+	head.type = type;
+	head.tabsz = tabsz;
+	head.strsz = strsz;
+	memcpy(buf, &head, sizeof(head));
+	ignore->bufsz = sizeof(head) + tabsz * sizeof(*tab) + strsz;
+	return 0;
+}
+
+void
+ignore_free(struct ignore *ignore)
+{
+	free(ignore->buf);
+	ignore_init(ignore);
+}
+
+/*
+ * FNV-1a of name, ignoring case.
+ */
+static uint32_t
+ignore_hash(const char *name)
+{
+	uint32_t h;
+
+	h = 2166136261U;
+	for (; *name != '\0'; name++) {
+		h ^= tolower((unsigned char)*name);
+		h *= 16777619U;
+	}
+	return h;
+}
+
+/*
+ * An empty set, which neither ignores nor retains anything.
+ */
+void
+ignore_init(struct ignore *ignore)
+{
+	memset(ignore, 0, sizeof(*ignore));
+	ignore->type = IGNORE_IGNORE;
+}
+
+/*
+ * Use the compiled set buf, which is bufsz bytes long, in place.
+ * On success ignore takes ownership of buf, which must have been
+ * allocated with malloc and be suitably aligned for a uint32_t.
+ */
+int
+ignore_load(struct ignore *ignore, void *buf, size_t bufsz)
+{
+	struct ignore_head head;
+	const uint32_t *tab;
+	const char *str;
+	size_t i, nfree;
+
+	if (bufsz < sizeof(head) || bufsz > IGNORE_SET_MAX)
+		return -1;
+	memcpy(&head, buf, sizeof(head));
+
+	if (head.type != IGNORE_IGNORE && head.type != IGNORE_RETAIN)
+		return -1;
+	if (head.tabsz == 0 || (head.tabsz & (head.tabsz - 1)) != 0)
+		return -1;
+	if (head.tabsz > (bufsz - sizeof(head)) / sizeof(*tab))
+		return -1;
+	if (bufsz - sizeof(head) - head.tabsz * sizeof(*tab) != head.strsz)
+		return -1;
+
+	tab = (const uint32_t *)((char *)buf + sizeof(head));
+	str = (const char *)(tab + head.tabsz);
+	if (head.strsz == 0 || str[head.strsz - 1] != '\0')
+		return -1;
+
+	/* An empty slot ends every probe. */
+	nfree = 0;
+	for (i = 0; i < head.tabsz; i++) {
+		if (tab[i] == 0)
+			nfree++;
+		else if (tab[i] > head.strsz)
+			return -1;
+	}
+	if (nfree == 0)
+		return -1;
+
+	ignore_free(ignore);
+	ignore->buf = buf;
+	ignore->bufsz = bufsz;
+	ignore->type = head.type;
+	ignore_view(ignore);
+	return 0;
+}
+
+/*
+ * Whether the header name should be hidden.
+ */
+int
+ignore_match(const struct ignore *ignore, const char *name)
+{
+	int found;
+
+	if (ignore->tabsz == 0)
+		return 0;
+
+	found = ignore->tab[ignore_slot(ignore, name)] != 0;
+	if (ignore->type == IGNORE_RETAIN)
+		return !found;
+	return found;
+}
+
+/*
+ * The slot holding name, or the empty slot where it would go.
+ */
+static size_t
+ignore_slot(const struct ignore *ignore, const char *name)
+{
+	size_t i, mask;
+
+	mask = ignore->tabsz - 1;
+	for (i = ignore_hash(name) & mask;; i = (i + 1) & mask) {
+		if (ignore->tab[i] == 0)
+			return i;
+		if (!strcasecmp(ignore->str + ignore->tab[i] - 1, name))
+			return i;
+	}
+}
+
+/*
+ * Point the table and names of ignore into its buffer.
+ */
+static void
+ignore_view(struct ignore *ignore)
+{
+	struct ignore_head head;
+	char *buf;
+
+	buf = ignore->buf;
+	memcpy(&head, buf, sizeof(head));
+	ignore->tabsz = head.tabsz;
+	ignore->tab = (const uint32_t *)(buf + sizeof(head));
+	ignore->strsz = head.strsz;
+	ignore->str = buf + sizeof(head) + head.tabsz * sizeof(*ignore->tab);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef IGNORE_H
+#define IGNORE_H
+
+#define IGNORE_IGNORE 0
+#define IGNORE_RETAIN 1
+
+/* Largest compiled set mailz-content will accept. */
+#define IGNORE_SET_MAX (1024 * 1024)
+
+/*
+ * A set of header names to ignore or retain, compared ignoring case.
+ * It is compiled once by mailz into a single buffer holding a
+ * struct ignore_head, an open addressing hash table of tabsz string
+ * offsets plus one, and strsz bytes of NUL terminated names.
+ * mailz-content receives the buffer and uses it in place.
+ */
+struct ignore_head {
+	uint32_t type;
+	uint32_t tabsz; /* a power of two */
+	uint32_t strsz;
+};
+
+struct ignore {
+	void *buf;
+	size_t bufsz;
+	const uint32_t *tab;
+	size_t tabsz;
+	const char *str;
+	size_t strsz;
+	int type;
+};
+
+int ignore_build(struct ignore *, char *const *, size_t, int);
+void ignore_free(struct ignore *);
+void ignore_init(struct ignore *);
+int ignore_load(struct ignore *, void *, size_t);
+int ignore_match(const struct ignore *, const char *);
+
+#endif /* IGNORE_H */
@@ -2,11 +2,40 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <time.h>
 
 #include "mailbox.h"
 
+/*
+ * Bytes of text compared through a sort key before falling back to
+ * comparing the whole text.
+ */
+#define SORT_KEY_PREFIX 16
+
+/*
+ * The precomputed key a letter is sorted by, keys are compared by num,
+ * then by text and then by the index of the letter.
+ */
+struct sort_key {
+	long long num;
+	char prefix[SORT_KEY_PREFIX]; /* lowercase, NUL padded */
+	const char *text;
+	size_t idx;
+};
+
 static int letter_date_cmp(const void *, const void *);
+static int letter_dup(char **, const char *);
+static void letter_free(struct letter *);
+static int merge_before(const struct mailbox *, const size_t *, size_t,
+			size_t);
+static void merge_sift(const struct mailbox *, const size_t *, size_t *,
+		       size_t, size_t);
+static int sort_key_cmp(const void *, const void *);
+static int sort_key_text_cmp(const struct sort_key *,
+			     const struct sort_key *);
+static void sort_key_text(struct sort_key *, const char *);
+static const char *subject_base(const char *);
 
 static int
 letter_date_cmp(const void *one, const void *two)
@@ -24,6 +53,142 @@ letter_date_cmp(const void *one, const void *two)
 		return -1;
 }
 
+static int
+letter_dup(char **dst, const char *src)
+{
+	if (src == NULL) {
+		*dst = NULL;
+		return 0;
+	}
+	if ((*dst = strdup(src)) == NULL)
+		return -1;
+	return 0;
+}
+
+static void
+letter_free(struct letter *letter)
+{
+	free(letter->cc);
+	free(letter->from);
+	free(letter->in_reply_to);
+	free(letter->list_id);
+	free(letter->message_id);
+	free(letter->path);
+	free(letter->subject);
+	free(letter->to);
+}
+
+/*
+ * Whether the next letter of box one comes before the next letter of
+ * box two, letters with the same date are taken from the first box.
+ */
+static int
+merge_before(const struct mailbox *boxes, const size_t *pos, size_t one,
+	     size_t two)
+{
+	time_t d1, d2;
+
+	d1 = boxes[one].letters[pos[one]].date;
+	d2 = boxes[two].letters[pos[two]].date;
+
+	if (d1 != d2)
+		return d1 < d2;
+	return one < two;
+}
+
+/*
+ * Move the box at heap[i] down until neither of its children comes
+ * before it.
+ */
+static void
+merge_sift(const struct mailbox *boxes, const size_t *pos, size_t *heap,
+	   size_t nheap, size_t i)
+{
+	size_t child, tmp;
+
+	while ((child = 2 * i + 1) < nheap) {
+		if (child + 1 < nheap &&
+		    merge_before(boxes, pos, heap[child + 1], heap[child]))
+			child++;
+		if (!merge_before(boxes, pos, heap[child], heap[i]))
+			break;
+		tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+		i = child;
+	}
+}
+
+static int
+sort_key_cmp(const void *one, const void *two)
+{
+	const struct sort_key *k1, *k2;
+	int rv;
+
+	k1 = one;
+	k2 = two;
+
+	if (k1->num != k2->num)
+		return k1->num < k2->num ? -1 : 1;
+	if ((rv = sort_key_text_cmp(k1, k2)) != 0)
+		return rv;
+	if (k1->idx != k2->idx)
+		return k1->idx < k2->idx ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Compare the text of two keys ignoring case, only looking past the
+ * prefix when both prefixes are full and equal.
+ */
+static int
+sort_key_text_cmp(const struct sort_key *k1, const struct sort_key *k2)
+{
+	int rv;
+
+	if ((rv = memcmp(k1->prefix, k2->prefix, sizeof(k1->prefix))) != 0)
+		return rv;
+	if (k1->prefix[SORT_KEY_PREFIX - 1] == '\0')
+		return 0;
+	return strcasecmp(k1->text, k2->text);
+}
+
+static void
+sort_key_text(struct sort_key *key, const char *text)
+{
+	size_t i;
+
+	key->text = text;
+	if (text == NULL)
+		return;
+
+	for (i = 0; i < sizeof(key->prefix) && text[i] != '\0'; i++) {
+		int ch;
+
+		ch = (unsigned char)text[i];
+		if (ch >= 'A' && ch <= 'Z')
+			ch += 'a' - 'A';
+		key->prefix[i] = ch;
+	}
+}
+
+/*
+ * Returns subject without any leading "Re:", or NULL if subject is NULL.
+ */
+static const char *
+subject_base(const char *subject)
+{
+	if (subject == NULL)
+		return NULL;
+
+	for (;;) {
+		subject += strspn(subject, " \t");
+		if (strncasecmp(subject, "re:", 3) != 0)
+			return subject;
+		subject += 3;
+	}
+}
+
 /*
  * Add a letter to the mailbox.
  * Returns 0 on success, returns -1 and sets errno on faillure.
@@ -35,38 +200,45 @@ mailbox_add_letter(struct mailbox *mailbox, struct letter *letter)
 {
 	struct letter copy, *letters;
 
+	memset(&copy, 0, sizeof(copy));
+	copy.box = letter->box;
 	copy.date = letter->date;
+	copy.size = letter->size;
 	if ((copy.from = strdup(letter->from)) == NULL)
-		return -1;
+		goto copy;
 	if ((copy.path = strdup(letter->path)) == NULL)
-		goto from;
-	if (letter->subject != NULL) {
-		if ((copy.subject = strdup(letter->subject)) == NULL)
-			goto path;
-	}
-	else
-		copy.subject = NULL;
+		goto copy;
+	if (letter_dup(&copy.cc, letter->cc) == -1)
+		goto copy;
+	if (letter_dup(&copy.in_reply_to, letter->in_reply_to) == -1)
+		goto copy;
+	if (letter_dup(&copy.list_id, letter->list_id) == -1)
+		goto copy;
+	if (letter_dup(&copy.message_id, letter->message_id) == -1)
+		goto copy;
+	if (letter_dup(&copy.subject, letter->subject) == -1)
+		goto copy;
+	if (letter_dup(&copy.to, letter->to) == -1)
+		goto copy;
 
 	if (mailbox->nletter == SIZE_MAX) {
 		errno = ENOMEM;
-		goto subject;
+		goto copy;
 	}
 	letters = reallocarray(mailbox->letters, mailbox->nletter + 1,
 			       sizeof(*mailbox->letters));
 	if (letters == NULL)
-		goto subject;
+		goto copy;
 
 	mailbox->letters = letters;
 	mailbox->letters[mailbox->nletter++] = copy;
+	if (mailbox->order == NULL)
+		mailbox->nshown = mailbox->nletter;
 
 	return 0;
 
-	subject:
-	free(copy.subject);
-	path:
-	free(copy.path);
-	from:
-	free(copy.from);
+	copy:
+	letter_free(&copy);
 	return -1;
 }
 
@@ -79,12 +251,22 @@ mailbox_free(struct mailbox *mailbox)
 {
 	size_t i;
 
-	for (i = 0; i < mailbox->nletter; i++) {
-		free(mailbox->letters[i].from);
-		free(mailbox->letters[i].path);
-		free(mailbox->letters[i].subject);
-	}
+	for (i = 0; i < mailbox->nletter; i++)
+		letter_free(&mailbox->letters[i]);
 	free(mailbox->letters);
+	free(mailbox->order);
+	free(mailbox->rank);
+}
+
+/*
+ * Returns the index in mailbox->letters of the letter at position n of
+ * the display order.
+ * If n is not less than mailbox->nshown the behaviour is undefined.
+ */
+size_t
+mailbox_index(const struct mailbox *mailbox, size_t n)
+{
+	return mailbox->order == NULL ? n : mailbox->order[n];
 }
 
 /*
@@ -95,8 +277,283 @@ mailbox_free(struct mailbox *mailbox)
 void
 mailbox_init(struct mailbox *mailbox)
 {
+	mailbox->box = -1;
+	mailbox->fields = 0;
 	mailbox->letters = NULL;
 	mailbox->nletter = 0;
+	mailbox->nshown = 0;
+	mailbox->order = NULL;
+	mailbox->rank = NULL;
+	mailbox->reverse = 0;
+	mailbox->sort = MAILBOX_ORDER_DATE;
+}
+
+/*
+ * Remove every letter of mailbox for which keep is zero, keeping the
+ * order of the others.
+ * The display order goes back to every letter by date.
+ * keep must have mailbox->nletter elements.
+ */
+void
+mailbox_keep(struct mailbox *mailbox, const unsigned char *keep)
+{
+	size_t i, n;
+
+	free(mailbox->order);
+	free(mailbox->rank);
+	mailbox->box = -1;
+	mailbox->order = NULL;
+	mailbox->rank = NULL;
+	mailbox->reverse = 0;
+	mailbox->sort = MAILBOX_ORDER_DATE;
+
+	for (i = 0, n = 0; i < mailbox->nletter; i++) {
+		if (!keep[i]) {
+			letter_free(&mailbox->letters[i]);
+			continue;
+		}
+		mailbox->letters[n++] = mailbox->letters[i];
+	}
+	mailbox->nletter = n;
+	mailbox->nshown = n;
+}
+
+/*
+ * Move the letters of each of the nbox mailboxes in boxes, which must
+ * each be sorted by date, into the empty mailbox so that it is sorted
+ * by date, without sorting it again.
+ * The letters of each box keep their order, so the nth letter of a box
+ * is the nth letter in mailbox from that box.
+ * The mailboxes in boxes are left empty.
+ * Returns 0 on success, returns -1 and sets errno on failure.
+ */
+int
+mailbox_merge(struct mailbox *mailbox, struct mailbox *boxes, size_t nbox)
+{
+	struct letter *letters;
+	size_t *heap, i, n, nheap, nletter, *pos;
+
+	for (i = 0, nletter = 0; i < nbox; i++) {
+		if (boxes[i].nletter > SIZE_MAX - nletter) {
+			errno = ENOMEM;
+			return -1;
+		}
+		nletter += boxes[i].nletter;
+	}
+	if (nletter == 0)
+		return 0;
+
+	if ((letters = reallocarray(NULL, nletter, sizeof(*letters))) == NULL)
+		return -1;
+	if ((heap = reallocarray(NULL, nbox, sizeof(*heap))) == NULL) {
+		free(letters);
+		return -1;
+	}
+	if ((pos = calloc(nbox, sizeof(*pos))) == NULL) {
+		free(heap);
+		free(letters);
+		return -1;
+	}
+
+	for (i = 0, nheap = 0; i < nbox; i++) {
+		if (boxes[i].nletter != 0)
+			heap[nheap++] = i;
+	}
+	for (i = nheap / 2; i-- > 0;)
+		merge_sift(boxes, pos, heap, nheap, i);
+
+	for (n = 0; n < nletter; n++) {
+		i = heap[0];
+		letters[n] = boxes[i].letters[pos[i]++];
+		if (pos[i] == boxes[i].nletter)
+			heap[0] = heap[--nheap];
+		merge_sift(boxes, pos, heap, nheap, 0);
+	}
+
+	for (i = 0; i < nbox; i++) {
+		free(boxes[i].letters);
+		boxes[i].letters = NULL;
+		boxes[i].nletter = 0;
+		boxes[i].nshown = 0;
+	}
+	free(pos);
+	free(heap);
+
+	mailbox->letters = letters;
+	mailbox->nletter = nletter;
+	if (mailbox->order == NULL)
+		mailbox->nshown = nletter;
+	return 0;
+}
+
+/*
+ * Set the display order of mailbox, reversed if reverse is non-zero.
+ * Only the display order changes, mailbox->letters stays sorted by date.
+ * Sorting by size requires LETTER_SIZE to have been read.
+ * Returns 0 on success, returns -1 and sets errno on failure.
+ */
+int
+mailbox_order(struct mailbox *mailbox, enum mailbox_order order, int reverse)
+{
+	struct sort_key *keys;
+	size_t i, j, k, n, nkey, *perm, *rank;
+
+	if (order == MAILBOX_ORDER_DATE && !reverse && mailbox->box == -1) {
+		free(mailbox->order);
+		free(mailbox->rank);
+		mailbox->order = NULL;
+		mailbox->rank = NULL;
+		mailbox->nshown = mailbox->nletter;
+		mailbox->reverse = reverse;
+		mailbox->sort = order;
+		return 0;
+	}
+
+	/* avoid zero sized allocations */
+	n = mailbox->nletter == 0 ? 1 : mailbox->nletter;
+
+	if ((keys = reallocarray(NULL, n, sizeof(*keys))) == NULL)
+		return -1;
+	if ((perm = reallocarray(NULL, n, sizeof(*perm))) == NULL) {
+		free(keys);
+		return -1;
+	}
+	if ((rank = reallocarray(NULL, n, sizeof(*rank))) == NULL) {
+		free(keys);
+		free(perm);
+		return -1;
+	}
+
+	nkey = 0;
+	for (i = 0; i < mailbox->nletter; i++) {
+		struct letter *letter;
+		struct sort_key *key;
+
+		rank[i] = SIZE_MAX;
+
+		letter = &mailbox->letters[i];
+		if (mailbox->box != -1 && letter->box != mailbox->box)
+			continue;
+
+		key = &keys[nkey++];
+		memset(key, 0, sizeof(*key));
+		key->idx = i;
+
+		switch (order) {
+		case MAILBOX_ORDER_DATE:
+			key->num = letter->date;
+			break;
+		case MAILBOX_ORDER_FROM:
+			sort_key_text(key, letter->from);
+			break;
+		case MAILBOX_ORDER_SIZE:
+			key->num = letter->size;
+			break;
+		case MAILBOX_ORDER_SUBJECT:
+		case MAILBOX_ORDER_THREAD:
+			sort_key_text(key, subject_base(letter->subject));
+			break;
+		}
+	}
+
+	qsort(keys, nkey, sizeof(*keys), sort_key_cmp);
+
+	/*
+	 * The letters of each thread are now together and by date, so
+	 * sort again with each thread keyed by the date of its first
+	 * letter.
+	 * Letters without a subject are threads of their own.
+	 */
+	if (order == MAILBOX_ORDER_THREAD) {
+		for (i = 0; i < nkey; i = j) {
+			for (j = i + 1; j < nkey; j++) {
+				if (keys[i].text == NULL
+				    || keys[j].text == NULL
+				    || sort_key_text_cmp(&keys[i], &keys[j]) != 0)
+					break;
+			}
+			for (k = i; k < j; k++)
+				keys[k].num = mailbox->letters[keys[i].idx].date;
+		}
+		qsort(keys, nkey, sizeof(*keys), sort_key_cmp);
+	}
+
+	for (i = 0; i < nkey; i++) {
+		j = reverse ? nkey - 1 - i : i;
+		perm[j] = keys[i].idx;
+		rank[keys[i].idx] = j;
+	}
+	free(keys);
+
+	free(mailbox->order);
+	free(mailbox->rank);
+	mailbox->nshown = nkey;
+	mailbox->order = perm;
+	mailbox->rank = rank;
+	mailbox->reverse = reverse;
+	mailbox->sort = order;
+	return 0;
+}
+
+/*
+ * Returns the position in the display order of the letter at index idx
+ * of mailbox->letters, or SIZE_MAX if the letter is not shown.
+ */
+size_t
+mailbox_rank(const struct mailbox *mailbox, size_t idx)
+{
+	return mailbox->rank == NULL ? idx : mailbox->rank[idx];
+}
+
+/*
+ * Add the letter at index idx of mailbox->letters to set.
+ * Letters already in the set are ignored, so the set keeps the order
+ * in which letters were first added.
+ * If idx is not less than the nletter given to mailbox_set_init the
+ * behaviour is undefined.
+ */
+void
+mailbox_set_add(struct mailbox_set *set, size_t idx)
+{
+	if (set->member[idx])
+		return;
+	set->member[idx] = 1;
+	set->idx[set->nidx++] = idx;
+}
+
+/*
+ * Frees the memory associated with set.
+ */
+void
+mailbox_set_free(struct mailbox_set *set)
+{
+	free(set->idx);
+	free(set->member);
+}
+
+/*
+ * Initialize an empty set able to hold every letter of mailbox.
+ * Returns 0 on success, returns -1 and sets errno on failure.
+ * Can fail and set errno for any of the reasons specified by calloc(3)
+ * and reallocarray(3).
+ */
+int
+mailbox_set_init(struct mailbox *mailbox, struct mailbox_set *set)
+{
+	size_t n;
+
+	/* avoid zero sized allocations */
+	n = mailbox->nletter == 0 ? 1 : mailbox->nletter;
+
+	if ((set->idx = reallocarray(NULL, n, sizeof(*set->idx))) == NULL)
+		return -1;
+	if ((set->member = calloc(n, sizeof(*set->member))) == NULL) {
+		free(set->idx);
+		return -1;
+	}
+	set->nidx = 0;
+
+	return 0;
 }
 
 /*
@@ -176,3 +633,22 @@ mailbox_thread_next(struct mailbox *mailbox,
 
 	return NULL;
 }
+
+/*
+ * Only show the letters of mailbox whose box is box, or every letter if
+ * box is -1, keeping the current display order.
+ * Returns 0 on success, returns -1 and sets errno on failure.
+ */
+int
+mailbox_view(struct mailbox *mailbox, int box)
+{
+	int obox;
+
+	obox = mailbox->box;
+	mailbox->box = box;
+	if (mailbox_order(mailbox, mailbox->sort, mailbox->reverse) == -1) {
+		mailbox->box = obox;
+		return -1;
+	}
+	return 0;
+}
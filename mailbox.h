@@ -2,15 +2,54 @@
 #define MAILBOX_H
 
 struct letter {
+	char *cc;
 	char *from;
+	char *in_reply_to;
+	char *list_id;
+	char *message_id;
 	char *path;
 	char *subject;
+	char *to;
 	time_t date;
+	off_t size; /* -1 if not read */
+	int box; /* the maildir the letter was read from */
+};
+
+/*
+ * Optional fields of a letter, NULL if the letter does not have them
+ * or if they were not read.
+ */
+#define LETTER_CC 0x01
+#define LETTER_IN_REPLY_TO 0x02
+#define LETTER_LIST_ID 0x04
+#define LETTER_MESSAGE_ID 0x08
+#define LETTER_SIZE 0x10
+#define LETTER_TO 0x20
+
+enum mailbox_order {
+	MAILBOX_ORDER_DATE,
+	MAILBOX_ORDER_FROM,
+	MAILBOX_ORDER_SIZE,
+	MAILBOX_ORDER_SUBJECT,
+	MAILBOX_ORDER_THREAD,
 };
 
 struct mailbox {
-	struct letter *letters;
+	struct letter *letters; /* by date, ascending */
 	size_t nletter;
+	size_t *order; /* shown letters in display order, NULL if all by date */
+	size_t *rank; /* display position of each letter */
+	size_t nshown;
+	enum mailbox_order sort;
+	int reverse;
+	int box; /* only letters of this box are shown, -1 for all */
+	int fields; /* optional fields read for every letter */
+};
+
+struct mailbox_set {
+	size_t *idx;
+	size_t nidx;
+	unsigned char *member;
 };
 
 struct mailbox_thread {
@@ -22,11 +61,20 @@ struct mailbox_thread {
 
 int mailbox_add_letter(struct mailbox *, struct letter *);
 void mailbox_free(struct mailbox *);
+size_t mailbox_index(const struct mailbox *, size_t);
 void mailbox_init(struct mailbox *);
+void mailbox_keep(struct mailbox *, const unsigned char *);
+int mailbox_merge(struct mailbox *, struct mailbox *, size_t);
+int mailbox_order(struct mailbox *, enum mailbox_order, int);
+size_t mailbox_rank(const struct mailbox *, size_t);
+void mailbox_set_add(struct mailbox_set *, size_t);
+void mailbox_set_free(struct mailbox_set *);
+int mailbox_set_init(struct mailbox *, struct mailbox_set *);
 void mailbox_sort(struct mailbox *);
 void mailbox_thread_init(struct mailbox *, struct mailbox_thread *,
 			 struct letter *);
 struct letter *mailbox_thread_next(struct mailbox *,
 				   struct mailbox_thread *);
+int mailbox_view(struct mailbox *, int);
 
 #endif /* MAILBOX_H */
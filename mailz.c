@@ -23,83 +23,330 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <locale.h>
+#include <poll.h>
+#include <regex.h>
 #include <time.h>
 #include <signal.h>
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 
 #include "command.h"
 #include "conf.h"
 #include "content-proc.h"
 #include "err-fork.h"
+#include "filter.h"
+#include "ignore.h"
 #include "mailbox.h"
 #include "maildir.h"
+#include "output.h"
 #include "pathnames.h"
+#include "search.h"
+#include "stats.h"
+
+/*
+ * A maildir read into the session, letters refer to it by its index in
+ * command_args.boxes.
+ */
+struct box {
+	const char *ident;
+	const char *addr;
+	const char *maildir;
+	int root;
+	int cur;
+};
 
 struct command_args {
+	struct box *boxes;
+	size_t nbox;
 	const char *addr;
 	const char *maildir;
 	const char *tmpdir;
-	struct mailz_ignore *ignore;
+	const char *template;
+	size_t templatesz;
+	const struct ignore *ignore;
 	struct mailbox *mailbox;
+	struct content_proc pr;
+	int batch; /* no prompts, listing or confirmation */
+	int have_pr;
+	struct mailbox_set result;
+	int have_result;
+	const struct mailbox_set *set; /* the letters of a CMD_SET command */
+	struct search search;
+	struct timespec search_mtim;
+	int have_search;
+	const char *text;
 	int cur;
 };
 
+/*
+ * Letters listed by read_letters as they are read, instead of being
+ * kept in the mailbox.
+ */
+struct listing {
+	enum output_format format;
+	const struct filter *filter; /* NULL to list every letter */
+};
+
 #define nitems(a) (sizeof((a)) / sizeof(*(a)))
 
-static void commands_run(struct command_args *);
+/*
+ * Maximum number of summary requests in flight to mailz-content.
+ */
+#define SUMMARY_QUEUE 32
+
+/*
+ * Most mailz-content processes used by the grep command, and the
+ * number of requests in flight to each of them.
+ */
+#define GREP_WORKERS 8
+#define GREP_QUEUE 8
+
+/*
+ * Size of the buffers used to write exported letters.
+ */
+#define EXPORT_BUFSZ (64 * 1024)
+
+struct grep_worker {
+	struct content_proc pr;
+	size_t queue[GREP_QUEUE];
+	size_t head;
+	size_t nqueue;
+};
+
+/*
+ * Most mailz-content processes reading summaries at startup, each
+ * reading one maildir at a time.
+ */
+#define READ_WORKERS 8
+
+struct read_worker {
+	struct content_proc pr;
+	DIR *cur;
+	int curfd;
+	int box; /* -1 if idle */
+	int eof;
+	char *queue[SUMMARY_QUEUE];
+	size_t head;
+	size_t nqueue;
+};
+
+/*
+ * The letters which took mailz-content longest to summarize while
+ * reading the mailboxes, slowest first, kept in ~/.mailz/slow with -v.
+ */
+#define SLOW_LETTERS 32
+
+struct slow_letter {
+	uint64_t ns;
+	off_t parsed;
+	int box;
+	char *name;
+};
+
+struct slow_log {
+	struct slow_letter letters[SLOW_LETTERS];
+	size_t nletter;
+};
+
+static void box_close(struct box *);
+static int box_open(struct box *, struct mailz_conf *, char *);
+static void command_box(struct command_args *, int);
+static int commands_run(struct command_args *, FILE *);
 static const struct command *commands_search(const char *);
+static struct content_proc *command_content_proc(struct command_args *);
+static void command_content_proc_kill(struct command_args *);
 static int command_delete(struct letter *, struct command_args *);
+static int command_draft(struct letter *, struct command_args *);
+static int command_export(struct letter *, struct command_args *);
+static int command_export_dir(struct command_args *, const char *);
+static int command_export_letter(struct command_args *, struct content_proc *,
+	struct letter *, int, const char *);
+static int command_export_mbox(struct command_args *, const char *);
+static int command_filter(struct letter *, struct command_args *);
 static int command_flag(struct letter *, struct command_args *, int,
 			int);
+static int command_grep(struct letter *, struct command_args *);
+static int command_mailbox(struct letter *, struct command_args *);
 static int command_more(struct letter *, struct command_args *);
 static int command_read(struct letter *, struct command_args *);
 static int command_reply1(struct letter *, struct command_args *, int);
 static int command_reply(struct letter *, struct command_args *);
 static int command_respond(struct letter *, struct command_args *);
 static int command_save(struct letter *, struct command_args *);
+static int command_search(struct letter *, struct command_args *);
+static int command_search_index(struct command_args *, const char *);
+static int command_search_load(struct command_args *);
+static int command_search_match(struct command_args *, struct letter *,
+	const struct search_query *);
+static int command_search_path(struct command_args *, char *, size_t);
+static int command_search_save(struct command_args *);
+static int command_search_update(struct command_args *);
+static int command_send(struct letter *, struct command_args *);
+static int command_sort(struct letter *, struct command_args *);
 static int command_thread(struct letter *, struct command_args *);
 static int command_unread(struct letter *, struct command_args *);
-static int content_proc_ex_ignore(struct content_proc *,
-				  const struct mailz_ignore *);
-static int letter_print(size_t, struct letter *);
-static int read_letters(const char *, int, int, struct mailbox *);
+static int confirm(const char *, ...);
+static int letter_field(char **, const char *, int);
+static int letter_print(struct command_args *, struct letter *);
+static void letters_add(struct mailbox *, struct mailbox_set *, size_t,
+	int);
+static int letters_print(struct command_args *);
+static int letters_select(struct mailbox *, const struct mailbox_set *,
+	struct command_letter *, struct mailbox_set *);
+static int read_fields(struct command_args *, int);
+static int read_file(const char *, char **, size_t *);
+static int read_letters(struct box *, size_t, int, int, struct stats *,
+			struct slow_log *, const struct listing *,
+			struct mailbox *);
+static void read_worker_close(struct read_worker *);
+static int read_worker_fill(struct read_worker *, struct box *, int, int,
+	struct stats *);
+static int read_worker_open(struct read_worker *, struct box *, int);
+static int sendmail(int);
+static int slow_add(struct slow_log *, const struct content_summary *, int,
+	const char *);
+static void slow_free(struct slow_log *);
+static int slow_write(const struct slow_log *, const struct box *,
+	const char *);
+static int summary_conf(const struct mailz_conf *, int *);
+static int summary_mask(int);
 static void usage(void);
 
 static const struct command {
 	const char *ident;
 	#define CMD_NOALIAS '\0'
 	int alias;
+	#define CMD_NOLETTER 0x1
+	#define CMD_TEXT 0x2
+	#define CMD_TEXTOPT 0x4 /* the text can be left out */
+	#define CMD_SET 0x8 /* a word, then letters all passed in args->set */
+	int flags;
 	int (*fn) (struct letter *, struct command_args *);
 } commands[] = {
-	{ "delete",	CMD_NOALIAS,	command_delete },
-	{ "more",	CMD_NOALIAS,	command_more },
-	{ "read",	'r',		command_read },
-	{ "reply",	CMD_NOALIAS,	command_reply },
-	{ "respond",	CMD_NOALIAS,	command_respond },
-	{ "save",	's',		command_save },
-	{ "thread",	't',		command_thread },
-	{ "unread",	'x',		command_unread },
+	{ "delete",	CMD_NOALIAS,	0,		command_delete },
+	{ "draft",	CMD_NOALIAS,	0,		command_draft },
+	{ "export",	CMD_NOALIAS,	CMD_SET,	command_export },
+	{ "filter",	CMD_NOALIAS,	CMD_TEXT,	command_filter },
+	{ "grep",	CMD_NOALIAS,	CMD_TEXT,	command_grep },
+	{ "mailbox",	CMD_NOALIAS,	CMD_TEXT | CMD_TEXTOPT,	command_mailbox },
+	{ "more",	CMD_NOALIAS,	0,		command_more },
+	{ "read",	'r',		0,		command_read },
+	{ "reply",	CMD_NOALIAS,	0,		command_reply },
+	{ "respond",	CMD_NOALIAS,	0,		command_respond },
+	{ "save",	's',		0,		command_save },
+	{ "search",	CMD_NOALIAS,	CMD_TEXT,	command_search },
+	{ "send",	CMD_NOALIAS,	CMD_NOLETTER,	command_send },
+	{ "sort",	CMD_NOALIAS,	CMD_TEXT,	command_sort },
+	{ "thread",	't',		0,		command_thread },
+	{ "unread",	'x',		0,		command_unread },
+};
+
+/*
+ * Optional letter fields which can be read from a summary, by the
+ * names used for them in mailz.conf.
+ */
+static const struct {
+	const char *ident;
+	int letter;
+	int summary;
+} summary_fields[] = {
+	{ "cc",			LETTER_CC,		CNT_SUMMARY_CC },
+	{ "in-reply-to",	LETTER_IN_REPLY_TO,	CNT_SUMMARY_IN_REPLY_TO },
+	{ "list-id",		LETTER_LIST_ID,		CNT_SUMMARY_LIST_ID },
+	{ "message-id",		LETTER_MESSAGE_ID,	CNT_SUMMARY_MESSAGE_ID },
+	{ "size",		LETTER_SIZE,		CNT_SUMMARY_SIZE },
+	{ "to",			LETTER_TO,		CNT_SUMMARY_TO },
 };
 
 static void
-commands_run(struct command_args *args)
+box_close(struct box *box)
+{
+	close(box->cur);
+	close(box->root);
+}
+
+/*
+ * Open the maildir named by ident, either a mailbox from conf or a
+ * path.
+ */
+static int
+box_open(struct box *box, struct mailz_conf *conf, char *ident)
+{
+	struct mailz_conf_mailbox *conf_mailbox;
+	char *slash;
+
+	/*
+	 * Delete trailing slash to make error messages nicer.
+	 */
+	if ((slash = strrchr(ident, '/')) != NULL && slash[1] == '\0'
+	    && slash != ident)
+		*slash = '\0';
+
+	box->ident = ident;
+	if ((conf_mailbox = mailz_conf_mailbox(conf, ident)) != NULL) {
+		if (strlen(conf_mailbox->address) != 0)
+			box->addr = conf_mailbox->address;
+		else
+			box->addr = conf->address;
+		box->maildir = conf_mailbox->maildir;
+	}
+	else {
+		box->addr = conf->address;
+		box->maildir = ident;
+	}
+
+	if ((box->root = open(box->maildir,
+			      O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+		warn("%s", box->maildir);
+		return -1;
+	}
+	if ((box->cur = openat(box->root, "cur",
+			       O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+		warn("%s/cur", box->maildir);
+		close(box->root);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Make box the maildir used by the next command.
+ */
+static void
+command_box(struct command_args *args, int box)
+{
+	args->addr = args->boxes[box].addr;
+	args->cur = args->boxes[box].cur;
+	args->maildir = args->boxes[box].maildir;
+}
+
+static int
+commands_run(struct command_args *args, FILE *fp)
 {
 	struct command_lexer lex;
 	struct letter *letter;
+	int rv;
 
-	command_init(&lex, stdin);
+	command_init(&lex, fp);
 	letter = NULL;
+	rv = 0;
 	for (;;) {
 		const struct command *cmd;
-		char buf[8];
+		struct mailbox_set set;
+		size_t i;
+		char buf[8], word[NAME_MAX + 2];
 		int any, error;
 
-		printf("> ");
-		fflush(stdout);
+		if (!args->batch) {
+			printf("> ");
+			fflush(stdout);
+		}
 
 		error = command_name(&lex, buf, sizeof(buf));
 		if (error == COMMAND_EOF)
@@ -110,9 +357,11 @@ commands_run(struct command_args *args)
 				break;
 			case COMMAND_LONG:
 				warnx("command name too long");
+				rv = -1;
 				break;
 			default:
 				warnx("invalid command name");
+				rv = -1;
 				break;
 			}
 
@@ -121,6 +370,64 @@ commands_run(struct command_args *args)
 
 		if ((cmd = commands_search(buf)) == NULL) {
 			warnx("unknown command");
+			rv = -1;
+			continue;
+		}
+
+		if (cmd->flags & (CMD_NOLETTER | CMD_TEXT)) {
+			char text[1024];
+
+			if (cmd->flags & CMD_TEXT) {
+				switch (command_text(&lex, text, sizeof(text))) {
+				case COMMAND_OK:
+					args->text = text;
+					break;
+				case COMMAND_LONG:
+					warnx("command argument too long");
+					rv = -1;
+					continue;
+				default:
+					if (cmd->flags & CMD_TEXTOPT)
+						break;
+					warnx("command '%s' needs an argument",
+					      cmd->ident);
+					rv = -1;
+					continue;
+				}
+			}
+
+			command_box(args, args->mailbox->box == -1
+			    ? 0 : args->mailbox->box);
+
+			if (cmd->fn(NULL, args) == -1) {
+				warnx("command '%s' failed", cmd->ident);
+				rv = -1;
+			}
+			args->text = NULL;
+			command_content_proc_kill(args);
+			continue;
+		}
+
+		if (cmd->flags & CMD_SET) {
+			switch (command_word(&lex, word, sizeof(word))) {
+			case COMMAND_OK:
+				args->text = word;
+				break;
+			case COMMAND_LONG:
+				warnx("command argument too long");
+				rv = -1;
+				continue;
+			default:
+				warnx("command '%s' needs an argument",
+				      cmd->ident);
+				rv = -1;
+				continue;
+			}
+		}
+
+		if (mailbox_set_init(args->mailbox, &set) == -1) {
+			warn(NULL);
+			rv = -1;
 			continue;
 		}
 
@@ -135,60 +442,74 @@ commands_run(struct command_args *args)
 			if (error != COMMAND_OK) {
 				switch (error) {
 				case COMMAND_INVALID:
-					warnx("letter number invalid");
+					warnx("letter selector invalid");
 					break;
 				case COMMAND_LONG:
-					warnx("letter number too long");
+					warnx("letter selector too long");
 					break;
 				case COMMAND_THREAD_EOF:
 					warnx("must provide a message number after 't'");
 					break;
 				}
 
-				break;
-			}
-
-			/* These are numbered from 1, so no = */
-			if (cmd_letter.num > args->mailbox->nletter) {
-				warnx("letter number too large");
-				break;
+				rv = -1;
+				goto set;
 			}
-			letter = &args->mailbox->letters[cmd_letter.num - 1];
 
-			if (cmd_letter.thread) {
-				struct letter *lp;
-				struct mailbox_thread thread;
-
-				mailbox_thread_init(args->mailbox, &thread, letter);
-				while ((lp = mailbox_thread_next(args->mailbox, &thread)) != NULL) {
-					if (cmd->fn(lp, args) == -1) {
-						warnx("command '%s' failed", cmd->ident);
-						goto next;
-					}
-				}
-			}
-			else {
-				if (cmd->fn(letter, args) == -1) {
-					warnx("command '%s' failed", cmd->ident);
-					break;
-				}
+			if (letters_select(args->mailbox,
+			    args->have_result ? &args->result : NULL,
+			    &cmd_letter, &set) == -1) {
+				rv = -1;
+				goto set;
 			}
 		}
 
 		if (!any) {
 			if (letter == NULL) {
 				warnx("no current letter");
-				continue;
+				rv = -1;
+				goto set;
+			}
+			mailbox_set_add(&set, letter - args->mailbox->letters);
+		}
+		else if (set.nidx == 0) {
+			warnx("no matching letters");
+			rv = -1;
+		}
+
+		/* Set commands are run once for all of the letters. */
+		if (cmd->flags & CMD_SET) {
+			if (set.nidx == 0)
+				goto set;
+			letter = &args->mailbox->letters[set.idx[set.nidx - 1]];
+			args->set = &set;
+			if (cmd->fn(NULL, args) == -1) {
+				warnx("command '%s' failed", cmd->ident);
+				rv = -1;
 			}
-			if (cmd->fn(letter, args) == -1)
+			args->set = NULL;
+			goto set;
+		}
+
+		for (i = 0; i < set.nidx; i++) {
+			letter = &args->mailbox->letters[set.idx[i]];
+			command_box(args, letter->box);
+			if (cmd->fn(letter, args) == -1) {
 				warnx("command '%s' failed", cmd->ident);
+				rv = -1;
+				break;
+			}
 		}
 
-		next:
-		continue;
+		set:
+		mailbox_set_free(&set);
+		args->text = NULL;
+		command_content_proc_kill(args);
 	}
 
-	printf("\n");
+	if (!args->batch)
+		printf("\n");
+	return rv;
 }
 
 static const struct command *
@@ -211,299 +532,786 @@ command_delete(struct letter *letter, struct command_args *args)
 	return command_flag(letter, args, 'T', 1);
 }
 
-static int
-command_flag(struct letter *letter, struct command_args *args,
-	     int flag, int set)
+/*
+ * Get the content process shared by every letter of the current
+ * command, starting it if needed.
+ */
+static struct content_proc *
+command_content_proc(struct command_args *args)
 {
-	char buf[NAME_MAX + 1], *new;
-	int error;
+	if (!args->have_pr) {
+		if (content_proc_init(&args->pr, PATH_MAILZ_CONTENT) == -1)
+			return NULL;
+		args->have_pr = 1;
+	}
+	return &args->pr;
+}
 
-	if (set) {
-		error = maildir_set_flag(letter->path, flag, buf,
-					sizeof(buf));
+static void
+command_content_proc_kill(struct command_args *args)
+{
+	if (args->have_pr) {
+		content_proc_kill(&args->pr);
+		args->have_pr = 0;
 	}
-	else {
-		error = maildir_unset_flag(letter->path, flag, buf,
-					sizeof(buf));
+}
+
+static int
+command_draft(struct letter *letter, struct command_args *args)
+{
+	struct content_proc *pr;
+	char path[PATH_MAX];
+	FILE *fp;
+	int fd, lfd, n, rv;
+
+	rv = -1;
+
+	if ((pr = command_content_proc(args)) == NULL)
+		return -1;
+
+	n = snprintf(path, sizeof(path), "%s/drafts", args->tmpdir);
+	if (n < 0 || (size_t)n >= sizeof(path))
+		return -1;
+	if (mkdir(path, 0700) == -1 && errno != EEXIST) {
+		warn("%s", path);
+		return -1;
 	}
 
-	if (error == MAILDIR_UNCHANGED)
-		return 0;
-	if (error != MAILDIR_OK) {
-		switch (error) {
-		case MAILDIR_INVALID:
-			warnx("%s/cur/%s: invalid maildir info",
-			      args->maildir, letter->path);
-			break;
-		case MAILDIR_LONG:
-			warnx("%s/cur/%s: filename too long to modify",
-			      args->maildir, letter->path);
-			break;
-		}
+	n = snprintf(path, sizeof(path), "%s/drafts/draft.XXXXXX",
+		     args->tmpdir);
+	if (n < 0 || (size_t)n >= sizeof(path))
+		return -1;
+
+	if ((fd = mkostemp(path, O_CLOEXEC)) == -1)
+		return -1;
+	if ((fp = fdopen(fd, "w")) == NULL) {
+		unlink(path);
+		close(fd);
 		return -1;
 	}
 
-	if ((new = strdup(buf)) == NULL) {
-		warn(NULL);
+	if ((lfd = openat(args->cur, letter->path, O_RDONLY | O_CLOEXEC)) == -1)
+		goto fp;
+	if (content_proc_reply(pr, fp, args->addr, 1, lfd) == -1) {
+		/* The content process exits after a failed request */
+		command_content_proc_kill(args);
+		goto fp;
+	}
+
+	/* The reply does not end with a newline */
+	if (fputc('\n', fp) == EOF)
+		goto fp;
+	if (args->template != NULL && args->templatesz != 0) {
+		if (fwrite(args->template, args->templatesz, 1, fp) != 1)
+			goto fp;
+	}
+
+	if (fflush(fp) == EOF)
+		goto fp;
+
+	if (printf("draft saved to %s\n", path) < 0)
+		goto fp;
+
+	rv = 0;
+	fp:
+	fclose(fp);
+	if (rv == -1)
+		unlink(path);
+	return rv;
+}
+
+/*
+ * Export the letters of args->set to args->text, a name in the mailz
+ * directory.
+ * A name ending in '/' is a directory each letter is written to after
+ * decoding, as by the save command, otherwise the letters are appended
+ * to an mbox file unchanged.
+ */
+static int
+command_export(struct letter *letter, struct command_args *args)
+{
+	char base[NAME_MAX + 1], path[PATH_MAX];
+	const char *slash;
+	size_t len;
+	int n;
+
+	(void)letter;
+
+	if ((slash = strchr(args->text, '/')) != NULL && slash[1] != '\0') {
+		warnx("export name cannot contain '/'");
+		return -1;
+	}
+	len = slash != NULL ? (size_t)(slash - args->text) : strlen(args->text);
+	if (len >= sizeof(base)) {
+		warnx("export name too long");
+		return -1;
+	}
+	memcpy(base, args->text, len);
+	base[len] = '\0';
+	if (len == 0 || !strcmp(base, ".") || !strcmp(base, "..")) {
+		warnx("invalid export name %s", args->text);
 		return -1;
 	}
 
-	if (renameat(args->cur, letter->path, args->cur, new) == -1) {
-		warn("rename %s/cur/%s to %s/cur/%s", args->maildir, letter->path,
-		     args->maildir, new);
-		free(new);
+	n = snprintf(path, sizeof(path), "%s/%s", args->tmpdir, base);
+	if (n < 0 || (size_t)n >= sizeof(path)) {
+		warnx("export path too long");
 		return -1;
 	}
 
-	free(letter->path);
-	letter->path = new;
+	if (slash != NULL)
+		n = command_export_dir(args, path);
+	else
+		n = command_export_mbox(args, path);
+	if (n == -1)
+		return -1;
 
+	if (printf("%zu messages exported to %s%s\n", args->set->nidx, path,
+		   slash != NULL ? "/" : "") < 0)
+		return -1;
 	return 0;
 }
 
-
+/*
+ * Write each letter of args->set decoded to its own file in the
+ * directory path, using a single mailz-content process.
+ */
 static int
-command_more(struct letter *letter, struct command_args *args)
+command_export_dir(struct command_args *args, const char *path)
 {
 	struct content_proc pr;
-	struct content_letter lr;
-	FILE *fp;
-	int fd, p[2], rv;
-	pid_t pid;
+	size_t i;
+	int dfd, rv;
 
 	rv = -1;
 
-	if (content_proc_init(&pr, PATH_MAILZ_CONTENT) == -1)
+	if (mkdir(path, 0700) == -1 && errno != EEXIST) {
+		warn("%s", path);
 		return -1;
+	}
+	if ((dfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+		warn("%s", path);
+		return -1;
+	}
 
-	if (content_proc_ex_ignore(&pr, args->ignore) == -1)
+	if (content_proc_init(&pr, PATH_MAILZ_CONTENT) == -1)
+		goto dfd;
+	if (content_proc_ignore(&pr, args->ignore) == -1)
 		goto pr;
 
-	if ((fd = openat(args->cur, letter->path,
-			 O_RDONLY | O_CLOEXEC)) == -1)
-		goto pr;
-	if (content_letter_init(&pr, &lr, fd) == -1)
-		goto pr;
+	for (i = 0; i < args->set->nidx; i++) {
+		struct letter *letter;
 
-	if (pipe2(p, O_CLOEXEC) == -1)
-		goto lr;
-	if ((fp = fdopen(p[1], "w")) == NULL) {
-		close(p[1]);
-		close(p[0]);
-		goto lr;
+		letter = &args->mailbox->letters[args->set->idx[i]];
+		if (command_export_letter(args, &pr, letter, dfd, path) == -1)
+			goto pr;
 	}
 
-	switch (pid = fork()) {
-	case -1:
-		fclose(fp);
-		close(p[0]);
-		goto lr;
-	case 0:
-		if (dup2(p[0], STDIN_FILENO) == -1)
-			err_fork(1, "dup2");
-		execl(PATH_LESS, "less", NULL);
-		err_fork(1, "%s", PATH_LESS);
-	default:
-		break;
+	rv = 0;
+	pr:
+	content_proc_kill(&pr);
+	dfd:
+	close(dfd);
+	return rv;
+}
+
+/*
+ * Write a letter decoded to its own file in the directory dfd, which
+ * is path.  A file left by an earlier export is taken to be complete, as
+ * a partly written one is removed.
+ */
+static int
+command_export_letter(struct command_args *args, struct content_proc *pr,
+	struct letter *letter, int dfd, const char *path)
+{
+	struct content_letter lr;
+	FILE *fp;
+	int fd, lfd, n, rv;
+
+	rv = -1;
+
+	if ((fd = openat(dfd, letter->path,
+			 O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600)) == -1) {
+		if (errno == EEXIST)
+			return 0;
+		warn("%s/%s", path, letter->path);
+		return -1;
+	}
+	if ((fp = fdopen(fd, "w")) == NULL) {
+		warn("%s/%s", path, letter->path);
+		close(fd);
+		goto unlink;
+	}
+	setvbuf(fp, NULL, _IOFBF, EXPORT_BUFSZ);
+
+	if ((lfd = openat(args->boxes[letter->box].cur, letter->path,
+			  O_RDONLY | O_CLOEXEC)) == -1) {
+		warn("%s", letter->path);
+		goto fp;
+	}
+	if (content_letter_init(pr, &lr, lfd) == -1) {
+		warnx("%s: failed to start decoding", letter->path);
+		goto fp;
 	}
-	close(p[0]);
 
 	for (;;) {
 		char buf[4];
-		int n;
 
-		if ((n = content_letter_getc(&lr, buf)) == -1)
-			goto pid;
+		if ((n = content_letter_getc(&lr, buf)) == -1) {
+			warnx("%s: failed to decode", letter->path);
+			goto lr;
+		}
 		if (n == 0)
 			break;
-
 		if (fwrite(buf, n, 1, fp) != 1) {
-			if (ferror(fp) && errno == EPIPE)
-				break;
-			goto pid;
+			warn("%s/%s", path, letter->path);
+			goto lr;
 		}
 	}
-
-	if (content_letter_finish(&lr) == -1)
-		goto pid;
-
-	if (command_read(letter, args) == -1)
-		goto pid;
+	if (content_letter_finish(&lr) == -1) {
+		warnx("%s: failed to decode", letter->path);
+		goto lr;
+	}
 
 	rv = 0;
-	pid:
-	fclose(fp);
-	waitpid(pid, NULL, 0);
 	lr:
 	content_letter_close(&lr);
-	pr:
-	content_proc_kill(&pr);
+	fp:
+	if (fclose(fp) == EOF && rv == 0) {
+		warn("%s/%s", path, letter->path);
+		rv = -1;
+	}
+	unlink:
+	if (rv == -1)
+		unlinkat(dfd, letter->path, 0);
 	return rv;
 }
 
+/*
+ * Append each letter of args->set unchanged to the mbox file path,
+ * quoting lines starting with "From " as in the mboxrd format.
+ */
 static int
-command_read(struct letter *letter, struct command_args *args)
-{
-	return command_flag(letter, args, 'S', 1);
-}
-
-static int
-command_reply(struct letter *letter, struct command_args *args)
-{
-	return command_reply1(letter, args, 1);
-}
-
-static int
-command_reply1(struct letter *letter, struct command_args *args, int group)
+command_export_mbox(struct command_args *args, const char *path)
 {
-	struct content_proc pr;
-	char path[PATH_MAX];
 	FILE *fp;
-	pid_t pid;
-	int ch, fd, lfd, n, rv, status;
+	char *line;
+	size_t i, linesz;
+	int fd, rv;
 
 	rv = -1;
+	line = NULL;
+	linesz = 0;
 
-	if (content_proc_init(&pr, PATH_MAILZ_CONTENT) == -1)
+	if ((fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+		       0600)) == -1) {
+		warn("%s", path);
 		return -1;
+	}
+	if ((fp = fdopen(fd, "a")) == NULL) {
+		warn("%s", path);
+		close(fd);
+		return -1;
+	}
+	setvbuf(fp, NULL, _IOFBF, EXPORT_BUFSZ);
+
+	for (i = 0; i < args->set->nidx; i++) {
+		struct letter *letter;
+		struct tm tm;
+		FILE *in;
+		const char *from;
+		char date[32];
+		ssize_t len;
+		int lfd, nl;
+
+		letter = &args->mailbox->letters[args->set->idx[i]];
+
+		if ((lfd = openat(args->boxes[letter->box].cur, letter->path,
+				  O_RDONLY | O_CLOEXEC)) == -1) {
+			warn("%s", letter->path);
+			goto fp;
+		}
+		if ((in = fdopen(lfd, "r")) == NULL) {
+			close(lfd);
+			goto fp;
+		}
 
-	n = snprintf(path, sizeof(path), "%s/reply.XXXXXX", args->tmpdir);
-	if (n < 0 || (size_t)n >= sizeof(path))
-		goto pr;
+		if (gmtime_r(&letter->date, &tm) == NULL ||
+		    strftime(date, sizeof(date), "%a %b %e %H:%M:%S %Y",
+			     &tm) == 0) {
+			fclose(in);
+			goto fp;
+		}
+		from = letter->from;
+		if (*from == '\0' || strpbrk(from, " \t") != NULL)
+			from = "MAILER-DAEMON";
+		if (fprintf(fp, "From %s %s\n", from, date) < 0) {
+			warn("%s", path);
+			fclose(in);
+			goto fp;
+		}
 
-	if ((fd = mkostemp(path, O_CLOEXEC)) == -1)
-		goto pr;
-	if ((fp = fdopen(fd, "w")) == NULL) {
-		unlink(path);
-		close(fd);
-		goto pr;
+		nl = 1;
+		while ((len = getline(&line, &linesz, in)) != -1) {
+			const char *s;
+
+			for (s = line; *s == '>'; s++)
+				;
+			if (!strncmp(s, "From ", 5) && putc('>', fp) == EOF)
+				break;
+			if (fwrite(line, len, 1, fp) != 1)
+				break;
+			nl = line[len - 1] == '\n';
+		}
+		if (ferror(fp)) {
+			warn("%s", path);
+			fclose(in);
+			goto fp;
+		}
+		if (ferror(in)) {
+			warn("%s", letter->path);
+			fclose(in);
+			goto fp;
+		}
+		fclose(in);
+
+		if ((!nl && putc('\n', fp) == EOF) || putc('\n', fp) == EOF) {
+			warn("%s", path);
+			goto fp;
+		}
 	}
 
-	if ((lfd = openat(args->cur, letter->path, O_RDONLY | O_CLOEXEC)) == -1)
-		goto fp;
-	if (content_proc_reply(&pr, fp, args->addr, group, lfd) == -1)
-		goto fp;
+	rv = 0;
+	fp:
+	if (fclose(fp) == EOF && rv == 0) {
+		warn("%s", path);
+		rv = -1;
+	}
+	free(line);
+	return rv;
+}
 
-	if (fflush(fp) == EOF)
-		goto fp;
+/*
+ * Print the letters matched by the filter, remembering them for the
+ * '%' selector.
+ */
+static int
+command_filter(struct letter *letter, struct command_args *args)
+{
+	struct filter filter;
+	struct mailbox_set result;
+	unsigned char *match;
+	size_t i, n;
+	int rv;
 
-	if (printf("message located at %s\n"
-		   "press enter to send or q to cancel: ", path) < 0)
-		goto fp;
-	if (fflush(stdout) == EOF)
-		goto fp;
+	(void)letter;
 
-	if ((ch = fgetc(stdin)) == EOF)
-		goto fp;
+	if (filter_parse(&filter, args->text) == -1) {
+		warnx("invalid filter");
+		return -1;
+	}
 
-	if (ch != '\n') {
-		int any, c;
+	if (read_fields(args, filter_fields(&filter)) == -1)
+		return -1;
 
-		any = 0;
-		while ((c = fgetc(stdin)) == EOF && c != '\n')
-			any = 1;
-		if (ch == 'q' && !any)
-			rv = 0;
-		goto fp;
+	if ((match = calloc(args->mailbox->nletter + 1,
+			    sizeof(*match))) == NULL) {
+		warn(NULL);
+		return -1;
 	}
 
-	lfd = fileno(fp);
-	if (lseek(lfd, 0, SEEK_SET) == -1)
-		goto fp;
-	switch (pid = fork()) {
-	case -1:
-		goto fp;
-	case 0:
-		if (dup2(lfd, STDIN_FILENO) == -1)
-			err_fork(1, "dup2");
-		execl(PATH_SENDMAIL, "sendmail", "-t", NULL);
-		err_fork(1, "%s", PATH_SENDMAIL);
-	default:
-		break;
+	rv = -1;
+
+	if (mailbox_set_init(args->mailbox, &result) == -1) {
+		warn(NULL);
+		goto match;
 	}
 
-	if (waitpid(pid, &status, 0) == -1)
-		goto fp;
-	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
-		goto fp;
+	if (filter_run(&filter, args->mailbox, match) == 0)
+		puts("No matches.");
+
+	for (n = 0; n < args->mailbox->nshown; n++) {
+		i = mailbox_index(args->mailbox, n);
+		if (!match[i])
+			continue;
+		mailbox_set_add(&result, i);
+		if (letter_print(args, &args->mailbox->letters[i]) == -1) {
+			mailbox_set_free(&result);
+			goto match;
+		}
+	}
+
+	if (args->have_result)
+		mailbox_set_free(&args->result);
+	args->result = result;
+	args->have_result = 1;
 
 	rv = 0;
-	fp:
-	fclose(fp);
-	unlink(path);
-	pr:
-	content_proc_kill(&pr);
+	match:
+	free(match);
 	return rv;
 }
 
 static int
-command_respond(struct letter *letter, struct command_args *args)
+command_flag(struct letter *letter, struct command_args *args,
+	     int flag, int set)
 {
-	return command_reply1(letter, args, 0);
-}
+	char buf[NAME_MAX + 1], *new;
+	int error;
 
-static int
-command_save(struct letter *letter, struct command_args *args)
-{
-	struct content_proc pr;
-	struct content_letter lr;
-	char path[PATH_MAX];
-	FILE *fp;
-	int fd, lfd, n, rv;
+	if (set) {
+		error = maildir_set_flag(letter->path, flag, buf,
+					sizeof(buf));
+	}
+	else {
+		error = maildir_unset_flag(letter->path, flag, buf,
+					sizeof(buf));
+	}
 
-	rv = -1;
+	if (error == MAILDIR_UNCHANGED)
+		return 0;
+	if (error != MAILDIR_OK) {
+		switch (error) {
+		case MAILDIR_INVALID:
+			warnx("%s/cur/%s: invalid maildir info",
+			      args->maildir, letter->path);
+			break;
+		case MAILDIR_LONG:
+			warnx("%s/cur/%s: filename too long to modify",
+			      args->maildir, letter->path);
+			break;
+		}
+		return -1;
+	}
 
-	if (content_proc_init(&pr, PATH_MAILZ_CONTENT) == -1)
+	if ((new = strdup(buf)) == NULL) {
+		warn(NULL);
 		return -1;
+	}
 
-	if (content_proc_ex_ignore(&pr, args->ignore) == -1)
-		goto pr;
+	if (renameat(args->cur, letter->path, args->cur, new) == -1) {
+		warn("rename %s/cur/%s to %s/cur/%s", args->maildir, letter->path,
+		     args->maildir, new);
+		free(new);
+		return -1;
+	}
 
-	if ((lfd = openat(args->cur, letter->path,
-			  O_RDONLY | O_CLOEXEC)) == -1)
-		goto pr;
-	if (content_letter_init(&pr, &lr, lfd) == -1)
-		goto pr;
+	free(letter->path);
+	letter->path = new;
 
-	n = snprintf(path, sizeof(path), "%s/save.XXXXXX", args->tmpdir);
-	if (n < 0 || (size_t)n >= sizeof(path))
-		goto lr;
+	return 0;
+}
 
-	if ((fd = mkostemp(path, O_CLOEXEC)) == -1)
-		goto lr;
-	if ((fp = fdopen(fd, "w")) == NULL) {
-		unlink(path);
-		close(fd);
-		goto lr;
-	}
 
-	for (;;) {
-		char buf[4];
-		int n;
+/*
+ * Print each letter whose text, as shown by the more command, matches
+ * the pattern, spreading the letters over several mailz-content
+ * processes and printing matches as soon as they are found.
+ */
+static int
+command_grep(struct letter *letter, struct command_args *args)
+{
+	struct grep_worker workers[GREP_WORKERS];
+	struct pollfd pfd[GREP_WORKERS];
+	regex_t re;
+	size_t i, next, nfound, ninit, nworker, pending;
+	long ncpu;
+	int error, fixed, rv;
+	char errbuf[128];
+
+	(void)letter;
+
+	if (strlen(args->text) >=
+	    sizeof(((struct content_pattern *)NULL)->pattern)) {
+		warnx("pattern too long");
+		return -1;
+	}
 
-		if ((n = content_letter_getc(&lr, buf)) == -1)
-			goto fp;
-		if (n == 0)
-			break;
+	/* Plain strings are matched with memmem(3) instead of regexec(3). */
+	fixed = strpbrk(args->text, ".[]()*+?{}|^$\\") == NULL;
+	if (!fixed) {
+		error = regcomp(&re, args->text,
+				REG_EXTENDED | REG_NOSUB | REG_NEWLINE);
+		if (error != 0) {
+			regerror(error, &re, errbuf, sizeof(errbuf));
+			warnx("%s", errbuf);
+			return -1;
+		}
+		regfree(&re);
+	}
 
-		if (fwrite(buf, n, 1, fp) != 1)
-			goto fp;
+	if (args->mailbox->nshown == 0) {
+		puts("No matches.");
+		return 0;
 	}
 
-	if (content_letter_finish(&lr) == -1)
-		goto fp;
+	nworker = GREP_WORKERS;
+	if ((ncpu = sysconf(_SC_NPROCESSORS_ONLN)) > 0 &&
+	    (size_t)ncpu < nworker)
+		nworker = ncpu;
+	if (args->mailbox->nshown < nworker)
+		nworker = args->mailbox->nshown;
 
-	if (fflush(fp) == EOF)
-		goto fp;
+	rv = -1;
 
-	if (printf("message saved to %s\n", path) < 0)
-		goto fp;
+	for (ninit = 0; ninit < nworker; ninit++) {
+		struct grep_worker *w;
+
+		w = &workers[ninit];
+		if (content_proc_init(&w->pr, PATH_MAILZ_CONTENT) == -1) {
+			warn("content_proc_init");
+			goto workers;
+		}
+		w->head = 0;
+		w->nqueue = 0;
+
+		if (content_proc_ignore(&w->pr, args->ignore) == -1 ||
+		    content_proc_grep_pattern(&w->pr, args->text, fixed) == -1) {
+			warnx("content_proc_grep_pattern");
+			ninit++;
+			goto workers;
+		}
+	}
+
+	next = 0;
+	nfound = 0;
+	pending = 0;
+	for (;;) {
+		/* Keep every worker busy with the next letters. */
+		for (i = 0; i < nworker; i++) {
+			struct grep_worker *w;
+
+			w = &workers[i];
+			while (w->nqueue < GREP_QUEUE &&
+			       next < args->mailbox->nshown) {
+				struct box *box;
+				struct letter *lp;
+				size_t idx;
+				int fd;
+
+				idx = mailbox_index(args->mailbox, next++);
+				lp = &args->mailbox->letters[idx];
+				box = &args->boxes[lp->box];
+				if ((fd = openat(box->cur, lp->path,
+						 O_RDONLY | O_CLOEXEC)) == -1) {
+					warn("%s/cur/%s", box->maildir, lp->path);
+					continue;
+				}
+				if (content_proc_grep_send(&w->pr, fd) == -1) {
+					warnx("content_proc_grep_send");
+					goto workers;
+				}
+
+				w->queue[(w->head + w->nqueue) % GREP_QUEUE] =
+				    idx;
+				w->nqueue++;
+				pending++;
+			}
+		}
+
+		if (pending == 0)
+			break;
+
+		for (i = 0; i < nworker; i++) {
+			pfd[i].fd = workers[i].nqueue != 0 ?
+			    workers[i].pr.msgbuf.fd : -1;
+			pfd[i].events = POLLIN;
+		}
+
+		if (poll(pfd, nworker, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			warn("poll");
+			goto workers;
+		}
+
+		for (i = 0; i < nworker; i++) {
+			struct grep_worker *w;
+			int match, n;
+
+			if (pfd[i].fd == -1 || pfd[i].revents == 0)
+				continue;
+
+			w = &workers[i];
+			if (content_proc_grep_read(&w->pr) == -1) {
+				warnx("mailz-content exited unexpectedly");
+				goto workers;
+			}
+
+			while ((n = content_proc_grep_recv(&w->pr,
+							   &match)) == 1) {
+				struct letter *lp;
+				size_t idx;
+
+				if (w->nqueue == 0) {
+					warnx("unexpected reply from mailz-content");
+					goto workers;
+				}
+				idx = w->queue[w->head];
+				w->head = (w->head + 1) % GREP_QUEUE;
+				w->nqueue--;
+				pending--;
+
+				lp = &args->mailbox->letters[idx];
+				if (match == -1)
+					warnx("%s/cur/%s: could not decode letter",
+					      args->boxes[lp->box].maildir,
+					      lp->path);
+				else if (match) {
+					if (letter_print(args, lp) == -1)
+						goto workers;
+					fflush(stdout);
+					nfound++;
+				}
+			}
+			if (n == -1) {
+				warnx("content_proc_grep_recv");
+				goto workers;
+			}
+		}
+	}
+
+	if (nfound == 0)
+		puts("No matches.");
 
 	rv = 0;
-	fp:
+	workers:
+	for (i = 0; i < ninit; i++)
+		content_proc_kill(&workers[i].pr);
+	return rv;
+}
+
+/*
+ * Show only the letters of the named mailbox, or of every mailbox if
+ * the name is "all", and list them.
+ * Without a name, list the mailboxes instead.
+ */
+static int
+command_mailbox(struct letter *letter, struct command_args *args)
+{
+	struct mailbox *mailbox;
+	size_t i;
+	int box;
+
+	(void)letter;
+
+	mailbox = args->mailbox;
+
+	if (args->text == NULL) {
+		size_t j, n;
+
+		for (i = 0; i < args->nbox; i++) {
+			for (j = 0, n = 0; j < mailbox->nletter; j++)
+				n += mailbox->letters[j].box == (int)i;
+			printf("%c %-16s %zu\n",
+			       mailbox->box == (int)i ? '>' : ' ',
+			       args->boxes[i].ident, n);
+		}
+		printf("%c %-16s %zu\n", mailbox->box == -1 ? '>' : ' ',
+		       "all", mailbox->nletter);
+		return 0;
+	}
+
+	if (!strcmp(args->text, "all"))
+		box = -1;
+	else {
+		for (i = 0; i < args->nbox; i++) {
+			if (!strcmp(args->text, args->boxes[i].ident))
+				break;
+		}
+		if (i == args->nbox) {
+			warnx("unknown mailbox %s", args->text);
+			return -1;
+		}
+		box = i;
+	}
+
+	if (box != mailbox->box) {
+		if (mailbox_view(mailbox, box) == -1) {
+			warn(NULL);
+			return -1;
+		}
+		if (args->have_search) {
+			search_free(&args->search);
+			args->have_search = 0;
+		}
+	}
+
+	return letters_print(args);
+}
+
+static int
+command_more(struct letter *letter, struct command_args *args)
+{
+	struct content_proc pr;
+	struct content_letter lr;
+	FILE *fp;
+	int fd, p[2], rv;
+	pid_t pid;
+
+	rv = -1;
+
+	if (content_proc_init(&pr, PATH_MAILZ_CONTENT) == -1)
+		return -1;
+
+	if (content_proc_ignore(&pr, args->ignore) == -1)
+		goto pr;
+
+	if ((fd = openat(args->cur, letter->path,
+			 O_RDONLY | O_CLOEXEC)) == -1)
+		goto pr;
+	if (content_letter_init(&pr, &lr, fd) == -1)
+		goto pr;
+
+	if (pipe2(p, O_CLOEXEC) == -1)
+		goto lr;
+	if ((fp = fdopen(p[1], "w")) == NULL) {
+		close(p[1]);
+		close(p[0]);
+		goto lr;
+	}
+
+	switch (pid = fork()) {
+	case -1:
+		fclose(fp);
+		close(p[0]);
+		goto lr;
+	case 0:
+		if (dup2(p[0], STDIN_FILENO) == -1)
+			err_fork(1, "dup2");
+		execl(PATH_LESS, "less", NULL);
+		err_fork(1, "%s", PATH_LESS);
+	default:
+		break;
+	}
+	close(p[0]);
+
+	for (;;) {
+		char buf[4];
+		int n;
+
+		if ((n = content_letter_getc(&lr, buf)) == -1)
+			goto pid;
+		if (n == 0)
+			break;
+
+		if (fwrite(buf, n, 1, fp) != 1) {
+			if (ferror(fp) && errno == EPIPE)
+				break;
+			goto pid;
+		}
+	}
+
+	if (content_letter_finish(&lr) == -1)
+		goto pid;
+
+	if (command_read(letter, args) == -1)
+		goto pid;
+
+	rv = 0;
+	pid:
 	fclose(fp);
-	if (rv == -1)
-		unlink(path);
+	waitpid(pid, NULL, 0);
 	lr:
 	content_letter_close(&lr);
 	pr:
@@ -511,82 +1319,1331 @@ command_save(struct letter *letter, struct command_args *args)
 	return rv;
 }
 
-static int
-command_thread(struct letter *letter, struct command_args *args)
-{
-	struct mailbox_thread thread;
-	struct letter *let;
+static int
+command_read(struct letter *letter, struct command_args *args)
+{
+	return command_flag(letter, args, 'S', 1);
+}
+
+static int
+command_reply(struct letter *letter, struct command_args *args)
+{
+	return command_reply1(letter, args, 1);
+}
+
+static int
+command_reply1(struct letter *letter, struct command_args *args, int group)
+{
+	struct content_proc pr;
+	char path[PATH_MAX];
+	FILE *fp;
+	int fd, lfd, n, rv;
+
+	rv = -1;
+
+	if (content_proc_init(&pr, PATH_MAILZ_CONTENT) == -1)
+		return -1;
+
+	n = snprintf(path, sizeof(path), "%s/reply.XXXXXX", args->tmpdir);
+	if (n < 0 || (size_t)n >= sizeof(path))
+		goto pr;
+
+	if ((fd = mkostemp(path, O_CLOEXEC)) == -1)
+		goto pr;
+	if ((fp = fdopen(fd, "w")) == NULL) {
+		unlink(path);
+		close(fd);
+		goto pr;
+	}
+
+	if ((lfd = openat(args->cur, letter->path, O_RDONLY | O_CLOEXEC)) == -1)
+		goto fp;
+	if (content_proc_reply(&pr, fp, args->addr, group, lfd) == -1)
+		goto fp;
+
+	if (fflush(fp) == EOF)
+		goto fp;
+
+	if (!args->batch) {
+		switch (confirm("message located at %s\n"
+				"press enter to send or q to cancel: ",
+				path)) {
+		case -1:
+			goto fp;
+		case 0:
+			rv = 0;
+			goto fp;
+		default:
+			break;
+		}
+	}
+
+	lfd = fileno(fp);
+	if (lseek(lfd, 0, SEEK_SET) == -1)
+		goto fp;
+	if (sendmail(lfd) == -1)
+		goto fp;
+
+	rv = 0;
+	fp:
+	fclose(fp);
+	unlink(path);
+	pr:
+	content_proc_kill(&pr);
+	return rv;
+}
+
+static int
+command_respond(struct letter *letter, struct command_args *args)
+{
+	return command_reply1(letter, args, 0);
+}
+
+static int
+command_save(struct letter *letter, struct command_args *args)
+{
+	struct content_proc pr;
+	struct content_letter lr;
+	char path[PATH_MAX];
+	FILE *fp;
+	int fd, lfd, n, rv;
+
+	rv = -1;
+
+	if (content_proc_init(&pr, PATH_MAILZ_CONTENT) == -1)
+		return -1;
+
+	if (content_proc_ignore(&pr, args->ignore) == -1)
+		goto pr;
+
+	if ((lfd = openat(args->cur, letter->path,
+			  O_RDONLY | O_CLOEXEC)) == -1)
+		goto pr;
+	if (content_letter_init(&pr, &lr, lfd) == -1)
+		goto pr;
+
+	n = snprintf(path, sizeof(path), "%s/save.XXXXXX", args->tmpdir);
+	if (n < 0 || (size_t)n >= sizeof(path))
+		goto lr;
+
+	if ((fd = mkostemp(path, O_CLOEXEC)) == -1)
+		goto lr;
+	if ((fp = fdopen(fd, "w")) == NULL) {
+		unlink(path);
+		close(fd);
+		goto lr;
+	}
+
+	for (;;) {
+		char buf[4];
+		int n;
+
+		if ((n = content_letter_getc(&lr, buf)) == -1)
+			goto fp;
+		if (n == 0)
+			break;
+
+		if (fwrite(buf, n, 1, fp) != 1)
+			goto fp;
+	}
+
+	if (content_letter_finish(&lr) == -1)
+		goto fp;
+
+	if (fflush(fp) == EOF)
+		goto fp;
+
+	if (printf("message saved to %s\n", path) < 0)
+		goto fp;
+
+	rv = 0;
+	fp:
+	fclose(fp);
+	if (rv == -1)
+		unlink(path);
+	lr:
+	content_letter_close(&lr);
+	pr:
+	content_proc_kill(&pr);
+	return rv;
+}
+
+/*
+ * List the letters matching the query, using the search index of the
+ * maildir brought up to date first.
+ */
+static int
+command_search(struct letter *letter, struct command_args *args)
+{
+	struct search_query q;
+	uint32_t *res;
+	unsigned char *hit;
+	size_t i, nfound, nres;
+	int phrase, rv;
+
+	(void)letter;
+
+	/* The index is kept per maildir. */
+	if (args->nbox > 1 && args->mailbox->box == -1) {
+		warnx("search needs a single mailbox, see the mailbox command");
+		return -1;
+	}
+
+	if (search_query_parse(&q, args->text) == -1) {
+		warnx("invalid search query");
+		return -1;
+	}
+
+	if (command_search_load(args) == -1)
+		return -1;
+	if (command_search_update(args) == -1)
+		warnx("search index may be out of date");
+
+	if (search_query_run(&args->search, &q, &res, &nres) == -1) {
+		warn(NULL);
+		return -1;
+	}
+
+	rv = -1;
+
+	if ((hit = calloc(args->search.ndoc + 1, sizeof(*hit))) == NULL) {
+		warn(NULL);
+		goto res;
+	}
+	for (i = 0; i < nres; i++)
+		hit[res[i]] = 1;
+
+	phrase = search_query_phrase(&q);
+	nfound = 0;
+	for (i = 0; i < args->mailbox->nshown && nres != 0; i++) {
+		struct letter *lp;
+		uint32_t id;
+
+		lp = &args->mailbox->letters[mailbox_index(args->mailbox, i)];
+		if (!search_lookup(&args->search, lp->path, &id) || !hit[id])
+			continue;
+
+		if (phrase) {
+			int match;
+
+			if ((match = command_search_match(args, lp, &q)) == -1)
+				goto hit;
+			if (!match)
+				continue;
+		}
+
+		if (letter_print(args, lp) == -1)
+			goto hit;
+		nfound++;
+	}
+
+	if (nfound == 0)
+		puts("No matches.");
+
+	rv = 0;
+	hit:
+	free(hit);
+	res:
+	free(res);
+	return rv;
+}
+
+/*
+ * Add the letter name to the search index.
+ * Every header is indexed, not only the ones shown by the more
+ * command, so the index stays valid if the ignore list is changed.
+ */
+static int
+command_search_index(struct command_args *args, const char *name)
+{
+	struct content_letter lr;
+	struct content_proc *pr;
+	size_t n;
+	int fd, rv;
+	char buf[8192];
+
+	if ((fd = openat(args->cur, name, O_RDONLY | O_CLOEXEC)) == -1) {
+		warn("%s/cur/%s", args->maildir, name);
+		return -1;
+	}
+
+	if ((pr = command_content_proc(args)) == NULL) {
+		close(fd);
+		return -1;
+	}
+	if (content_letter_init(pr, &lr, fd) == -1) {
+		command_content_proc_kill(args);
+		return -1;
+	}
+
+	rv = -1;
+
+	if (search_doc_begin(&args->search, name) == -1) {
+		warn(NULL);
+		goto lr;
+	}
+
+	while ((n = fread(buf, 1, sizeof(buf), lr.fp)) != 0) {
+		if (search_doc_text(&args->search, buf, n) == -1) {
+			warn(NULL);
+			goto lr;
+		}
+	}
+
+	if (search_doc_end(&args->search) == -1) {
+		warn(NULL);
+		goto lr;
+	}
+
+	/*
+	 * mailz-content exits after a letter it cannot decode, keep
+	 * what was indexed so the letter is not retried on every search.
+	 */
+	if (content_letter_finish(&lr) == -1) {
+		warnx("%s/cur/%s: letter only partially indexed",
+		      args->maildir, name);
+		content_letter_close(&lr);
+		command_content_proc_kill(args);
+		return 0;
+	}
+
+	rv = 0;
+	lr:
+	content_letter_close(&lr);
+	if (rv == -1)
+		command_content_proc_kill(args);
+	return rv;
+}
+
+static int
+command_search_load(struct command_args *args)
+{
+	FILE *fp;
+	char path[PATH_MAX];
+
+	if (args->have_search)
+		return 0;
+
+	if (command_search_path(args, path, sizeof(path)) == -1)
+		return -1;
+
+	search_init(&args->search);
+	if ((fp = fopen(path, "re")) == NULL) {
+		if (errno != ENOENT)
+			warn("%s", path);
+	}
+	else {
+		if (search_load(&args->search, fp) == -1) {
+			warnx("%s: rebuilding damaged search index", path);
+			search_free(&args->search);
+			search_init(&args->search);
+		}
+		fclose(fp);
+	}
+
+	memset(&args->search_mtim, 0, sizeof(args->search_mtim));
+	args->have_search = 1;
+	return 0;
+}
+
+/*
+ * Check that every phrase of q is in the letter, as the index
+ * only records which words it contains.
+ * Returns 1 if it is, 0 if it is not and -1 on failure.
+ */
+static int
+command_search_match(struct command_args *args, struct letter *letter,
+	const struct search_query *q)
+{
+	struct content_letter lr;
+	struct content_proc *pr;
+	struct search_match m;
+	size_t n;
+	int fd, match;
+	char buf[8192];
+
+	if ((fd = openat(args->cur, letter->path, O_RDONLY | O_CLOEXEC)) == -1) {
+		warn("%s/cur/%s", args->maildir, letter->path);
+		return -1;
+	}
+
+	if ((pr = command_content_proc(args)) == NULL) {
+		close(fd);
+		return -1;
+	}
+	if (content_letter_init(pr, &lr, fd) == -1) {
+		command_content_proc_kill(args);
+		return -1;
+	}
+
+	search_match_init(&m, q);
+	while ((n = fread(buf, 1, sizeof(buf), lr.fp)) != 0)
+		search_match_text(&m, buf, n);
+	match = search_match_end(&m);
+
+	if (content_letter_finish(&lr) == -1)
+		command_content_proc_kill(args);
+	content_letter_close(&lr);
+
+	return match;
+}
+
+static int
+command_search_path(struct command_args *args, char *buf, size_t bufsz)
+{
+	char *p;
+	int n;
+
+	n = snprintf(buf, bufsz, "%s/search.%s", args->tmpdir, args->maildir);
+	if (n < 0 || (size_t)n >= bufsz) {
+		warnc(ENAMETOOLONG, "search index");
+		return -1;
+	}
+
+	for (p = buf + strlen(args->tmpdir) + 1; *p != '\0'; p++) {
+		if (*p == '/')
+			*p = '_';
+	}
+
+	return 0;
+}
+
+static int
+command_search_save(struct command_args *args)
+{
+	FILE *fp;
+	char path[PATH_MAX], tmp[PATH_MAX];
+	int fd, n;
+
+	if (command_search_path(args, path, sizeof(path)) == -1)
+		return -1;
+
+	n = snprintf(tmp, sizeof(tmp), "%s.XXXXXXXXXX", path);
+	if (n < 0 || (size_t)n >= sizeof(tmp)) {
+		warnc(ENAMETOOLONG, "%s", path);
+		return -1;
+	}
+
+	if ((fd = mkostemp(tmp, O_CLOEXEC)) == -1) {
+		warn("%s", tmp);
+		return -1;
+	}
+	if ((fp = fdopen(fd, "w")) == NULL) {
+		warn("fdopen");
+		close(fd);
+		goto tmp;
+	}
+
+	if (search_save(&args->search, fp) == -1) {
+		warn("%s", tmp);
+		fclose(fp);
+		goto tmp;
+	}
+	if (fclose(fp) == EOF) {
+		warn("%s", tmp);
+		goto tmp;
+	}
+
+	if (rename(tmp, path) == -1) {
+		warn("rename %s to %s", tmp, path);
+		goto tmp;
+	}
+
+	return 0;
+
+	tmp:
+	unlink(tmp);
+	return -1;
+}
+
+/*
+ * Bring the search index up to date with the maildir, indexing new
+ * letters and forgetting removed ones.
+ * Nothing is done if the maildir has not changed since the last
+ * update.
+ */
+static int
+command_search_update(struct command_args *args)
+{
+	DIR *cur;
+	struct stat sb;
+	char **names, **t;
+	size_t i, nname;
+	int curfd, rv;
+
+	if (fstat(args->cur, &sb) == -1) {
+		warn("%s/cur", args->maildir);
+		return -1;
+	}
+	if (sb.st_mtim.tv_sec == args->search_mtim.tv_sec &&
+	    sb.st_mtim.tv_nsec == args->search_mtim.tv_nsec)
+		return 0;
+
+	if ((curfd = dup(args->cur)) == -1) {
+		warn("dup");
+		return -1;
+	}
+	if (fcntl(curfd, F_SETFD, FD_CLOEXEC) == -1) {
+		warn("fcntl");
+		close(curfd);
+		return -1;
+	}
+	if ((cur = fdopendir(curfd)) == NULL) {
+		warn("fdopendir");
+		close(curfd);
+		return -1;
+	}
+
+	/* The offset is shared with args->cur, which was already read. */
+	rewinddir(cur);
+
+	rv = -1;
+
+	names = NULL;
+	nname = 0;
+	search_update_begin(&args->search);
+	for (;;) {
+		struct dirent *de;
+		char *name;
+		int seen;
+
+		errno = 0;
+		if ((de = readdir(cur)) == NULL) {
+			if (errno == 0)
+				break;
+			warn("readdir");
+			goto names;
+		}
+
+		if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+			continue;
+
+		if ((seen = search_seen(&args->search, de->d_name)) == -1) {
+			warn(NULL);
+			goto names;
+		}
+		if (seen)
+			continue;
+
+		if (nname == SIZE_MAX) {
+			warnc(ENOMEM, NULL);
+			goto names;
+		}
+		if ((name = strdup(de->d_name)) == NULL) {
+			warn(NULL);
+			goto names;
+		}
+		if ((t = reallocarray(names, nname + 1,
+				      sizeof(*names))) == NULL) {
+			warn(NULL);
+			free(name);
+			goto names;
+		}
+		names = t;
+		names[nname++] = name;
+	}
+	search_update_end(&args->search);
+
+	rv = 0;
+	for (i = 0; i < nname; i++) {
+		if (command_search_index(args, names[i]) == -1)
+			rv = -1;
+	}
+
+	if (args->search.dirty && command_search_save(args) == -1)
+		rv = -1;
+
+	if (rv == 0)
+		args->search_mtim = sb.st_mtim;
+
+	names:
+	for (i = 0; i < nname; i++)
+		free(names[i]);
+	free(names);
+	closedir(cur);
+	return rv;
+}
+
+/*
+ * Hand every draft written by the draft command to sendmail(8),
+ * asking for confirmation once for the whole batch.
+ */
+static int
+command_send(struct letter *letter, struct command_args *args)
+{
+	DIR *drafts;
+	char path[PATH_MAX], **names, **t;
+	size_t i, nname;
+	int dfd, n, rv;
+
+	(void)letter;
+
+	rv = -1;
+
+	n = snprintf(path, sizeof(path), "%s/drafts", args->tmpdir);
+	if (n < 0 || (size_t)n >= sizeof(path))
+		return -1;
+
+	if ((dfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+		if (errno == ENOENT) {
+			puts("No drafts.");
+			return 0;
+		}
+		warn("%s", path);
+		return -1;
+	}
+	if ((drafts = fdopendir(dfd)) == NULL) {
+		warn("fdopendir");
+		close(dfd);
+		return -1;
+	}
+
+	names = NULL;
+	nname = 0;
+	for (;;) {
+		struct dirent *de;
+		char *name;
+
+		errno = 0;
+		if ((de = readdir(drafts)) == NULL) {
+			if (errno == 0)
+				break;
+			warn("readdir");
+			goto names;
+		}
+
+		if (de->d_name[0] == '.')
+			continue;
+
+		if (nname == SIZE_MAX) {
+			warnc(ENOMEM, NULL);
+			goto names;
+		}
+		if ((name = strdup(de->d_name)) == NULL) {
+			warn(NULL);
+			goto names;
+		}
+		if ((t = reallocarray(names, nname + 1,
+				      sizeof(*names))) == NULL) {
+			warn(NULL);
+			free(name);
+			goto names;
+		}
+		names = t;
+		names[nname++] = name;
+	}
+
+	if (nname == 0) {
+		puts("No drafts.");
+		rv = 0;
+		goto names;
+	}
+
+	if (!args->batch) {
+		switch (confirm("%zu drafts located at %s\n"
+				"press enter to send or q to cancel: ",
+				nname, path)) {
+		case -1:
+			goto names;
+		case 0:
+			rv = 0;
+			goto names;
+		default:
+			break;
+		}
+	}
+
+	rv = 0;
+	for (i = 0; i < nname; i++) {
+		int fd;
+
+		if ((fd = openat(dfd, names[i], O_RDONLY | O_CLOEXEC)) == -1) {
+			warn("%s/%s", path, names[i]);
+			rv = -1;
+			continue;
+		}
+		if (sendmail(fd) == -1) {
+			warnx("%s/%s: not sent", path, names[i]);
+			close(fd);
+			rv = -1;
+			continue;
+		}
+		close(fd);
+
+		if (unlinkat(dfd, names[i], 0) == -1) {
+			warn("%s/%s", path, names[i]);
+			rv = -1;
+		}
+	}
+
+	names:
+	for (i = 0; i < nname; i++)
+		free(names[i]);
+	free(names);
+	closedir(drafts);
+	return rv;
+}
+
+/*
+ * Change the order in which letters are listed and numbered, and list
+ * them again.
+ * The order can be prefixed with '-' to reverse it.
+ */
+static int
+command_sort(struct letter *letter, struct command_args *args)
+{
+	static const struct {
+		const char *ident;
+		enum mailbox_order order;
+		int fields;
+	} orders[] = {
+		{ "date",	MAILBOX_ORDER_DATE,	0 },
+		{ "from",	MAILBOX_ORDER_FROM,	0 },
+		{ "size",	MAILBOX_ORDER_SIZE,	LETTER_SIZE },
+		{ "subject",	MAILBOX_ORDER_SUBJECT,	0 },
+		{ "thread",	MAILBOX_ORDER_THREAD,	0 },
+	};
+	struct mailbox *mailbox;
+	const char *ident;
+	size_t i;
+	int reverse;
+
+	(void)letter;
+
+	mailbox = args->mailbox;
+
+	ident = args->text;
+	reverse = 0;
+	if (*ident == '-') {
+		reverse = 1;
+		ident++;
+	}
+
+	for (i = 0; i < nitems(orders); i++) {
+		if (!strcmp(ident, orders[i].ident))
+			break;
+	}
+	if (i == nitems(orders)) {
+		warnx("unknown sort order %s", ident);
+		return -1;
+	}
+
+	if (read_fields(args, orders[i].fields) == -1)
+		return -1;
+	if (mailbox_order(mailbox, orders[i].order, reverse) == -1) {
+		warn(NULL);
+		return -1;
+	}
+
+	return letters_print(args);
+}
+
+static int
+command_thread(struct letter *letter, struct command_args *args)
+{
+	struct mailbox_thread thread;
+	struct letter *let;
+
+	mailbox_thread_init(args->mailbox, &thread, letter);
+
+	while ((let = mailbox_thread_next(args->mailbox, &thread)) != NULL) {
+		size_t idx;
+
+		idx = let - args->mailbox->letters;
+		if (mailbox_rank(args->mailbox, idx) == SIZE_MAX)
+			continue;
+		if (letter_print(args, let) == -1)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int
+command_unread(struct letter *letter, struct command_args *args)
+{
+	return command_flag(letter, args, 'S', 0);
+}
+
+/*
+ * Print the prompt and read a line from stdin.
+ * Returns 1 if the line was empty, 0 if it was 'q' and -1 otherwise.
+ */
+static int
+confirm(const char *fmt, ...)
+{
+	va_list ap;
+	int any, c, ch, n;
+
+	va_start(ap, fmt);
+	n = vprintf(fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		return -1;
+	if (fflush(stdout) == EOF)
+		return -1;
+
+	if ((ch = fgetc(stdin)) == EOF)
+		return -1;
+	if (ch == '\n')
+		return 1;
+
+	any = 0;
+	while ((c = fgetc(stdin)) != EOF && c != '\n')
+		any = 1;
+	if (ch == 'q' && !any)
+		return 0;
+	return -1;
+}
+
+/*
+ * Replace the optional field *dst with src, or with NULL if the letter
+ * does not have the field.
+ */
+static int
+letter_field(char **dst, const char *src, int present)
+{
+	free(*dst);
+	*dst = NULL;
+	if (present && (*dst = strdup(src)) == NULL)
+		return -1;
+	return 0;
+}
+
+/*
+ * Print the listing of letter, numbered by its place in the display
+ * order and naming its mailbox when every mailbox is shown.
+ */
+static int
+letter_print(struct command_args *args, struct letter *letter)
+{
+	struct tm tm;
+	char date[33];
+	const char *subject;
+	size_t nth;
+
+	nth = mailbox_rank(args->mailbox, letter - args->mailbox->letters) + 1;
+
+	if (localtime_r(&letter->date, &tm) == NULL)
+		return -1;
+	if (strftime(date, sizeof(date), "%a %b %d %H:%M %Y", &tm) == 0)
+		return -1;
+
+	if ((subject = letter->subject) == NULL)
+		subject = "No Subject";
+
+	if (args->nbox > 1 && args->mailbox->box == -1) {
+		if (printf("%4zu %-10.10s %-24s %-32s %-30s\n", nth,
+			   args->boxes[letter->box].ident, date,
+			   letter->from, subject) < 0)
+			return -1;
+		return 0;
+	}
+
+	if (printf("%4zu %-24s %-32s %-30s\n", nth, date,
+		   letter->from, subject) < 0)
+		return -1;
+	return 0;
+}
+
+/*
+ * Print the listing of every letter shown, in display order.
+ */
+static int
+letters_print(struct command_args *args)
+{
+	struct mailbox *mailbox;
+	size_t i;
+
+	mailbox = args->mailbox;
+	for (i = 0; i < mailbox->nshown; i++) {
+		if (letter_print(args,
+		    &mailbox->letters[mailbox_index(mailbox, i)]) == -1)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * Add the letter at index idx of mailbox->letters to set, or every
+ * letter of its thread if thread is non-zero.
+ * Letters which are not shown are left out.
+ */
+static void
+letters_add(struct mailbox *mailbox, struct mailbox_set *set, size_t idx,
+	int thread)
+{
+	struct mailbox_thread it;
+	struct letter *tp;
+
+	if (!thread) {
+		if (mailbox_rank(mailbox, idx) != SIZE_MAX)
+			mailbox_set_add(set, idx);
+		return;
+	}
+
+	mailbox_thread_init(mailbox, &it, &mailbox->letters[idx]);
+	while ((tp = mailbox_thread_next(mailbox, &it)) != NULL) {
+		idx = tp - mailbox->letters;
+		if (mailbox_rank(mailbox, idx) != SIZE_MAX)
+			mailbox_set_add(set, idx);
+	}
+}
+
+/*
+ * Add the letters matched by the selector lp to set, along with their
+ * threads if lp asks for them.
+ * Returns 0 on success and -1 on failure, printing a warning.
+ */
+static int
+letters_select(struct mailbox *mailbox, const struct mailbox_set *result,
+	struct command_letter *lp, struct mailbox_set *set)
+{
+	size_t end, i, n, start;
+
+	if (lp->type == COMMAND_LETTER_RESULT) {
+		if (result == NULL) {
+			warnx("no filter result");
+			return -1;
+		}
+		for (i = 0; i < result->nidx; i++)
+			letters_add(mailbox, set, result->idx[i], lp->thread);
+		return 0;
+	}
+
+	start = 0;
+	end = mailbox->nshown;
+
+	switch (lp->type) {
+	case COMMAND_LETTER_NUM:
+	case COMMAND_LETTER_RANGE:
+		/* These are numbered from 1, so no = */
+		if (lp->num > mailbox->nshown) {
+			warnx("letter number too large");
+			return -1;
+		}
+		start = lp->num - 1;
+		if (lp->type == COMMAND_LETTER_NUM)
+			end = lp->num;
+		else if (lp->end != 0) {
+			if (lp->end > mailbox->nshown) {
+				warnx("letter number too large");
+				return -1;
+			}
+			end = lp->end;
+		}
+		break;
+	default:
+		break;
+	}
+
+	for (n = start; n < end; n++) {
+		struct letter *letter;
+
+		i = mailbox_index(mailbox, n);
+		letter = &mailbox->letters[i];
+
+		if (lp->type == COMMAND_LETTER_FLAG) {
+			if (maildir_get_flag(letter->path, lp->flag) == lp->negate)
+				continue;
+		}
+		else if (lp->type == COMMAND_LETTER_SUBJECT) {
+			if (letter->subject == NULL)
+				continue;
+			if (strcasestr(letter->subject, lp->subject) == NULL)
+				continue;
+		}
+
+		letters_add(mailbox, set, i, lp->thread);
+	}
+
+	return 0;
+}
+
+/*
+ * Read the optional LETTER_* fields not yet read for every letter of
+ * the mailbox, keeping up to SUMMARY_QUEUE summaries outstanding.
+ */
+static int
+read_fields(struct command_args *args, int fields)
+{
+	struct content_proc *pr;
+	struct mailbox *mailbox;
+	size_t nrecv, nsend;
+
+	mailbox = args->mailbox;
+	if ((fields & ~mailbox->fields) == 0)
+		return 0;
+	fields |= mailbox->fields;
+
+	if ((pr = command_content_proc(args)) == NULL)
+		return -1;
+
+	for (nrecv = 0, nsend = 0; nrecv < mailbox->nletter;) {
+		struct content_summary sm;
+		struct letter *letter;
+		int fd;
+
+		if (nsend < mailbox->nletter && nsend - nrecv < SUMMARY_QUEUE) {
+			letter = &mailbox->letters[nsend];
+			if ((fd = openat(args->boxes[letter->box].cur,
+					 letter->path, O_RDONLY | O_CLOEXEC)) == -1) {
+				warn("%s/cur/%s", args->boxes[letter->box].maildir,
+				     letter->path);
+				goto fail;
+			}
+			if (content_proc_summary_send(pr, fd,
+			    summary_mask(fields)) == -1) {
+				warnx("content_proc_summary: %s", letter->path);
+				goto fail;
+			}
+			nsend++;
+			continue;
+		}
+
+		letter = &mailbox->letters[nrecv];
+		if (content_proc_summary_recv(pr, &sm) == -1) {
+			warnx("content_proc_summary: %s", letter->path);
+			goto fail;
+		}
+
+		if (letter_field(&letter->cc, sm.text[CNT_TEXT_CC],
+				 sm.fields & CNT_SUMMARY_CC) == -1
+		    || letter_field(&letter->in_reply_to,
+				 sm.text[CNT_TEXT_IN_REPLY_TO],
+				 sm.fields & CNT_SUMMARY_IN_REPLY_TO) == -1
+		    || letter_field(&letter->list_id, sm.text[CNT_TEXT_LIST_ID],
+				 sm.fields & CNT_SUMMARY_LIST_ID) == -1
+		    || letter_field(&letter->message_id,
+				 sm.text[CNT_TEXT_MESSAGE_ID],
+				 sm.fields & CNT_SUMMARY_MESSAGE_ID) == -1
+		    || letter_field(&letter->to, sm.text[CNT_TEXT_TO],
+				 sm.fields & CNT_SUMMARY_TO) == -1) {
+			warn(NULL);
+			goto fail;
+		}
+		letter->size = sm.size;
+		nrecv++;
+	}
+
+	mailbox->fields = fields;
+	return 0;
+
+	fail:
+	/* replies may still be outstanding */
+	command_content_proc_kill(args);
+	return -1;
+}
+
+/*
+ * Read the whole of the file at path into a newly allocated buffer.
+ */
+static int
+read_file(const char *path, char **bufp, size_t *szp)
+{
+	FILE *fp;
+	char *buf, *t;
+	size_t n, sz;
+
+	if ((fp = fopen(path, "re")) == NULL) {
+		warn("%s", path);
+		return -1;
+	}
+
+	buf = NULL;
+	n = 0;
+	sz = 0;
+	for (;;) {
+		size_t nr;
+
+		if (n == sz) {
+			if (sz > SIZE_MAX / 2 - BUFSIZ) {
+				warnc(ENOMEM, NULL);
+				goto buf;
+			}
+			if ((t = realloc(buf, sz * 2 + BUFSIZ)) == NULL) {
+				warn(NULL);
+				goto buf;
+			}
+			buf = t;
+			sz = sz * 2 + BUFSIZ;
+		}
+
+		if ((nr = fread(&buf[n], 1, sz - n, fp)) == 0) {
+			if (ferror(fp)) {
+				warn("%s", path);
+				goto buf;
+			}
+			break;
+		}
+		n += nr;
+	}
+
+	fclose(fp);
+	*bufp = buf;
+	*szp = n;
+	return 0;
+
+	buf:
+	free(buf);
+	fclose(fp);
+	return -1;
+}
+
+/*
+ * Read the summaries of the letters of every box into mailbox.
+ * Up to READ_WORKERS boxes are read at once, each by its own
+ * mailz-content process with up to SUMMARY_QUEUE requests outstanding,
+ * so that opening the next letters overlaps with reading the previous
+ * ones instead of waiting on each round trip in turn.
+ * If listing is not NULL, the letters are written to stdout in the
+ * order they are read and mailbox is left empty.
+ */
+static int
+read_letters(struct box *boxes, size_t nbox, int view_all, int fields,
+	     struct stats *stats, struct slow_log *slow,
+	     const struct listing *listing, struct mailbox *mailbox)
+{
+	struct read_worker workers[READ_WORKERS];
+	struct content_stats cs;
+	struct mailbox *per;
+	struct timespec ts;
+	size_t i, nbusy, next, ninit, nworker;
+	long ncpu;
+	int ret;
+
+	ret = -1;
+
+	mailbox_init(mailbox);
+
+	/* The letters of each maildir, merged by date once all are read. */
+	if ((per = reallocarray(NULL, nbox, sizeof(*per))) == NULL) {
+		warn(NULL);
+		return -1;
+	}
+	for (i = 0; i < nbox; i++)
+		mailbox_init(&per[i]);
+
+	nworker = READ_WORKERS;
+	if ((ncpu = sysconf(_SC_NPROCESSORS_ONLN)) > 0 &&
+	    (size_t)ncpu < nworker)
+		nworker = ncpu;
+	if (nbox < nworker)
+		nworker = nbox;
+
+	stats_begin(stats, &ts);
+	for (ninit = 0; ninit < nworker; ninit++) {
+		if (content_proc_init(&workers[ninit].pr,
+				      PATH_MAILZ_CONTENT) == -1) {
+			warnx("content_proc_init");
+			goto workers;
+		}
+		workers[ninit].box = -1;
+	}
+	stats_end(stats, STATS_SPAWN, &ts);
+	stats_add(stats, STATS_PROCS, nworker);
+
+	next = 0;
+	for (;;) {
+		nbusy = 0;
+		for (i = 0; i < nworker; i++) {
+			struct content_summary sm;
+			struct letter letter;
+			struct read_worker *w;
+			char *name;
+
+			w = &workers[i];
+			if (w->box == -1) {
+				if (next == nbox)
+					continue;
+				if (read_worker_open(w, &boxes[next], next) == -1)
+					goto workers;
+				next++;
+			}
+			nbusy++;
+
+			if (read_worker_fill(w, &boxes[w->box], view_all,
+					     fields, stats) == -1)
+				goto workers;
+
+			if (w->nqueue == 0) {
+				read_worker_close(w);
+				continue;
+			}
 
-	mailbox_thread_init(args->mailbox, &thread, letter);
+			name = w->queue[w->head];
+			stats_begin(stats, &ts);
+			if (content_proc_summary_recv(&w->pr, &sm) == -1) {
+				warnx("content_proc_summary: %s/cur/%s",
+				      boxes[w->box].maildir, name);
+				goto workers;
+			}
+			stats_end(stats, STATS_WAIT, &ts);
+			stats_add(stats, STATS_LETTERS, 1);
 
-	while ((let = mailbox_thread_next(args->mailbox, &thread)) != NULL) {
-		size_t idx;
+			if (slow_add(slow, &sm, w->box, name) == -1) {
+				warn(NULL);
+				goto workers;
+			}
 
-		idx = let - args->mailbox->letters;
-		if (letter_print(idx + 1, let) == -1)
-			return -1;
+			letter.box = w->box;
+			letter.cc = (sm.fields & CNT_SUMMARY_CC)
+			    ? (char *)sm.text[CNT_TEXT_CC] : NULL;
+			letter.date = sm.date;
+			letter.from = (char *)sm.text[CNT_TEXT_FROM];
+			letter.in_reply_to = (sm.fields & CNT_SUMMARY_IN_REPLY_TO)
+			    ? (char *)sm.text[CNT_TEXT_IN_REPLY_TO] : NULL;
+			letter.list_id = (sm.fields & CNT_SUMMARY_LIST_ID)
+			    ? (char *)sm.text[CNT_TEXT_LIST_ID] : NULL;
+			letter.message_id = (sm.fields & CNT_SUMMARY_MESSAGE_ID)
+			    ? (char *)sm.text[CNT_TEXT_MESSAGE_ID] : NULL;
+			letter.path = name;
+			letter.size = sm.size;
+			letter.subject = sm.have_subject
+			    ? (char *)sm.text[CNT_TEXT_SUBJECT] : NULL;
+			letter.to = (sm.fields & CNT_SUMMARY_TO)
+			    ? (char *)sm.text[CNT_TEXT_TO] : NULL;
+
+			if (listing != NULL) {
+				if ((listing->filter == NULL ||
+				    filter_letter(listing->filter, &letter)) &&
+				    output_letter(stdout, listing->format,
+				    boxes[w->box].ident, &letter, fields) == -1) {
+					warn("stdout");
+					goto workers;
+				}
+			}
+			else if (mailbox_add_letter(&per[w->box], &letter) == -1) {
+				warn(NULL); /* errno == ENOMEM */
+				goto workers;
+			}
+
+			free(name);
+			w->head = (w->head + 1) % SUMMARY_QUEUE;
+			w->nqueue--;
+		}
+
+		if (nbusy == 0)
+			break;
 	}
 
-	return 0;
+	stats_begin(stats, &ts);
+	for (i = 0; i < nbox; i++)
+		mailbox_sort(&per[i]);
+	if (mailbox_merge(mailbox, per, nbox) == -1) {
+		warn(NULL);
+		goto workers;
+	}
+	stats_end(stats, STATS_SORT, &ts);
+
+	/* The time of each worker is summed, they ran in parallel. */
+	for (i = 0; stats->enabled && i < nworker; i++) {
+		if (content_proc_stats(&workers[i].pr, &cs) == -1) {
+			warnx("content_proc_stats");
+			goto workers;
+		}
+		stats_add(stats, STATS_BYTES, cs.bytes);
+		stats_ns(stats, STATS_PARSE, cs.ns);
+	}
+
+	mailbox->fields = fields;
+	ret = 0;
+	workers:
+	for (i = 0; i < ninit; i++) {
+		if (workers[i].box != -1)
+			read_worker_close(&workers[i]);
+		content_proc_kill(&workers[i].pr);
+	}
+	for (i = 0; i < nbox; i++)
+		mailbox_free(&per[i]);
+	free(per);
+	if (ret == -1)
+		mailbox_free(mailbox);
+	return ret;
 }
 
-static int
-command_unread(struct letter *letter, struct command_args *args)
+/*
+ * Stop reading the box of w, leaving w idle.
+ */
+static void
+read_worker_close(struct read_worker *w)
 {
-	return command_flag(letter, args, 'S', 0);
+	size_t i;
+
+	for (i = 0; i < w->nqueue; i++)
+		free(w->queue[(w->head + i) % SUMMARY_QUEUE]);
+	closedir(w->cur);
+	w->box = -1;
 }
 
+/*
+ * Send summary requests for the next letters of the box read by w
+ * until SUMMARY_QUEUE are outstanding or the box has been read.
+ */
 static int
-content_proc_ex_ignore(struct content_proc *pr,
-		       const struct mailz_ignore *ignore)
+read_worker_fill(struct read_worker *w, struct box *box, int view_all,
+	int fields, struct stats *stats)
 {
-	size_t i;
-	int type;
+	while (!w->eof && w->nqueue < SUMMARY_QUEUE) {
+		struct dirent *de;
+		struct timespec ts;
+		char *name;
+		int fd;
 
-	if (ignore->type == MAILZ_IGNORE_IGNORE)
-		type = CNT_IGNORE_IGNORE;
-	else
-		type = CNT_IGNORE_RETAIN;
+		errno = 0;
+		if ((de = readdir(w->cur)) == NULL) {
+			if (errno != 0) {
+				warn("readdir");
+				return -1;
+			}
+			w->eof = 1;
+			break;
+		}
+
+		if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+			continue;
+
+		if (!view_all && maildir_get_flag(de->d_name, 'S'))
+			continue;
 
-	for (i = 0; i < ignore->nheader; i++)
-		if (content_proc_ignore(pr, ignore->headers[i],
-					type) == -1)
+		if ((name = strdup(de->d_name)) == NULL) {
+			warn(NULL);
 			return -1;
-	return 0;
-}
+		}
 
-static int
-letter_print(size_t nth, struct letter *letter)
-{
-	struct tm tm;
-	char date[33];
-	const char *subject;
+		stats_begin(stats, &ts);
+		if ((fd = openat(w->curfd, name, O_RDONLY | O_CLOEXEC)) == -1) {
+			warn("%s/cur/%s", box->maildir, name);
+			free(name);
+			return -1;
+		}
+		stats_end(stats, STATS_OPEN, &ts);
 
-	if (localtime_r(&letter->date, &tm) == NULL)
-		return -1;
-	if (strftime(date, sizeof(date), "%a %b %d %H:%M %Y", &tm) == 0)
-		return -1;
+		if (content_proc_summary_send(&w->pr, fd,
+		    summary_mask(fields)) == -1) {
+			warnx("content_proc_summary: %s/cur/%s", box->maildir,
+			      name);
+			free(name);
+			return -1;
+		}
+		stats_add(stats, STATS_FDS, 1);
 
-	if ((subject = letter->subject) == NULL)
-		subject = "No Subject";
+		w->queue[(w->head + w->nqueue) % SUMMARY_QUEUE] = name;
+		w->nqueue++;
+	}
 
-	if (printf("%4zu %-24s %-32s %-30s\n", nth, date,
-		   letter->from, subject) < 0)
-		return -1;
 	return 0;
 }
 
+/*
+ * Start reading box, numbered nth, with the idle worker w.
+ */
 static int
-read_letters(const char *maildir, int ocur, int view_all,
-	     struct mailbox *mailbox)
+read_worker_open(struct read_worker *w, struct box *box, int nth)
 {
-	DIR *cur;
-	struct content_proc pr;
-	int curfd, ret;
-
-	ret = -1;
+	int curfd;
 
-	if ((curfd = dup(ocur)) == -1) {
+	if ((curfd = dup(box->cur)) == -1) {
 		warn("dup");
 		return -1;
 	}
@@ -595,67 +2652,43 @@ read_letters(const char *maildir, int ocur, int view_all,
 		close(curfd);
 		return -1;
 	}
-	if ((cur = fdopendir(curfd)) == NULL) {
+	if ((w->cur = fdopendir(curfd)) == NULL) {
 		warn("fdopendir");
 		close(curfd);
 		return -1;
 	}
 
-	if (content_proc_init(&pr, PATH_MAILZ_CONTENT) == -1) {
-		warnx("content_proc_init");
-		goto cur;
-	}
-	mailbox_init(mailbox);
-
-	for (;;) {
-		struct content_summary sm;
-		struct letter letter;
-		struct dirent *de;
-		int fd;
-
-		errno = 0;
-		if ((de = readdir(cur)) == NULL) {
-			if (errno == 0)
-				break;
-			warn("readdir");
-			goto letters;
-		}
-
-		if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
-			continue;
-
-		if (!view_all && maildir_get_flag(de->d_name, 'S'))
-			continue;
-
-		if ((fd = openat(curfd, de->d_name, O_RDONLY | O_CLOEXEC)) == -1) {
-			warn("%s/cur/%s", maildir, de->d_name);
-			goto letters;
-		}
-		if (content_proc_summary(&pr, &sm, fd) == -1) {
-			warnx("content_proc_summary: %s/cur/%s", maildir, de->d_name);
-			goto letters;
-		}
+	w->box = nth;
+	w->curfd = curfd;
+	w->eof = 0;
+	w->head = 0;
+	w->nqueue = 0;
+	return 0;
+}
 
-		letter.date = sm.date;
-		letter.from = sm.from;
-		letter.path = de->d_name;
-		letter.subject = sm.have_subject ? sm.subject : NULL;
+static int
+sendmail(int fd)
+{
+	pid_t pid;
+	int status;
 
-		if (mailbox_add_letter(mailbox, &letter) == -1) {
-			warn(NULL); /* errno == ENOMEM */
-			goto letters;
-		}
+	switch (pid = fork()) {
+	case -1:
+		return -1;
+	case 0:
+		if (dup2(fd, STDIN_FILENO) == -1)
+			err_fork(1, "dup2");
+		execl(PATH_SENDMAIL, "sendmail", "-t", NULL);
+		err_fork(1, "%s", PATH_SENDMAIL);
+	default:
+		break;
 	}
 
-	mailbox_sort(mailbox);
-	ret = 0;
-	letters:
-	if (ret == -1)
-		mailbox_free(mailbox);
-	content_proc_kill(&pr);
-	cur:
-	closedir(cur);
-	return ret;
+	if (waitpid(pid, &status, 0) == -1)
+		return -1;
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return -1;
+	return 0;
 }
 
 static int
@@ -720,31 +2753,220 @@ setup_letters(const char *maildir, int root, int cur)
 	return rv;
 }
 
+/*
+ * Add the letter name of box to slow if it is among the slowest
+ * summarized so far.
+ */
+static int
+slow_add(struct slow_log *slow, const struct content_summary *sm, int box,
+	const char *name)
+{
+	struct slow_letter *sl;
+	size_t i;
+
+	i = slow->nletter;
+	if (i == SLOW_LETTERS) {
+		if (sm->ns <= slow->letters[i - 1].ns)
+			return 0;
+		free(slow->letters[--i].name);
+		slow->nletter--;
+	}
+
+	for (; i > 0 && slow->letters[i - 1].ns < sm->ns; i--)
+		slow->letters[i] = slow->letters[i - 1];
+
+	sl = &slow->letters[i];
+	if ((sl->name = strdup(name)) == NULL) {
+		/* Close the gap left for the letter. */
+		for (; i < slow->nletter; i++)
+			slow->letters[i] = slow->letters[i + 1];
+		return -1;
+	}
+	sl->box = box;
+	sl->ns = sm->ns;
+	sl->parsed = sm->parsed;
+	slow->nletter++;
+	return 0;
+}
+
+static void
+slow_free(struct slow_log *slow)
+{
+	size_t i;
+
+	for (i = 0; i < slow->nletter; i++)
+		free(slow->letters[i].name);
+	slow->nletter = 0;
+}
+
+/*
+ * Replace tmpdir/slow with the letters of slow, a line for each with
+ * the milliseconds and bytes taken to summarize it and its path.
+ */
+static int
+slow_write(const struct slow_log *slow, const struct box *boxes,
+	const char *tmpdir)
+{
+	FILE *fp;
+	char path[PATH_MAX], tmp[PATH_MAX];
+	size_t i;
+	int fd, n;
+
+	n = snprintf(path, sizeof(path), "%s/slow", tmpdir);
+	if (n < 0 || (size_t)n >= sizeof(path)) {
+		warnc(ENAMETOOLONG, "%s/slow", tmpdir);
+		return -1;
+	}
+	n = snprintf(tmp, sizeof(tmp), "%s.XXXXXXXXXX", path);
+	if (n < 0 || (size_t)n >= sizeof(tmp)) {
+		warnc(ENAMETOOLONG, "%s", path);
+		return -1;
+	}
+
+	if ((fd = mkostemp(tmp, O_CLOEXEC)) == -1) {
+		warn("%s", tmp);
+		return -1;
+	}
+	if ((fp = fdopen(fd, "w")) == NULL) {
+		warn("fdopen");
+		close(fd);
+		goto tmp;
+	}
+
+	for (i = 0; i < slow->nletter; i++) {
+		const struct slow_letter *sl;
+
+		sl = &slow->letters[i];
+		if (fprintf(fp, "%llu.%03llu\t%lld\t%s/cur/%s\n",
+		    (unsigned long long)(sl->ns / 1000000),
+		    (unsigned long long)(sl->ns / 1000 % 1000),
+		    (long long)sl->parsed, boxes[sl->box].maildir,
+		    sl->name) < 0) {
+			warn("%s", tmp);
+			fclose(fp);
+			goto tmp;
+		}
+	}
+	if (fclose(fp) == EOF) {
+		warn("%s", tmp);
+		goto tmp;
+	}
+
+	if (rename(tmp, path) == -1) {
+		warn("rename %s to %s", tmp, path);
+		goto tmp;
+	}
+
+	return 0;
+
+	tmp:
+	unlink(tmp);
+	return -1;
+}
+
+/*
+ * Set *fields to the mask of LETTER_* fields named by the summary
+ * directive of conf.
+ */
+static int
+summary_conf(const struct mailz_conf *conf, int *fields)
+{
+	size_t i, j;
+
+	*fields = 0;
+	for (i = 0; i < conf->summary.nfield; i++) {
+		for (j = 0; j < nitems(summary_fields); j++) {
+			if (!strcasecmp(conf->summary.fields[i],
+					summary_fields[j].ident))
+				break;
+		}
+		if (j == nitems(summary_fields)) {
+			warnx("unknown summary field %s",
+			      conf->summary.fields[i]);
+			return -1;
+		}
+		*fields |= summary_fields[j].letter;
+	}
+	return 0;
+}
+
+/*
+ * Convert a mask of LETTER_* fields to the matching CNT_SUMMARY_* mask.
+ */
+static int
+summary_mask(int fields)
+{
+	size_t i;
+	int rv;
+
+	rv = 0;
+	for (i = 0; i < nitems(summary_fields); i++) {
+		if (fields & summary_fields[i].letter)
+			rv |= summary_fields[i].summary;
+	}
+	return rv;
+}
+
 static void
 usage(void)
 {
-	fprintf(stderr, "usage: mailz [-a] mailbox\n");
+	fprintf(stderr, "usage: mailz [-abv] [-c commands] [-f filter] "
+	    "[-o format] [mailbox ...]\n");
 	exit(2);
 }
 
 int
 main(int argc, char *argv[])
 {
-	char *home, *slash, tmpdir[PATH_MAX];
-	const char *address, *maildir;
+	char *batch, *home, *template, tmpdir[PATH_MAX];
+	struct box *boxes;
 	struct mailz_conf conf;
 	struct mailz_conf_mailbox *conf_mailbox;
+	struct filter filter;
+	struct listing listing;
 	struct mailbox mailbox;
-	int ch, cur, n, root, rv, view_all;
+	struct slow_log slow;
+	struct stats stats;
+	struct timespec ts;
+	size_t i, nbox, nopen, templatesz;
+	int ch, fields, have_batch, have_filter, have_listing, n, rv, verbose;
+	int view_all;
 
 	rv = 1;
-
+	template = NULL;
+	templatesz = 0;
+
+	batch = NULL;
+	have_batch = 0;
+	have_filter = 0;
+	have_listing = 0;
+	verbose = 0;
 	view_all = 0;
-	while ((ch = getopt(argc, argv, "a")) != -1) {
+	while ((ch = getopt(argc, argv, "abc:f:o:v")) != -1) {
 		switch (ch) {
 		case 'a':
 			view_all = 1;
 			break;
+		case 'b':
+			have_batch = 1;
+			break;
+		case 'c':
+			batch = optarg;
+			have_batch = 1;
+			break;
+		case 'f':
+			if (filter_parse(&filter, optarg) == -1)
+				errx(1, "invalid filter: %s", optarg);
+			have_filter = 1;
+			break;
+		case 'o':
+			if (output_format(optarg, &listing.format) == -1)
+				errx(1, "unknown output format: %s", optarg);
+			have_listing = 1;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
 		default:
 			usage();
 		}
@@ -753,64 +2975,84 @@ main(int argc, char *argv[])
 	argc -= optind;
 	argv += optind;
 
-	if (argc != 1)
+	if (have_batch && have_listing)
 		usage();
 
-	/*
-	 * Delete trailing slash to make error messages nicer.
-	 */
-	if ((slash = strrchr(argv[0], '/')) != NULL && slash[1] == '\0')
-		*slash = '\0';
-
 	if (setlocale(LC_CTYPE, "C.UTF-8") == NULL)
 		errx(1, "setlocale");
 	signal(SIGPIPE, SIG_IGN);
+	slow.nletter = 0;
+	stats_init(&stats, verbose);
 
 	if (mailz_conf_init(&conf) == -1)
 		return 1;
-	if ((conf_mailbox = mailz_conf_mailbox(&conf, argv[0])) != NULL) {
-		if (strlen(conf_mailbox->address) != 0)
-			address = conf_mailbox->address;
-		else
-			address = conf.address;
-		maildir = conf_mailbox->maildir;
-	}
-	else {
-		address = conf.address;
-		maildir = argv[0];
+
+	/* Without operands, read every configured mailbox. */
+	if (argc == 0) {
+		conf_mailbox = NULL;
+		while ((conf_mailbox = mailz_conf_mailbox_next(&conf,
+		    conf_mailbox)) != NULL)
+			argc++;
+		if (argc == 0)
+			usage();
 	}
+	nbox = argc;
 
-	if ((root = open(maildir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
-		warn("%s", maildir);
+	if ((boxes = reallocarray(NULL, nbox, sizeof(*boxes))) == NULL) {
+		warn(NULL);
 		goto conf;
 	}
-	if ((cur = openat(root, "cur", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
-		warn("%s/cur", maildir);
-		goto root;
+
+	conf_mailbox = NULL;
+	for (nopen = 0; nopen < nbox; nopen++) {
+		char *ident;
+
+		if (argv[0] == NULL) {
+			conf_mailbox = mailz_conf_mailbox_next(&conf,
+			    conf_mailbox);
+			ident = conf_mailbox->ident;
+		}
+		else
+			ident = argv[nopen];
+
+		if (box_open(&boxes[nopen], &conf, ident) == -1)
+			goto boxes;
+	}
+
+	if (summary_conf(&conf, &fields) == -1)
+		goto boxes;
+	if (have_filter)
+		fields |= filter_fields(&filter);
+
+	if (conf.template != NULL) {
+		if (read_file(conf.template, &template, &templatesz) == -1)
+			goto boxes;
 	}
 
 	if ((home = getenv("HOME")) == NULL) {
 		warnx("HOME not set");
-		goto cur;
+		goto boxes;
 	}
 
 	n = snprintf(tmpdir, sizeof(tmpdir), "%s/.mailz", home);
 	if (n < 0 || (size_t)n >= sizeof(tmpdir)) {
 		warnx("snprintf overflow due to large HOME");
-		goto cur;
+		goto boxes;
 	}
 	if (mkdir(tmpdir, 0700) == -1 && errno != EEXIST) {
 		warn("%s", tmpdir);
-		goto cur;
+		goto boxes;
 	}
 
 	if (unveil(tmpdir, "rwc") == -1) {
 		warn("%s", tmpdir);
 		goto tmpdir;
 	}
-	if (unveil(maildir, "rc") == -1) {
-		warn("%s", maildir);
-		goto tmpdir;
+	for (i = 0; i < nbox; i++) {
+		if (unveil(boxes[i].maildir, "rc") == -1) {
+			warn("%s", boxes[i].maildir);
+			goto tmpdir;
+		}
 	}
 	if (unveil(PATH_LESS, "x") == -1) {
 		warn("%s", PATH_LESS);
@@ -827,40 +3069,133 @@ main(int argc, char *argv[])
 	if (pledge("stdio rpath wpath cpath sendfd proc exec", NULL) == -1)
 		err(1, "pledge");
 
-	if (setup_letters(maildir, root, cur) == -1)
-		goto tmpdir;
+	stats_begin(&stats, &ts);
+	for (i = 0; i < nbox; i++) {
+		if (setup_letters(boxes[i].maildir, boxes[i].root,
+				  boxes[i].cur) == -1)
+			goto tmpdir;
+	}
+	stats_end(&stats, STATS_SETUP, &ts);
+
+	if (have_listing) {
+		listing.filter = have_filter ? &filter : NULL;
+		if (output_header(stdout, listing.format, fields) == -1) {
+			warn("stdout");
+			goto tmpdir;
+		}
+		if (read_letters(boxes, nbox, view_all, fields, &stats, &slow,
+				 &listing, &mailbox) == -1)
+			goto tmpdir;
+		if (verbose)
+			slow_write(&slow, boxes, tmpdir);
+		if (fflush(stdout) == EOF) {
+			warn("stdout");
+			goto mailbox;
+		}
+		rv = 0;
+		goto mailbox;
+	}
 
-	if (read_letters(maildir, cur, view_all, &mailbox) == -1)
+	if (read_letters(boxes, nbox, view_all, fields, &stats, &slow, NULL,
+			 &mailbox) == -1)
 		goto tmpdir;
+	/* The log is only a diagnostic, failing to write it is not fatal. */
+	if (verbose)
+		slow_write(&slow, boxes, tmpdir);
+
+	if (have_filter) {
+		unsigned char *keep;
+
+		if ((keep = calloc(mailbox.nletter + 1, sizeof(*keep))) == NULL) {
+			warn(NULL);
+			goto mailbox;
+		}
+		filter_run(&filter, &mailbox, keep);
+		mailbox_keep(&mailbox, keep);
+		free(keep);
+	}
 
-	if (mailbox.nletter == 0)
+	/*
+	 * Batch commands are run even with no letters, as send and mailbox
+	 * need none and selectors fail on an empty set.
+	 */
+	if (mailbox.nletter == 0 && !have_batch)
 		puts("No mail.");
 	else {
 		struct command_args args;
-		size_t i;
+		struct ignore ignore;
+		FILE *fp;
+		char *sep;
+		int type;
 
-		for (i = 0; i < mailbox.nletter; i++)
-			letter_print(i + 1, &mailbox.letters[i]);
+		if (conf.ignore.type == MAILZ_IGNORE_IGNORE)
+			type = IGNORE_IGNORE;
+		else
+			type = IGNORE_RETAIN;
+		if (ignore_build(&ignore, conf.ignore.headers,
+				 conf.ignore.nheader, type) == -1) {
+			warnx("ignore_build");
+			goto mailbox;
+		}
+
+		fp = stdin;
+		if (batch != NULL) {
+			/* Commands given with -c are separated by ';'. */
+			for (sep = batch; (sep = strchr(sep, ';')) != NULL;)
+				*sep = '\n';
+			if ((fp = fmemopen(batch, strlen(batch), "r")) == NULL) {
+				warn("fmemopen");
+				ignore_free(&ignore);
+				goto mailbox;
+			}
+		}
 
-		args.addr = address;
-		args.cur = cur;
-		args.ignore = &conf.ignore;
+		args.batch = have_batch;
+		args.boxes = boxes;
+		args.have_pr = 0;
+		args.have_result = 0;
+		args.have_search = 0;
+		args.ignore = &ignore;
 		args.mailbox = &mailbox;
-		args.maildir = maildir;
+		args.nbox = nbox;
+		args.template = template;
+		args.templatesz = templatesz;
+		args.text = NULL;
 		args.tmpdir = tmpdir;
+		command_box(&args, 0);
+
+		if (!have_batch)
+			letters_print(&args);
+
+		n = commands_run(&args, fp);
+
+		if (fp != stdin)
+			fclose(fp);
+		if (args.have_result)
+			mailbox_set_free(&args.result);
+		if (args.have_search)
+			search_free(&args.search);
+		ignore_free(&ignore);
 
-		commands_run(&args);
+		/* Failed commands only change the exit status in batch mode. */
+		if (n == -1 && have_batch)
+			goto mailbox;
 	}
 
 	rv = 0;
+	mailbox:
 	mailbox_free(&mailbox);
 	tmpdir:
+	slow_free(&slow);
 	rmdir(tmpdir);
-	cur:
-	close(cur);
-	root:
-	close(root);
+	boxes:
+	for (i = 0; i < nopen; i++)
+		box_close(&boxes[i]);
+	free(boxes);
 	conf:
+	free(template);
 	mailz_conf_free(&conf);
+	if (verbose && stats_print(&stats, stderr) == -1)
+		rv = 1;
 	return rv;
 }
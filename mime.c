@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mime.h"
+
+#define MIME_BUFSZ 16384
+
+static int mime_fill(struct mime *);
+static int mime_getc(struct mime *);
+static int mime_read(void *, char *, int);
+static int mime_scan(struct mime *);
+
+/*
+ * Move what is left of the buffer to its start and read more of the
+ * input after it.
+ */
+static int
+mime_fill(struct mime *m)
+{
+	size_t n;
+
+	memmove(m->buf, m->buf + m->off, m->len - m->off);
+	m->len -= m->off;
+	m->end -= m->off;
+	m->off = 0;
+
+	n = fread(m->buf + m->len, 1, MIME_BUFSZ - m->len, m->in);
+	if (n == 0) {
+		if (ferror(m->in))
+			return -1;
+		m->eof = 1;
+	}
+	m->len += n;
+	return 0;
+}
+
+void
+mime_free(struct mime *m)
+{
+	free(m->buf);
+}
+
+static int
+mime_getc(struct mime *m)
+{
+	if (m->off == m->len) {
+		if (m->eof || mime_fill(m) == -1 || m->off == m->len)
+			return EOF;
+	}
+	m->end = ++m->off;
+	return (unsigned char)m->buf[m->off - 1];
+}
+
+/*
+ * Start reading the multipart body in, whose parts are separated by
+ * boundary.
+ * The preamble before the first part is skipped by mime_next.
+ */
+int
+mime_init(struct mime *m, FILE *in, const char *boundary)
+{
+	size_t len;
+
+	if ((len = strlen(boundary)) == 0 || len > MIME_BOUNDARY_MAX)
+		return -1;
+
+	memset(m, 0, sizeof(*m));
+	if ((m->buf = malloc(MIME_BUFSZ)) == NULL)
+		return -1;
+	m->in = in;
+	m->delimsz = len + 3;
+	memcpy(m->delim, "\n--", 3);
+	memcpy(m->delim + 3, boundary, len);
+
+	/* The first delimiter need not follow a line break. */
+	m->buf[0] = '\n';
+	m->len = 1;
+	m->lead = 1;
+	m->state = MIME_PREAMBLE;
+	return 0;
+}
+
+/*
+ * Skip the rest of the preamble or of the current part, and the
+ * delimiter after it.
+ * Returns 1 if another part follows, 0 after the last part and -1
+ * if the input could not be read.
+ */
+int
+mime_next(struct mime *m)
+{
+	int ch, close;
+
+	if (m->state == MIME_END)
+		return 0;
+
+	for (;;) {
+		if (mime_scan(m) == -1)
+			return -1;
+		if (m->off == m->end)
+			break;
+		m->off = m->end;
+	}
+
+	/* A body without a closing delimiter ends with the input. */
+	if (!m->atdelim) {
+		m->state = MIME_END;
+		return 0;
+	}
+
+	if (m->buf[m->off] == '\r')
+		m->off++;
+	m->off += m->delimsz;
+	m->end = m->off;
+	m->atdelim = 0;
+
+	close = 0;
+	ch = mime_getc(m);
+	if (ch == '-' && (ch = mime_getc(m)) == '-')
+		close = 1;
+	/* The rest of the line is transport padding. */
+	while (ch != '\n' && ch != EOF)
+		ch = mime_getc(m);
+	if (ferror(m->in))
+		return -1;
+
+	if (close || ch == EOF) {
+		m->state = MIME_END;
+		return 0;
+	}
+
+	/* The line break can also begin the delimiter after an empty part. */
+	m->end = --m->off;
+	m->lead = 1;
+	m->state = MIME_PART;
+	return 1;
+}
+
+/*
+ * A stream of the current part, up to the line break before the
+ * next delimiter.
+ * It must be closed before mime_next is called again.
+ */
+FILE *
+mime_part(struct mime *m)
+{
+	if (m->state != MIME_PART)
+		return NULL;
+	return funopen(m, mime_read, NULL, NULL, NULL);
+}
+
+static int
+mime_read(void *cookie, char *buf, int bufsz)
+{
+	struct mime *m;
+	size_t n;
+
+	m = cookie;
+
+	if (bufsz < 0)
+		return -1;
+	if (m->state != MIME_PART)
+		return 0;
+
+	if (mime_scan(m) == -1)
+		return -1;
+
+	n = m->end - m->off;
+	if (n > (size_t)bufsz)
+		n = bufsz;
+
+	memcpy(buf, &m->buf[m->off], n);
+	m->off += n;
+	return n;
+}
+
+/*
+ * Make sure some of the part is known to be in the buffer unless a
+ * delimiter or the end of the input has been reached, so that
+ * m->off == m->end means the part is over.
+ * A leading line break is that of the line before and is dropped
+ * unless it begins a delimiter.
+ */
+static int
+mime_scan(struct mime *m)
+{
+	const char *p;
+	size_t n;
+
+	while (m->off == m->end && !m->atdelim) {
+		n = m->len - m->off;
+		p = memmem(m->buf + m->off, n, m->delim, m->delimsz);
+		if (p != NULL) {
+			if (m->lead && p != m->buf + m->off)
+				m->off++;
+			m->lead = 0;
+			m->end = p - m->buf;
+			if (m->end > m->off && m->buf[m->end - 1] == '\r')
+				m->end--;
+			m->atdelim = 1;
+			break;
+		}
+		if (m->lead && (n >= m->delimsz || m->eof)) {
+			m->end = ++m->off;
+			m->lead = 0;
+			continue;
+		}
+		if (m->eof) {
+			m->end = m->len;
+			break;
+		}
+
+		/*
+		 * The last delimsz bytes could be a CR and the start
+		 * of a delimiter.
+		 */
+		if (n > m->delimsz) {
+			m->end = m->len - m->delimsz;
+			break;
+		}
+		if (mime_fill(m) == -1)
+			return -1;
+	}
+	return 0;
+}
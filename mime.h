@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef MIME_H
+#define MIME_H
+
+/* Longest boundary allowed by RFC 2046. */
+#define MIME_BOUNDARY_MAX 70
+/* Deepest nesting of multipart entities that is walked. */
+#define MIME_DEPTH_MAX 8
+
+/*
+ * A reader of the parts of a multipart body, split at each line
+ * beginning with the delimiter "--" boundary.
+ * The body is read in large blocks that are searched for the
+ * delimiter with memmem, so skipping a part costs no more than
+ * finding where it ends.
+ */
+struct mime {
+	FILE *in;
+	char *buf;
+	size_t off; /* next byte to read */
+	size_t end; /* bytes before this are known to be in the part */
+	size_t len;
+	char delim[MIME_BOUNDARY_MAX + 4]; /* "\n--" boundary */
+	size_t delimsz;
+	int atdelim; /* a delimiter starts at end */
+	int lead; /* off is at the line break ending the last line */
+	int eof;
+	#define MIME_PREAMBLE 0
+	#define MIME_PART 1
+	#define MIME_END 2
+	int state;
+};
+
+void mime_free(struct mime *);
+int mime_init(struct mime *, FILE *, const char *);
+int mime_next(struct mime *);
+FILE *mime_part(struct mime *);
+
+#endif /* MIME_H */
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Machine readable listings of letters, one record per line.
+ * JSON records are objects, TSV records have a column for every field
+ * and backslash escape tabs, newlines and backslashes.
+ * Optional fields are only written if they were read, and are null in
+ * JSON or empty in TSV for letters without them.
+ */
+
+#include <sys/types.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "mailbox.h"
+#include "output.h"
+
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+static const struct {
+	const char *ident;
+	int field;
+} fields[] = {
+	{ "cc",			LETTER_CC },
+	{ "in-reply-to",	LETTER_IN_REPLY_TO },
+	{ "list-id",		LETTER_LIST_ID },
+	{ "message-id",		LETTER_MESSAGE_ID },
+	{ "size",		LETTER_SIZE },
+	{ "to",			LETTER_TO },
+};
+
+static const struct {
+	const char *ident;
+	enum output_format format;
+} formats[] = {
+	{ "json",	OUTPUT_JSON },
+	{ "tsv",	OUTPUT_TSV },
+};
+
+static void json_string(FILE *, const char *);
+static const char *letter_text(const struct letter *, int);
+static void tsv_string(FILE *, const char *);
+
+static void
+json_string(FILE *fp, const char *s)
+{
+	if (s == NULL) {
+		fputs("null", fp);
+		return;
+	}
+
+	putc('"', fp);
+	for (; *s != '\0'; s++) {
+		unsigned char ch;
+
+		ch = *s;
+		if (ch == '"' || ch == '\\')
+			fprintf(fp, "\\%c", ch);
+		else if (ch < 0x20 || ch == 0x7f)
+			fprintf(fp, "\\u%04x", ch);
+		else
+			putc(ch, fp);
+	}
+	putc('"', fp);
+}
+
+static const char *
+letter_text(const struct letter *letter, int field)
+{
+	switch (field) {
+	case LETTER_CC:
+		return letter->cc;
+	case LETTER_IN_REPLY_TO:
+		return letter->in_reply_to;
+	case LETTER_LIST_ID:
+		return letter->list_id;
+	case LETTER_MESSAGE_ID:
+		return letter->message_id;
+	case LETTER_TO:
+		return letter->to;
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Find the output format named ident.
+ * Returns 0 on success and -1 if there is no such format.
+ */
+int
+output_format(const char *ident, enum output_format *format)
+{
+	size_t i;
+
+	for (i = 0; i < nitems(formats); i++) {
+		if (!strcmp(formats[i].ident, ident)) {
+			*format = formats[i].format;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Write the line naming the columns of a TSV listing of the optional
+ * fields in mask, JSON listings have no such line.
+ * Returns 0 on success and -1 on failure.
+ */
+int
+output_header(FILE *fp, enum output_format format, int mask)
+{
+	size_t i;
+
+	if (format != OUTPUT_TSV)
+		return 0;
+
+	fputs("mailbox\tpath\tdate\tfrom\tsubject", fp);
+	for (i = 0; i < nitems(fields); i++) {
+		if (mask & fields[i].field)
+			fprintf(fp, "\t%s", fields[i].ident);
+	}
+	putc('\n', fp);
+
+	return ferror(fp) ? -1 : 0;
+}
+
+/*
+ * Write the record of letter from the mailbox named box, with the
+ * optional fields in mask.
+ * Returns 0 on success and -1 on failure.
+ */
+int
+output_letter(FILE *fp, enum output_format format, const char *box,
+	const struct letter *letter, int mask)
+{
+	size_t i;
+
+	switch (format) {
+	case OUTPUT_JSON:
+		fputs("{\"mailbox\":", fp);
+		json_string(fp, box);
+		fputs(",\"path\":", fp);
+		json_string(fp, letter->path);
+		fprintf(fp, ",\"date\":%lld,\"from\":", (long long)letter->date);
+		json_string(fp, letter->from);
+		fputs(",\"subject\":", fp);
+		json_string(fp, letter->subject);
+		for (i = 0; i < nitems(fields); i++) {
+			if (!(mask & fields[i].field))
+				continue;
+			fprintf(fp, ",\"%s\":", fields[i].ident);
+			if (fields[i].field == LETTER_SIZE)
+				fprintf(fp, "%lld", (long long)letter->size);
+			else
+				json_string(fp,
+				    letter_text(letter, fields[i].field));
+		}
+		fputs("}\n", fp);
+		break;
+	case OUTPUT_TSV:
+		tsv_string(fp, box);
+		putc('\t', fp);
+		tsv_string(fp, letter->path);
+		fprintf(fp, "\t%lld\t", (long long)letter->date);
+		tsv_string(fp, letter->from);
+		putc('\t', fp);
+		tsv_string(fp, letter->subject);
+		for (i = 0; i < nitems(fields); i++) {
+			if (!(mask & fields[i].field))
+				continue;
+			putc('\t', fp);
+			if (fields[i].field == LETTER_SIZE)
+				fprintf(fp, "%lld", (long long)letter->size);
+			else
+				tsv_string(fp,
+				    letter_text(letter, fields[i].field));
+		}
+		putc('\n', fp);
+		break;
+	}
+
+	return ferror(fp) ? -1 : 0;
+}
+
+static void
+tsv_string(FILE *fp, const char *s)
+{
+	if (s == NULL)
+		return;
+
+	for (; *s != '\0'; s++) {
+		switch (*s) {
+		case '\\':
+			fputs("\\\\", fp);
+			break;
+		case '\n':
+			fputs("\\n", fp);
+			break;
+		case '\r':
+			fputs("\\r", fp);
+			break;
+		case '\t':
+			fputs("\\t", fp);
+			break;
+		default:
+			putc(*s, fp);
+			break;
+		}
+	}
+}
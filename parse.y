@@ -56,7 +56,8 @@ static struct mailz_conf_mailbox *mailbox;
 	} argv;
 }
 
-%token ADDRESS IGNORE MAILBOX MAILDIR OVERLONG PATH RETAIN
+%token ADDRESS IGNORE MAILBOX MAILDIR OVERLONG PATH RETAIN SUMMARY
+%token TEMPLATE
 %token<string> STRING
 %type<argv> strings
 %type<number> ignore_type
@@ -65,6 +66,8 @@ grammar: /* empty */
 	| grammar address '\n'
 	| grammar ignore '\n'
 	| grammar mailbox '\n'
+	| grammar summary '\n'
+	| grammar template '\n'
 	| grammar '\n'
 	;
 
@@ -132,6 +135,19 @@ ignore: ignore_type strings {
 	}
 	;
 
+summary: SUMMARY strings {
+		argv_free(conf->summary.fields, conf->summary.nfield);
+		conf->summary.fields = $2.argv;
+		conf->summary.nfield = $2.argc;
+	}
+	;
+
+template: TEMPLATE PATH STRING {
+		free(conf->template);
+		conf->template = maildir_expand($3);
+	}
+	;
+
 strings: STRING {
 		$$.argv = reallocarray(NULL, 1, sizeof(*$$.argv));
 		if ($$.argv == NULL) {
@@ -267,6 +283,8 @@ mailz_conf_free(struct mailz_conf *c)
 	struct mailz_conf_mailbox *mb, *t;
 
 	argv_free(c->ignore.headers, c->ignore.nheader);
+	argv_free(c->summary.fields, c->summary.nfield);
+	free(c->template);
 
 	RB_FOREACH_SAFE(mb, mailz_conf_mailboxes, &c->mailboxes, t) {
 		RB_REMOVE(mailz_conf_mailboxes, &c->mailboxes, mb);
@@ -320,6 +338,18 @@ mailz_conf_mailbox(struct mailz_conf *c, char *ident)
 	return RB_FIND(mailz_conf_mailboxes, &c->mailboxes, &mb);
 }
 
+/*
+ * Returns the configured mailbox after mb, or the first one if mb is
+ * NULL, in order of their names.
+ */
+struct mailz_conf_mailbox *
+mailz_conf_mailbox_next(struct mailz_conf *c, struct mailz_conf_mailbox *mb)
+{
+	if (mb == NULL)
+		return RB_MIN(mailz_conf_mailboxes, &c->mailboxes);
+	return RB_NEXT(mailz_conf_mailboxes, &c->mailboxes, mb);
+}
+
 static void
 yyerror(const char *s)
 {
@@ -29,7 +29,12 @@ command_test(void)
 	struct command_letter_test {
 		int error;
 		int thread;
+		enum command_letter_type type;
 		size_t num;
+		size_t end;
+		int flag;
+		int negate;
+		const char *subject;
 	};
 	const struct {
 		char *input;
@@ -39,12 +44,41 @@ command_test(void)
 		struct command_letter_test *letters;
 		size_t nletter;
 	} tests[] = {
-		#define LETTER(error, thread, num) { error, thread, num }
+		#define LETTER(error, thread, num) \
+			{ error, thread, COMMAND_LETTER_NUM, num, 0, 0, 0, "" }
+		#define RANGE(thread, num, end) \
+			{ COMMAND_OK, thread, COMMAND_LETTER_RANGE, num, end, 0, 0, "" }
+		#define ALL(thread) \
+			{ COMMAND_OK, thread, COMMAND_LETTER_ALL, 0, 0, 0, 0, "" }
+		#define RESULT(thread) \
+			{ COMMAND_OK, thread, COMMAND_LETTER_RESULT, 0, 0, 0, 0, "" }
+		#define FLAG(thread, flag, negate) \
+			{ COMMAND_OK, thread, COMMAND_LETTER_FLAG, 0, 0, flag, negate, "" }
+		#define SUBJECT(thread, subject) \
+			{ COMMAND_OK, thread, COMMAND_LETTER_SUBJECT, 0, 0, 0, 0, subject }
 		#define LETTERS(...) (struct command_letter_test []) { __VA_ARGS__ }, \
 				 nitems(((struct command_letter_test []) { __VA_ARGS__ }))
 		{ "read 1\n", 0, COMMAND_OK, "read", LETTERS(LETTER(0, 0, 1)) },
 		{ "read t 1\n", 0, COMMAND_OK, "read", LETTERS(LETTER(0, 1, 1)) },
 		{ "read t\n", 0, COMMAND_OK, "read", LETTERS(LETTER(COMMAND_THREAD_EOF, 0, 0)) },
+		{ "read 1 3\n", 0, COMMAND_OK, "read", LETTERS(LETTER(0, 0, 1), LETTER(0, 0, 3)) },
+		{ "read 2-5\n", 0, COMMAND_OK, "read", LETTERS(RANGE(0, 2, 5)) },
+		{ "read 3-3\n", 0, COMMAND_OK, "read", LETTERS(RANGE(0, 3, 3)) },
+		{ "read 4-\n", 0, COMMAND_OK, "read", LETTERS(RANGE(0, 4, 0)) },
+		{ "read t2-4\n", 0, COMMAND_OK, "read", LETTERS(RANGE(1, 2, 4)) },
+		{ "read 5-2\n", 0, COMMAND_OK, "read", LETTERS(LETTER(COMMAND_INVALID, 0, 0)) },
+		{ "read -2\n", 0, COMMAND_OK, "read", LETTERS(LETTER(COMMAND_INVALID, 0, 0)) },
+		{ "read *\n", 0, COMMAND_OK, "read", LETTERS(ALL(0)) },
+		{ "read % t%\n", 0, COMMAND_OK, "read", LETTERS(RESULT(0), RESULT(1)) },
+		{ "read :S :!F\n", 0, COMMAND_OK, "read", LETTERS(FLAG(0, 'S', 0), FLAG(0, 'F', 1)) },
+		{ "read t :!S\n", 0, COMMAND_OK, "read", LETTERS(FLAG(1, 'S', 1)) },
+		{ "read :\n", 0, COMMAND_OK, "read", LETTERS(LETTER(COMMAND_INVALID, 0, 0)) },
+		{ "read :SF\n", 0, COMMAND_OK, "read", LETTERS(LETTER(COMMAND_INVALID, 0, 0)) },
+		{ "read /hello 2\n", 0, COMMAND_OK, "read", LETTERS(SUBJECT(0, "hello"), LETTER(0, 0, 2)) },
+		{ "read t/hello\n", 0, COMMAND_OK, "read", LETTERS(SUBJECT(1, "hello")) },
+		{ "read /\n", 0, COMMAND_OK, "read", LETTERS(LETTER(COMMAND_INVALID, 0, 0)) },
+		{ "read  1-2  *\n", 0, COMMAND_OK, "read", LETTERS(RANGE(0, 1, 2), ALL(0)) },
+		{ " \tread 1\n", 0, COMMAND_OK, "read", LETTERS(LETTER(0, 0, 1)) },
 	};
 	size_t i;
 
@@ -80,8 +114,18 @@ command_test(void)
 				goto done;
 			if (letter.thread != tests[i].letters[j].thread)
 				errx(1, "wrong thread boolean value");
+			if (letter.type != tests[i].letters[j].type)
+				errx(1, "wrong selector type");
 			if (letter.num != tests[i].letters[j].num)
 				errx(1, "wrong letter number");
+			if (letter.end != tests[i].letters[j].end)
+				errx(1, "wrong range end");
+			if (letter.flag != tests[i].letters[j].flag)
+				errx(1, "wrong flag");
+			if (letter.negate != tests[i].letters[j].negate)
+				errx(1, "wrong flag negation");
+			if (strcmp(letter.subject, tests[i].letters[j].subject) != 0)
+				errx(1, "wrong subject");
 		}
 
 		if (command_letter(&lex, &letter) != COMMAND_EOF)
@@ -91,3 +135,112 @@ command_test(void)
 		fclose(fp);
 	}
 }
+
+void
+command_text_test(void)
+{
+	const struct {
+		char *input;
+		size_t bufsz;
+		int error;
+		const char *text;
+	} tests[] = {
+		{ "search hello\n", 0, COMMAND_OK, "hello" },
+		{ "search  \t \"a phrase\"  word \t\n", 0, COMMAND_OK, "\"a phrase\"  word" },
+		{ "search\n", 0, COMMAND_EOF, NULL },
+		{ "search   \n", 0, COMMAND_EOF, NULL },
+		{ "search hello", 0, COMMAND_OK, "hello" },
+		{ "search hello\n", 5, COMMAND_LONG, NULL },
+		{ "search hell\n", 5, COMMAND_OK, "hell" },
+	};
+	size_t i;
+
+	for (i = 0; i < nitems(tests); i++) {
+		struct command_lexer lex;
+		FILE *fp;
+		size_t bufsz;
+		int error;
+		char buf[128], name[8];
+
+		if ((fp = fmemopen(tests[i].input, strlen(tests[i].input), "r")) == NULL)
+			err(1, "fmemopen");
+
+		command_init(&lex, fp);
+
+		if (command_name(&lex, name, sizeof(name)) != COMMAND_OK)
+			errx(1, "command_name failed");
+
+		if ((bufsz = tests[i].bufsz) == 0)
+			bufsz = sizeof(buf);
+
+		error = command_text(&lex, buf, bufsz);
+		if (error != tests[i].error)
+			errx(1, "wrong error");
+		if (error == COMMAND_OK && strcmp(buf, tests[i].text) != 0)
+			errx(1, "wrong text");
+
+		if (command_text(&lex, buf, bufsz) != COMMAND_EOF)
+			errx(1, "text after end of line");
+
+		fclose(fp);
+	}
+}
+
+void
+command_word_test(void)
+{
+	const struct {
+		char *input;
+		size_t bufsz;
+		int error;
+		const char *word;
+		size_t num;
+	} tests[] = {
+		{ "export box.mbox 3\n", 0, COMMAND_OK, "box.mbox", 3 },
+		{ "export \t -r  4\n", 0, COMMAND_OK, "-r", 4 },
+		{ "export box/\n", 0, COMMAND_OK, "box/", 0 },
+		{ "export\n", 0, COMMAND_EOF, NULL, 0 },
+		{ "export  \n", 0, COMMAND_EOF, NULL, 0 },
+		{ "export box", 0, COMMAND_OK, "box", 0 },
+		{ "export hello 1\n", 5, COMMAND_LONG, NULL, 0 },
+		{ "export hell 1\n", 5, COMMAND_OK, "hell", 1 },
+	};
+	size_t i;
+
+	for (i = 0; i < nitems(tests); i++) {
+		struct command_letter letter;
+		struct command_lexer lex;
+		FILE *fp;
+		size_t bufsz;
+		int error;
+		char buf[128], name[8];
+
+		if ((fp = fmemopen(tests[i].input, strlen(tests[i].input), "r")) == NULL)
+			err(1, "fmemopen");
+
+		command_init(&lex, fp);
+
+		if (command_name(&lex, name, sizeof(name)) != COMMAND_OK)
+			errx(1, "command_name failed");
+
+		if ((bufsz = tests[i].bufsz) == 0)
+			bufsz = sizeof(buf);
+
+		error = command_word(&lex, buf, bufsz);
+		if (error != tests[i].error)
+			errx(1, "wrong error");
+		if (error == COMMAND_OK) {
+			if (strcmp(buf, tests[i].word) != 0)
+				errx(1, "wrong word");
+
+			error = command_letter(&lex, &letter);
+			if (tests[i].num == 0 && error != COMMAND_EOF)
+				errx(1, "letter after word");
+			if (tests[i].num != 0 && (error != COMMAND_OK ||
+			    letter.num != tests[i].num))
+				errx(1, "wrong letter after word");
+		}
+
+		fclose(fp);
+	}
+}
@@ -18,5 +18,7 @@
 #define REGRESS_COMMAND_H
 
 void command_test(void);
+void command_text_test(void);
+void command_word_test(void);
 
 #endif /* REGRESS_COMMAND_H */
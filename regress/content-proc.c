@@ -29,6 +29,86 @@
 
 #define nitems(a) (sizeof((a)) / sizeof(*(a)))
 
+static int field_equal(int, const char *, const char *);
+
+/*
+ * Whether an optional summary field matches the expected value,
+ * NULL if the field should be missing.
+ */
+static int
+field_equal(int present, const char *got, const char *want)
+{
+	if (want == NULL)
+		return !present;
+	return present && strcmp(got, want) == 0;
+}
+
+void
+content_proc_ignore_test(void)
+{
+	size_t i;
+	const struct {
+		char *headers[2];
+		size_t nheader;
+		int type;
+		const char *out;
+	} tests[] = {
+		{ { "date", "SUBJECT" }, 2, IGNORE_IGNORE,
+		  "From: Dave <dave@bogus.invalid>\n\nSalutations.\n" },
+		{ { "subject", "Subject" }, 2, IGNORE_RETAIN,
+		  "Subject: Hello\n\nSalutations.\n" },
+		{ { NULL }, 0, IGNORE_RETAIN,
+		  "Date: Mon, 01 Jan 1970 00:00:00 -0000\n"
+		  "From: Dave <dave@bogus.invalid>\n"
+		  "Subject: Hello\n\nSalutations.\n" },
+	};
+
+	if (setlocale(LC_CTYPE, "C.UTF-8") == NULL)
+		err(1, "setlocale");
+
+	for (i = 0; i < nitems(tests); i++) {
+		struct content_letter lr;
+		struct content_proc pr;
+		struct ignore ignore;
+		const char *out;
+		char buf[4];
+		int in, n;
+
+		if (ignore_build(&ignore, tests[i].headers, tests[i].nheader,
+				 tests[i].type) == -1)
+			errx(1, "ignore_build");
+
+		if (content_proc_init(&pr, "./mailz-content") == -1)
+			errx(1, "content_proc_init");
+		if (content_proc_ignore(&pr, &ignore) == -1)
+			errx(1, "content_proc_ignore");
+
+		if ((in = open("regress/letters/letter_in_1",
+			       O_RDONLY | O_CLOEXEC)) == -1)
+			err(1, "letter_in_1");
+		if (content_letter_init(&pr, &lr, in) == -1)
+			errx(1, "content_letter_init");
+
+		out = tests[i].out;
+		while ((n = content_letter_getc(&lr, buf)) > 0) {
+			if (strncmp(out, buf, n) != 0)
+				errx(1, "wrong output");
+			out += n;
+		}
+		if (n == -1)
+			errx(1, "content_letter_getc");
+		if (*out != '\0')
+			errx(1, "output too short");
+
+		if (content_letter_finish(&lr) == -1)
+			errx(1, "content_letter_finish");
+
+		content_letter_close(&lr);
+		content_proc_kill(&pr);
+		ignore_free(&ignore);
+	}
+}
+
 void
 content_proc_letter_error_test(void)
 {
@@ -99,6 +179,8 @@ content_proc_letter_test(void)
 		{ "2" },
 		{ "3" },
 		{ "4" },
+		{ "5" },
+		{ "6" },
 	};
 
 	if (setlocale(LC_CTYPE, "C.UTF-8") == NULL)
@@ -173,6 +255,7 @@ content_proc_reply_test(void)
 		{ "1", "frank@bogus.invalid", 0, 0 },
 		{ "2", "frank@bogus.invalid", 0, 0 },
 		{ "3", "frank@bogus.invalid", 0, 0 },
+		{ "4", "frank@bogus.invalid", 1, 0 },
 	};
 
 	if (setlocale(LC_CTYPE, "C.UTF-8") == NULL)
@@ -245,6 +328,40 @@ content_proc_reply_test(void)
 	}
 }
 
+void
+content_proc_stats_test(void)
+{
+	struct content_proc pr;
+	struct content_stats cs;
+	struct content_summary sm;
+	size_t i;
+	int fd;
+
+	if (content_proc_init(&pr, "./mailz-content") == -1)
+		errx(1, "content_proc_init");
+
+	for (i = 0; i < 2; i++) {
+		fd = open("regress/letters/summary_1", O_RDONLY | O_CLOEXEC);
+		if (fd == -1)
+			err(1, "regress/letters/summary_1");
+		if (content_proc_summary(&pr, &sm, fd, 0) == -1)
+			errx(1, "content_proc_summary");
+	}
+
+	if (content_proc_stats(&pr, &cs) == -1)
+		errx(1, "content_proc_stats");
+	if (cs.letters != 2)
+		errx(1, "content_proc_stats: %llu letters",
+		     (unsigned long long)cs.letters);
+	/* Only the headers are read, the letter is 86 bytes long. */
+	if (cs.bytes == 0 || cs.bytes > 2 * 86 || cs.bytes % 2 != 0)
+		errx(1, "content_proc_stats: %llu bytes",
+		     (unsigned long long)cs.bytes);
+
+	if (content_proc_kill(&pr) == -1)
+		errx(1, "content_proc_kill");
+}
+
 void
 content_proc_summary_test(void)
 {
@@ -255,9 +372,36 @@ content_proc_summary_test(void)
 		const char *subject;
 		time_t date;
 		int error;
+		int fields;
+		const char *cc;
+		const char *in_reply_to;
+		const char *list_id;
+		const char *message_id;
+		const char *to;
+		off_t size;
 	} tests[] = {
-		{ "1", "dave@bogus.invalid", "Hello", 0, 0 },
-		{ "2", "dave@bogus.invalid", NULL, 0, 0 },
+		{ "1", "dave@bogus.invalid", "Hello", 0, 0, 0,
+		  NULL, NULL, NULL, NULL, NULL, -1 },
+		{ "1", "dave@bogus.invalid", "Hello", 0, 0, CNT_SUMMARY_ALL,
+		  NULL, NULL, NULL, NULL, NULL, 86 },
+		{ "2", "dave@bogus.invalid", NULL, 0, 0, 0,
+		  NULL, NULL, NULL, NULL, NULL, -1 },
+		{ "3", "dave@bogus.invalid", "Hello", 0, 0, 0,
+		  NULL, NULL, NULL, NULL, NULL, -1 },
+		{ "3", "dave@bogus.invalid", "Hello", 0, 0, CNT_SUMMARY_TO,
+		  NULL, NULL, NULL, NULL, "Alice <alice@bogus.invalid>", -1 },
+		{ "3", "dave@bogus.invalid", "Hello", 0, 0, CNT_SUMMARY_ALL,
+		  "bob@bogus.invalid", "1@bogus.invalid",
+		  "<misc.bogus.invalid>", "2@bogus.invalid",
+		  "Alice <alice@bogus.invalid>", 289 },
+		/* subjects are no longer cut short at 120 bytes */
+		{ "4", "dave@bogus.invalid", "word00 word01 word02 word03 "
+		  "word04 word05 word06 word07 word08 word09 word10 word11 "
+		  "word12 word13 word14 word15 word16 word17 word18 word19 "
+		  "word20 word21 word22 word23 word24 word25 word26 word27 "
+		  "word28 word29 word30 word31 word32 word33 word34 word35 "
+		  "word36 word37 word38 word39", 0, 0, 0,
+		  NULL, NULL, NULL, NULL, NULL, -1 },
 	};
 
 	for (i = 0; i < nitems(tests); i++) {
@@ -278,22 +422,79 @@ content_proc_summary_test(void)
 		if (fd == -1)
 			err(1, "%s", path);
 
-		error = content_proc_summary(&pr, &sm, fd);
+		error = content_proc_summary(&pr, &sm, fd, tests[i].fields);
 		if (error != tests[i].error)
 			errx(1, "wrong error");
 
 		if (error == 0) {
 			if (sm.date != tests[i].date)
 				errx(1, "wrong date");
-			if (strcmp(sm.from, tests[i].from) != 0)
+			if (strcmp(sm.text[CNT_TEXT_FROM], tests[i].from) != 0)
 				errx(1, "wrong from address");
 			if (sm.have_subject != (tests[i].subject != NULL))
 				errx(1, "wrong subject");
 			if (tests[i].subject != NULL
-			    && strcmp(sm.subject, tests[i].subject) != 0)
+			    && strcmp(sm.text[CNT_TEXT_SUBJECT],
+				      tests[i].subject) != 0)
 				errx(1, "wrong subject");
+			if (!field_equal(sm.fields & CNT_SUMMARY_CC,
+					 sm.text[CNT_TEXT_CC], tests[i].cc))
+				errx(1, "wrong cc");
+			if (!field_equal(sm.fields & CNT_SUMMARY_IN_REPLY_TO,
+					 sm.text[CNT_TEXT_IN_REPLY_TO],
+					 tests[i].in_reply_to))
+				errx(1, "wrong in-reply-to");
+			if (!field_equal(sm.fields & CNT_SUMMARY_LIST_ID,
+					 sm.text[CNT_TEXT_LIST_ID],
+					 tests[i].list_id))
+				errx(1, "wrong list-id");
+			if (!field_equal(sm.fields & CNT_SUMMARY_MESSAGE_ID,
+					 sm.text[CNT_TEXT_MESSAGE_ID],
+					 tests[i].message_id))
+				errx(1, "wrong message-id");
+			if (!field_equal(sm.fields & CNT_SUMMARY_TO,
+					 sm.text[CNT_TEXT_TO], tests[i].to))
+				errx(1, "wrong to");
+			if (sm.size != tests[i].size)
+				errx(1, "wrong size");
 		}
 
 		content_proc_kill(&pr);
 	}
 }
+
+void
+content_proc_summary_queue_test(void)
+{
+	struct content_proc pr;
+	struct content_summary sm;
+	size_t i;
+	const char *paths[] = {
+		"regress/letters/summary_1",
+		"regress/letters/summary_2",
+		"regress/letters/summary_1",
+	};
+
+	if (content_proc_init(&pr, "./mailz-content") == -1)
+		errx(1, "content_proc_init");
+
+	for (i = 0; i < nitems(paths); i++) {
+		int fd;
+
+		if ((fd = open(paths[i], O_RDONLY | O_CLOEXEC)) == -1)
+			err(1, "%s", paths[i]);
+		if (content_proc_summary_send(&pr, fd, 0) == -1)
+			errx(1, "content_proc_summary_send");
+	}
+
+	/* Replies must come back in the order the requests were sent */
+	for (i = 0; i < nitems(paths); i++) {
+		if (content_proc_summary_recv(&pr, &sm) == -1)
+			errx(1, "content_proc_summary_recv");
+		if (sm.have_subject != (i != 1))
+			errx(1, "summary out of order");
+	}
+
+	if (content_proc_kill(&pr) == -1)
+		errx(1, "content_proc_kill");
+}
@@ -17,9 +17,12 @@
 #ifndef REGRESS_CONTENT_PROC_H
 #define REGRESS_CONTENT_PROC_H
 
+void content_proc_ignore_test(void);
 void content_proc_letter_test(void);
 void content_proc_letter_error_test(void);
 void content_proc_reply_test(void);
+void content_proc_stats_test(void);
 void content_proc_summary_test(void);
+void content_proc_summary_queue_test(void);
 
 #endif /* REGRESS_CONTENT_PROC_H */
@@ -75,6 +75,7 @@ encoding_getc_test(void)
 
 		test("aGk=", "hi", ENCODING_BASE64, ENCODING_EOF),
 		test("aG\nk=", "hi", ENCODING_BASE64, ENCODING_EOF),
+		test("aGn/", "hi\xFF", ENCODING_BASE64, ENCODING_EOF),
 		test("===", "", ENCODING_BASE64, ENCODING_ERR),
 		test("\xFF", "", ENCODING_BASE64, ENCODING_ERR),
 		test("\0", "", ENCODING_BASE64, ENCODING_ERR),
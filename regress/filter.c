@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "filter.h"
+#include "../filter.h"
+#include "../mailbox.h"
+
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+void
+filter_parse_test(void)
+{
+	size_t i;
+	const struct {
+		const char *in;
+		int error;
+		size_t nterm;
+		int fields;
+	} tests[] = {
+		{ "from:dave", 0, 1, 0 },
+		{ "  from:dave  subject:hello ", 0, 2, 0 },
+		{ "!to:dave cc:bob", 0, 2, LETTER_CC | LETTER_TO },
+		{ "list-id:misc", 0, 1, LETTER_LIST_ID },
+		{ "message-id:1@ in-reply-to:0@", 0, 2,
+		  LETTER_IN_REPLY_TO | LETTER_MESSAGE_ID },
+		{ "subject:\"weekly report\"", 0, 1, 0 },
+		{ "since:2025-01-01 before:2026-01-01", 0, 2, 0 },
+		{ "", -1, 0, 0 },
+		{ "from", -1, 0, 0 },
+		{ "from:", -1, 0, 0 },
+		{ "bogus:dave", -1, 0, 0 },
+		{ "subject:\"weekly report", -1, 0, 0 },
+		{ "subject:\"weekly\"report", -1, 0, 0 },
+		{ "since:2025-1-01", -1, 0, 0 },
+		{ "since:2025-13-01", -1, 0, 0 },
+	};
+
+	for (i = 0; i < nitems(tests); i++) {
+		struct filter filter;
+		int error;
+
+		error = filter_parse(&filter, tests[i].in);
+		if (error != tests[i].error)
+			errx(1, "filter_parse: %s: wrong error", tests[i].in);
+		if (error == -1)
+			continue;
+		if (filter.nterm != tests[i].nterm)
+			errx(1, "filter_parse: %s: wrong terms", tests[i].in);
+		if (filter_fields(&filter) != tests[i].fields)
+			errx(1, "filter_parse: %s: wrong fields", tests[i].in);
+	}
+}
+
+void
+filter_run_test(void)
+{
+	struct mailbox mailbox;
+	size_t i, j;
+	const struct {
+		const char *from;
+		const char *subject;
+		const char *to;
+	} letters[] = {
+		{ "dave@bogus.invalid", "Weekly report", "alice@bogus.invalid" },
+		{ "bob@bogus.invalid", "Hello", NULL },
+		{ "dave@bogus.invalid", NULL, "bob@bogus.invalid" },
+	};
+	const struct {
+		const char *in;
+		unsigned char match[3];
+	} tests[] = {
+		{ "from:dave", { 1, 0, 1 } },
+		{ "from:DAVE subject:report", { 1, 0, 0 } },
+		{ "!from:dave", { 0, 1, 0 } },
+		{ "to:bob", { 0, 0, 1 } },
+		{ "!to:bob", { 1, 1, 0 } },
+		{ "subject:\"weekly report\"", { 1, 0, 0 } },
+		{ "since:1970-01-03", { 0, 0, 0 } },
+	};
+
+	mailbox_init(&mailbox);
+	for (i = 0; i < nitems(letters); i++) {
+		struct letter letter;
+
+		memset(&letter, 0, sizeof(letter));
+		letter.date = 0;
+		letter.from = (char *)letters[i].from;
+		letter.path = "bogus";
+		letter.subject = (char *)letters[i].subject;
+		letter.to = (char *)letters[i].to;
+
+		if (mailbox_add_letter(&mailbox, &letter) == -1)
+			err(1, "mailbox_add_letter");
+	}
+
+	for (i = 0; i < nitems(tests); i++) {
+		struct filter filter;
+		unsigned char match[nitems(letters)];
+		size_t n, want;
+
+		if (filter_parse(&filter, tests[i].in) == -1)
+			errx(1, "filter_parse: %s", tests[i].in);
+
+		n = filter_run(&filter, &mailbox, match);
+
+		for (j = 0, want = 0; j < nitems(letters); j++) {
+			if (match[j] != tests[i].match[j])
+				errx(1, "filter_run: %s: wrong match",
+				     tests[i].in);
+			want += match[j];
+		}
+		if (n != want)
+			errx(1, "filter_run: %s: wrong count", tests[i].in);
+	}
+
+	mailbox_free(&mailbox);
+}
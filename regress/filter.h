@@ -0,0 +1,7 @@
+#ifndef REGRESS_FILTER_H
+#define REGRESS_FILTER_H
+
+void filter_parse_test(void);
+void filter_run_test(void);
+
+#endif /* REGRESS_FILTER_H */
@@ -293,6 +293,10 @@ header_date_test(void)
 		{ "Mon, 01 Jan 1970 00:00 -0000", 0, HEADER_OK },
 		{ "Mon, 01 Jan 1970 00:00:00 GMT", 0, HEADER_OK },
 		{ "Mon, 01 Jan 70 00:00:00 -0000", 0, HEADER_OK },
+		{ "Thu, 29 Feb 2024 12:00:00 +0000", 1709208000, HEADER_OK },
+		{ "31 Feb 2023 00:00:60 +0000", 1677801660, HEADER_OK },
+		{ "Fri, 4 Jul 1997 18:00:00 EDT", 868060800, HEADER_OK },
+		{ "31 Dec 1969 23:59:58 +0000", -2, HEADER_OK },
 
 		{ "Monday, 01 Jan 1970 00:00:00 -0000", 0, HEADER_INVALID },
 		{ "Mon, 01 January 1970 00:00:00 -0000", 0, HEADER_INVALID },
@@ -356,6 +360,42 @@ header_encoding_test(void)
 	}
 }
 
+void
+header_field_test(void)
+{
+	size_t i;
+	const struct {
+		const char *name;
+		int field;
+	} tests[] = {
+		{ "Cc", HEADER_FIELD_CC },
+		{ "Content-Disposition", HEADER_FIELD_CONTENT_DISPOSITION },
+		{ "Content-Transfer-Encoding",
+		  HEADER_FIELD_CONTENT_TRANSFER_ENCODING },
+		{ "content-type", HEADER_FIELD_CONTENT_TYPE },
+		{ "DATE", HEADER_FIELD_DATE },
+		{ "From", HEADER_FIELD_FROM },
+		{ "In-Reply-To", HEADER_FIELD_IN_REPLY_TO },
+		{ "List-Id", HEADER_FIELD_LIST_ID },
+		{ "Message-ID", HEADER_FIELD_MESSAGE_ID },
+		{ "References", HEADER_FIELD_REFERENCES },
+		{ "Reply-To", HEADER_FIELD_REPLY_TO },
+		{ "Subject", HEADER_FIELD_SUBJECT },
+		{ "To", HEADER_FIELD_TO },
+		{ "", HEADER_FIELD_OTHER },
+		{ "x", HEADER_FIELD_OTHER },
+		{ "dat", HEADER_FIELD_OTHER },
+		{ "tox", HEADER_FIELD_OTHER },
+		{ "Received", HEADER_FIELD_OTHER },
+		{ "X-Mailer", HEADER_FIELD_OTHER },
+		{ "Content-Typf", HEADER_FIELD_OTHER },
+	};
+
+	for (i = 0; i < nitems(tests); i++)
+		if (header_field(tests[i].name) != tests[i].field)
+			errx(1, "header_field: %s", tests[i].name);
+}
+
 void
 header_lex_test(void)
 {
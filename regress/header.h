@@ -23,6 +23,7 @@ void header_content_type_var_test(void);
 void header_copy_addresses_test(void);
 void header_date_test(void);
 void header_encoding_test(void);
+void header_field_test(void);
 void header_lex_test(void);
 void header_lex_echo_test(void);
 void header_message_id_test(void);
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../ignore.h"
+#include "ignore.h"
+
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+static void ignore_copy(const struct ignore *, void **);
+
+static char *headers[] = {
+	"Received", "X-Mailer", "received", "DKIM-Signature", "List-Unsubscribe",
+};
+
+/*
+ * A malloc'd copy of the compiled buffer of ignore, as mailz-content
+ * would receive it.
+ */
+static void
+ignore_copy(const struct ignore *ignore, void **buf)
+{
+	if ((*buf = malloc(ignore->bufsz)) == NULL)
+		err(1, NULL);
+	memcpy(*buf, ignore->buf, ignore->bufsz);
+}
+
+void
+ignore_load_test(void)
+{
+	struct ignore_head head;
+	struct ignore ignore, loaded;
+	uint32_t *tab;
+	size_t i, j;
+	void *buf;
+
+	if (ignore_build(&ignore, headers, nitems(headers),
+			 IGNORE_IGNORE) == -1)
+		errx(1, "ignore_build");
+
+	ignore_init(&loaded);
+	ignore_copy(&ignore, &buf);
+	if (ignore_load(&loaded, buf, ignore.bufsz) == -1)
+		errx(1, "ignore_load");
+	for (i = 0; i < nitems(headers); i++)
+		if (!ignore_match(&loaded, headers[i]))
+			errx(1, "loaded set lost %s", headers[i]);
+	if (ignore_match(&loaded, "Subject"))
+		errx(1, "loaded set ignores Subject");
+	ignore_free(&loaded);
+
+	/* Each of these corrupts one part of the buffer. */
+	for (i = 0; i < 6; i++) {
+		ignore_copy(&ignore, &buf);
+		memcpy(&head, buf, sizeof(head));
+		tab = (uint32_t *)((char *)buf + sizeof(head));
+
+		switch (i) {
+		case 0:
+			head.type = 2;
+			break;
+		case 1:
+			head.tabsz--;
+			break;
+		case 2:
+			head.strsz++;
+			break;
+		case 3:
+			tab[0] = head.strsz + 1;
+			break;
+		case 4:
+			((char *)buf)[ignore.bufsz - 1] = 'x';
+			break;
+		case 5:
+			/* No empty slot to end a probe. */
+			for (j = 0; j < head.tabsz; j++)
+				tab[j] = 1;
+			break;
+		}
+		memcpy(buf, &head, sizeof(head));
+
+		if (ignore_load(&loaded, buf, ignore.bufsz) != -1)
+			errx(1, "corrupt set %zu loaded", i);
+		free(buf);
+	}
+
+	ignore_copy(&ignore, &buf);
+	if (ignore_load(&loaded, buf, sizeof(head) - 1) != -1)
+		errx(1, "truncated set loaded");
+	free(buf);
+
+	ignore_free(&ignore);
+}
+
+void
+ignore_match_test(void)
+{
+	struct ignore ignore;
+	char *many[200], names[200][16];
+	size_t i;
+
+	ignore_init(&ignore);
+	if (ignore_match(&ignore, "Received"))
+		errx(1, "empty set ignores a header");
+
+	if (ignore_build(&ignore, headers, nitems(headers),
+			 IGNORE_IGNORE) == -1)
+		errx(1, "ignore_build");
+	if (!ignore_match(&ignore, "RECEIVED"))
+		errx(1, "RECEIVED not ignored");
+	if (!ignore_match(&ignore, "x-mailer"))
+		errx(1, "x-mailer not ignored");
+	if (ignore_match(&ignore, "Receive"))
+		errx(1, "Receive ignored");
+	if (ignore_match(&ignore, "From"))
+		errx(1, "From ignored");
+	/* Received is only stored once. */
+	if (ignore.strsz != sizeof("Received") + sizeof("X-Mailer")
+	    + sizeof("DKIM-Signature") + sizeof("List-Unsubscribe"))
+		errx(1, "repeated header stored twice");
+	ignore_free(&ignore);
+
+	if (ignore_build(&ignore, headers, 1, IGNORE_RETAIN) == -1)
+		errx(1, "ignore_build");
+	if (ignore_match(&ignore, "received"))
+		errx(1, "retained header hidden");
+	if (!ignore_match(&ignore, "X-Mailer"))
+		errx(1, "other header retained");
+	ignore_free(&ignore);
+
+	for (i = 0; i < nitems(many); i++) {
+		snprintf(names[i], sizeof(names[i]), "X-Header-%zu", i);
+		many[i] = names[i];
+	}
+	if (ignore_build(&ignore, many, nitems(many), IGNORE_IGNORE) == -1)
+		errx(1, "ignore_build");
+	for (i = 0; i < nitems(many); i++)
+		if (!ignore_match(&ignore, many[i]))
+			errx(1, "%s not ignored", many[i]);
+	if (ignore_match(&ignore, "X-Header-200"))
+		errx(1, "X-Header-200 ignored");
+	ignore_free(&ignore);
+}
@@ -9,6 +9,190 @@
 
 #define nitems(a) (sizeof((a)) / sizeof(*(a)))
 
+void
+mailbox_merge_test(void)
+{
+	struct mailbox boxes[3], mailbox;
+	size_t i, j;
+	const time_t dates[][4] = {
+		{ 1, 4, 4, 9 },
+		{ 0 },
+		{ 2, 4, 5, 0 },
+	};
+	const size_t ndate[] = { 4, 0, 3 };
+	const struct {
+		int box;
+		time_t date;
+	} want[] = {
+		{ 0, 1 }, { 2, 2 }, { 0, 4 }, { 0, 4 }, { 2, 4 }, { 2, 5 },
+		{ 0, 9 },
+	};
+
+	for (i = 0; i < nitems(boxes); i++) {
+		mailbox_init(&boxes[i]);
+		for (j = 0; j < ndate[i]; j++) {
+			struct letter letter;
+
+			memset(&letter, 0, sizeof(letter));
+			letter.box = i;
+			letter.date = dates[i][j];
+			letter.from = "bogus";
+			letter.path = "bogus";
+
+			if (mailbox_add_letter(&boxes[i], &letter) == -1)
+				err(1, "mailbox_add_letter");
+		}
+	}
+
+	mailbox_init(&mailbox);
+	if (mailbox_merge(&mailbox, boxes, nitems(boxes)) == -1)
+		err(1, "mailbox_merge");
+
+	if (mailbox.nletter != nitems(want) || mailbox.nshown != nitems(want))
+		errx(1, "mailbox_merge: wrong number of letters");
+	for (i = 0; i < nitems(want); i++) {
+		if (mailbox.letters[i].box != want[i].box
+		    || mailbox.letters[i].date != want[i].date)
+			errx(1, "mailbox_merge: wrong letter %zu", i);
+	}
+	for (i = 0; i < nitems(boxes); i++) {
+		if (boxes[i].nletter != 0)
+			errx(1, "mailbox_merge: box %zu not emptied", i);
+		mailbox_free(&boxes[i]);
+	}
+
+	mailbox_free(&mailbox);
+}
+
+void
+mailbox_order_test(void)
+{
+	struct mailbox mailbox;
+	size_t i, j;
+	const struct {
+		const char *from;
+		const char *subject;
+		time_t date;
+		off_t size;
+	} letters[] = {
+		{ "carol", "Weekly report", 1, 300 },
+		{ "Bob", "lunch", 2, 100 },
+		{ "alice@averyveryverylongdomain.invalid", "Re: weekly report",
+		  3, 200 },
+		{ "alice@averyveryverylongdomain.example", NULL, 4, 100 },
+		{ "dave", "RE: Lunch", 5, 400 },
+	};
+	const struct {
+		enum mailbox_order order;
+		int reverse;
+		size_t want[nitems(letters)];
+	} tests[] = {
+		{ MAILBOX_ORDER_DATE, 0, { 0, 1, 2, 3, 4 } },
+		{ MAILBOX_ORDER_DATE, 1, { 4, 3, 2, 1, 0 } },
+		{ MAILBOX_ORDER_FROM, 0, { 3, 2, 1, 0, 4 } },
+		{ MAILBOX_ORDER_SIZE, 0, { 1, 3, 2, 0, 4 } },
+		{ MAILBOX_ORDER_SUBJECT, 0, { 3, 1, 4, 0, 2 } },
+		{ MAILBOX_ORDER_THREAD, 0, { 0, 2, 1, 4, 3 } },
+		{ MAILBOX_ORDER_THREAD, 1, { 3, 4, 1, 2, 0 } },
+	};
+
+	mailbox_init(&mailbox);
+	for (i = 0; i < nitems(letters); i++) {
+		struct letter letter;
+
+		memset(&letter, 0, sizeof(letter));
+		letter.date = letters[i].date;
+		letter.from = (char *)letters[i].from;
+		letter.path = "bogus";
+		letter.size = letters[i].size;
+		letter.subject = (char *)letters[i].subject;
+
+		if (mailbox_add_letter(&mailbox, &letter) == -1)
+			err(1, "mailbox_add_letter");
+	}
+
+	for (i = 0; i < nitems(tests); i++) {
+		if (mailbox_order(&mailbox, tests[i].order,
+				  tests[i].reverse) == -1)
+			err(1, "mailbox_order");
+
+		for (j = 0; j < nitems(letters); j++) {
+			if (mailbox_index(&mailbox, j) != tests[i].want[j])
+				errx(1, "mailbox_order %zu: wrong order", i);
+			if (mailbox_rank(&mailbox, tests[i].want[j]) != j)
+				errx(1, "mailbox_order %zu: wrong rank", i);
+		}
+	}
+
+	/* Put letters 1 and 3 in a second box and only show it. */
+	mailbox.letters[1].box = 1;
+	mailbox.letters[3].box = 1;
+	if (mailbox_order(&mailbox, MAILBOX_ORDER_DATE, 1) == -1)
+		err(1, "mailbox_order");
+	if (mailbox_view(&mailbox, 1) == -1)
+		err(1, "mailbox_view");
+	if (mailbox.nshown != 2 || mailbox_index(&mailbox, 0) != 3
+	    || mailbox_index(&mailbox, 1) != 1)
+		errx(1, "mailbox_view: wrong letters shown");
+	if (mailbox_rank(&mailbox, 0) != SIZE_MAX)
+		errx(1, "mailbox_view: hidden letter has a rank");
+
+	if (mailbox_view(&mailbox, -1) == -1)
+		err(1, "mailbox_view");
+	if (mailbox.nshown != nitems(letters)
+	    || mailbox_index(&mailbox, 0) != 4)
+		errx(1, "mailbox_view: wrong letters shown");
+
+	mailbox_free(&mailbox);
+}
+
+void
+mailbox_set_test(void)
+{
+	struct mailbox mailbox;
+	struct mailbox_set set;
+	size_t i;
+	const size_t add[] = { 3, 1, 3, 0, 1, 2 };
+	const size_t want[] = { 3, 1, 0, 2 };
+
+	mailbox_init(&mailbox);
+
+	if (mailbox_set_init(&mailbox, &set) == -1)
+		err(1, "mailbox_set_init");
+	if (set.nidx != 0)
+		errx(1, "empty set is not empty");
+	mailbox_set_free(&set);
+
+	for (i = 0; i < 4; i++) {
+		struct letter letter;
+
+		memset(&letter, 0, sizeof(letter));
+		letter.date = 0;
+		letter.from = "bogus";
+		letter.path = "bogus";
+		letter.subject = NULL;
+
+		if (mailbox_add_letter(&mailbox, &letter) == -1)
+			err(1, "mailbox_add_letter");
+	}
+
+	if (mailbox_set_init(&mailbox, &set) == -1)
+		err(1, "mailbox_set_init");
+
+	for (i = 0; i < nitems(add); i++)
+		mailbox_set_add(&set, add[i]);
+
+	if (set.nidx != nitems(want))
+		errx(1, "wrong set size");
+	for (i = 0; i < nitems(want); i++) {
+		if (set.idx[i] != want[i])
+			errx(1, "wrong set order");
+	}
+
+	mailbox_set_free(&set);
+	mailbox_free(&mailbox);
+}
+
 void
 mailbox_thread_test(void)
 {
@@ -42,6 +226,7 @@ mailbox_thread_test(void)
 		for (j = 0; j < tests[i].nsubject; j++) {
 			struct letter letter;
 
+			memset(&letter, 0, sizeof(letter));
 			letter.date = 0;
 			letter.from = "bogus";
 			letter.path = "bogus";
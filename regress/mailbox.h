@@ -1,6 +1,9 @@
 #ifndef REGRESS_MAILBOX_H
 #define REGRESS_MAILBOX_H
 
+void mailbox_merge_test(void);
+void mailbox_order_test(void);
+void mailbox_set_test(void);
 void mailbox_thread_test(void);
 
 #endif /* REGRESS_MAILBOX_H */
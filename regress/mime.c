@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../mime.h"
+#include "mime.h"
+
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+static void mime_expect(const char *, size_t, const char *const *, size_t);
+static char *mime_read_part(FILE *, size_t *);
+
+/*
+ * Split body at the boundary "b" and check the parts against want.
+ * A NULL in want is a part that is skipped without being read.
+ */
+static void
+mime_expect(const char *body, size_t len, const char *const *want,
+	size_t nwant)
+{
+	struct mime m;
+	FILE *in, *fp;
+	size_t i, n;
+	char *got;
+	int mv;
+
+	if ((in = fmemopen((void *)body, len, "r")) == NULL)
+		err(1, "fmemopen");
+	if (mime_init(&m, in, "b") == -1)
+		err(1, "mime_init");
+
+	for (i = 0; (mv = mime_next(&m)) == 1; i++) {
+		if (i == nwant)
+			errx(1, "too many parts");
+		if (want[i] == NULL)
+			continue;
+
+		if ((fp = mime_part(&m)) == NULL)
+			err(1, "mime_part");
+		got = mime_read_part(fp, &n);
+		if (n != strlen(want[i]) || memcmp(got, want[i], n) != 0)
+			errx(1, "part %zu: wrong contents", i);
+		free(got);
+		fclose(fp);
+	}
+	if (mv == -1)
+		errx(1, "mime_next");
+	if (i != nwant)
+		errx(1, "wrong number of parts");
+
+	mime_free(&m);
+	fclose(in);
+}
+
+static char *
+mime_read_part(FILE *fp, size_t *len)
+{
+	FILE *out;
+	char *buf, chunk[1000];
+	size_t bufsz, n;
+
+	buf = NULL;
+	bufsz = 0;
+	if ((out = open_memstream(&buf, &bufsz)) == NULL)
+		err(1, "open_memstream");
+	while ((n = fread(chunk, 1, sizeof(chunk), fp)) != 0)
+		if (fwrite(chunk, 1, n, out) != n)
+			err(1, "fwrite");
+	if (ferror(fp))
+		errx(1, "part could not be read");
+	if (fclose(out) == EOF)
+		err(1, "fclose");
+	*len = bufsz;
+	return buf;
+}
+
+/*
+ * Parts that span many reads of the input, with the delimiter
+ * straddling where one read ends and the next begins.
+ */
+void
+mime_large_test(void)
+{
+	const char *want[3];
+	char *body, *part;
+	size_t i, len, partsz;
+
+	for (partsz = 16370; partsz < 16400; partsz++) {
+		if ((part = malloc(partsz + 1)) == NULL)
+			err(1, NULL);
+		for (i = 0; i < partsz; i++)
+			part[i] = 'a' + i % 26;
+		part[partsz] = '\0';
+
+		len = partsz * 2 + 64;
+		if ((body = malloc(len)) == NULL)
+			err(1, NULL);
+		len = snprintf(body, len, "--b\n%s\r\n--b\n%s\n--b\nc\n--b--\n",
+			       part, part);
+
+		want[0] = part;
+		want[1] = part;
+		want[2] = "c";
+		mime_expect(body, len, want, nitems(want));
+
+		want[0] = NULL;
+		want[1] = NULL;
+		mime_expect(body, len, want, nitems(want));
+
+		free(body);
+		free(part);
+	}
+}
+
+void
+mime_test(void)
+{
+	size_t i;
+	const struct {
+		const char *body;
+		const char *want[3];
+		size_t nwant;
+	} tests[] = {
+		{ "preamble\n--b\nA\n--b\nB\n--b--\nepilogue\n",
+		  { "A", "B" }, 2 },
+		{ "--b\r\nA\r\n--b\r\nB\r\n--b--\r\n",
+		  { "A", "B" }, 2 },
+		{ "--b\n--b\nB\n--b--\n",
+		  { "", "B" }, 2 },
+		{ "--b\nA\n\n--b \t\nB\n--b--",
+		  { "A\n", "B" }, 2 },
+		{ "--b\nA\n--b\nB\n",
+		  { "A", "B\n" }, 2 },
+		{ "--b\nA --b\nB\n--b--\n",
+		  { "A --b\nB" }, 1 },
+		{ "--b--\n--b\nA\n", { NULL }, 0 },
+		{ "no parts\n", { NULL }, 0 },
+	};
+
+	for (i = 0; i < nitems(tests); i++)
+		mime_expect(tests[i].body, strlen(tests[i].body),
+			    tests[i].want, tests[i].nwant);
+}
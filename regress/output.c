@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/types.h>
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../mailbox.h"
+#include "../output.h"
+#include "output.h"
+
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+void
+output_letter_test(void)
+{
+	struct letter letter;
+	const struct {
+		enum output_format format;
+		int mask;
+		const char *want;
+	} tests[] = {
+		{ OUTPUT_JSON, 0,
+		  "{\"mailbox\":\"box\",\"path\":\"1.host:2,S\",\"date\":86400,"
+		  "\"from\":\"dave@bogus.invalid\","
+		  "\"subject\":\"say \\\"hi\\\"\\u0009\\\\ now\"}\n" },
+		{ OUTPUT_JSON, LETTER_CC | LETTER_SIZE,
+		  "{\"mailbox\":\"box\",\"path\":\"1.host:2,S\",\"date\":86400,"
+		  "\"from\":\"dave@bogus.invalid\","
+		  "\"subject\":\"say \\\"hi\\\"\\u0009\\\\ now\","
+		  "\"cc\":null,\"size\":1234}\n" },
+		{ OUTPUT_TSV, 0,
+		  "box\t1.host:2,S\t86400\tdave@bogus.invalid\t"
+		  "say \"hi\"\\t\\\\ now\n" },
+		{ OUTPUT_TSV, LETTER_CC | LETTER_SIZE,
+		  "box\t1.host:2,S\t86400\tdave@bogus.invalid\t"
+		  "say \"hi\"\\t\\\\ now\t\t1234\n" },
+	};
+	size_t i;
+
+	memset(&letter, 0, sizeof(letter));
+	letter.date = 86400;
+	letter.from = "dave@bogus.invalid";
+	letter.path = "1.host:2,S";
+	letter.size = 1234;
+	letter.subject = "say \"hi\"\t\\ now";
+
+	for (i = 0; i < nitems(tests); i++) {
+		FILE *fp;
+		char *buf;
+		size_t bufsz;
+
+		if ((fp = open_memstream(&buf, &bufsz)) == NULL)
+			err(1, "open_memstream");
+		if (output_letter(fp, tests[i].format, "box", &letter,
+				  tests[i].mask) == -1)
+			errx(1, "output_letter failed");
+		if (fclose(fp) == EOF)
+			err(1, "fclose");
+
+		if (strcmp(buf, tests[i].want) != 0)
+			errx(1, "output_letter %zu: got %s", i, buf);
+		free(buf);
+	}
+}
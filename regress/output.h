@@ -0,0 +1,6 @@
+#ifndef REGRESS_OUTPUT_H
+#define REGRESS_OUTPUT_H
+
+void output_letter_test(void);
+
+#endif /* REGRESS_OUTPUT_H */
@@ -20,38 +20,61 @@
 #include "command.h"
 #include "content-proc.h"
 #include "encoding.h"
+#include "filter.h"
 #include "header.h"
+#include "ignore.h"
 #include "mailbox.h"
 #include "maildir.h"
+#include "mime.h"
+#include "output.h"
 #include "printable.h"
+#include "search.h"
 
 int
 main(void)
 {
 	charset_getc_test();
 	command_test();
+	command_text_test();
+	command_word_test();
+	content_proc_ignore_test();
 	content_proc_letter_error_test();
 	content_proc_letter_test();
 	content_proc_reply_test();
+	content_proc_stats_test();
 	content_proc_summary_test();
+	content_proc_summary_queue_test();
 	encoding_from_name_test();
 	encoding_getc_test();
+	filter_parse_test();
+	filter_run_test();
 	header_address_test();
 	header_content_type_test();
 	header_content_type_var_test();
 	header_copy_addresses_test();
 	header_date_test();
 	header_encoding_test();
+	header_field_test();
 	header_lex_test();
 	header_lex_echo_test();
 	header_message_id_test();
 	header_name_test();
 	header_subject_test();
 	header_subject_reply_test();
+	ignore_load_test();
+	ignore_match_test();
+	mailbox_merge_test();
+	mailbox_order_test();
+	mailbox_set_test();
 	mailbox_thread_test();
 	maildir_get_flag_test();
 	maildir_set_flag_test();
 	maildir_unset_flag_test();
+	mime_large_test();
+	mime_test();
+	output_letter_test();
+	search_index_test();
+	search_query_test();
 	string_printable_test();
 
 	puts("Ok.");
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <err.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../search.h"
+#include "search.h"
+
+#define nitems(a) (sizeof((a)) / sizeof(*(a)))
+
+static void search_expect(struct search *, const char *, const uint32_t *,
+	size_t);
+
+static const struct {
+	const char *name;
+	const char *text;
+} letters[] = {
+	{ "a:2,S", "Subject: Hello World\n\nthe quick brown fox" },
+	{ "b:2,", "Subject: hello there\n\nquick\nfox, brown" },
+	{ "c:2,", "Subject: \xc3\x9cnicode w\xc3\xb6rds\n\nFOX" },
+};
+
+static void
+search_expect(struct search *s, const char *text, const uint32_t *want,
+	size_t nwant)
+{
+	struct search_query q;
+	uint32_t *res;
+	size_t i, nres;
+
+	if (search_query_parse(&q, text) == -1)
+		errx(1, "search_query_parse: %s", text);
+	if (search_query_run(s, &q, &res, &nres) == -1)
+		err(1, "search_query_run");
+
+	if (nres != nwant)
+		errx(1, "%s: wrong number of results", text);
+	for (i = 0; i < nres; i++) {
+		if (res[i] != want[i])
+			errx(1, "%s: wrong result", text);
+	}
+	free(res);
+}
+
+void
+search_index_test(void)
+{
+	struct search s, s2;
+	struct search_match m;
+	struct search_query q;
+	FILE *fp;
+	size_t i;
+	uint32_t id;
+
+	search_init(&s);
+	search_update_begin(&s);
+	for (i = 0; i < nitems(letters); i++) {
+		if (search_seen(&s, letters[i].name) != 0)
+			errx(1, "new letter already in index");
+		if (search_doc_begin(&s, letters[i].name) == -1)
+			err(1, "search_doc_begin");
+		if (search_doc_text(&s, letters[i].text,
+		    strlen(letters[i].text)) == -1)
+			err(1, "search_doc_text");
+		if (search_doc_end(&s) == -1)
+			err(1, "search_doc_end");
+	}
+	search_update_end(&s);
+
+	search_expect(&s, "hello", (uint32_t []) { 0, 1 }, 2);
+	search_expect(&s, "FOX", (uint32_t []) { 0, 1, 2 }, 3);
+	search_expect(&s, "w\xc3\xb6rds", (uint32_t []) { 2 }, 1);
+	search_expect(&s, "hello nothing", NULL, 0);
+	search_expect(&s, "\"quick brown\"", (uint32_t []) { 0, 1 }, 2);
+
+	if (search_query_parse(&q, "\"quick brown\" hello") == -1)
+		errx(1, "search_query_parse");
+	if (!search_query_phrase(&q))
+		errx(1, "phrase not detected");
+	for (i = 0; i < 2; i++) {
+		search_match_init(&m, &q);
+		search_match_text(&m, letters[i].text, strlen(letters[i].text));
+		if (search_match_end(&m) != (i == 0))
+			errx(1, "wrong phrase match");
+	}
+
+	/* b was removed and a was marked as replied to. */
+	search_update_begin(&s);
+	if (search_seen(&s, "a:2,RS") != 1 || search_seen(&s, "c:2,") != 1)
+		errx(1, "letter missing from index");
+	search_update_end(&s);
+
+	if (search_lookup(&s, "b:2,", &id))
+		errx(1, "removed letter still in index");
+	if (!search_lookup(&s, "a:2,", &id) || id != 0)
+		errx(1, "renamed letter missing from index");
+	search_expect(&s, "hello", (uint32_t []) { 0 }, 1);
+
+	if ((fp = tmpfile()) == NULL)
+		err(1, "tmpfile");
+	if (search_save(&s, fp) == -1)
+		err(1, "search_save");
+	rewind(fp);
+
+	search_init(&s2);
+	if (search_load(&s2, fp) == -1)
+		errx(1, "search_load");
+	if (!search_lookup(&s2, "c:2,", &id) || id != 1)
+		errx(1, "wrong letter id after load");
+	search_expect(&s2, "fox", (uint32_t []) { 0, 1 }, 2);
+	search_expect(&s2, "there", NULL, 0);
+	search_free(&s2);
+
+	/* A truncated index must be rejected. */
+	if (ftruncate(fileno(fp), 20) == -1)
+		err(1, "ftruncate");
+	rewind(fp);
+	search_init(&s2);
+	if (search_load(&s2, fp) != -1)
+		errx(1, "truncated index loaded");
+	search_free(&s2);
+
+	fclose(fp);
+	search_free(&s);
+}
+
+void
+search_query_test(void)
+{
+	const struct {
+		const char *text;
+		int error;
+		size_t nterm;
+		size_t nword; /* of the first term */
+	} tests[] = {
+		{ "hello", 0, 1, 1 },
+		{ "  hello   world ", 0, 2, 1 },
+		{ "\"hello world\" again", 0, 2, 2 },
+		{ "foo-bar", 0, 1, 2 },
+		{ "-- hello", 0, 1, 1 },
+		{ "", -1, 0, 0 },
+		{ "--", -1, 0, 0 },
+		{ "\"unterminated", -1, 0, 0 },
+		{ "\"a b c d e f g h i\"", -1, 0, 0 },
+	};
+	size_t i;
+
+	for (i = 0; i < nitems(tests); i++) {
+		struct search_query q;
+		int error;
+
+		error = search_query_parse(&q, tests[i].text);
+		if (error != tests[i].error)
+			errx(1, "%s: wrong error", tests[i].text);
+		if (error == -1)
+			continue;
+		if (q.nterm != tests[i].nterm)
+			errx(1, "%s: wrong number of terms", tests[i].text);
+		if (q.terms[0].nword != tests[i].nword)
+			errx(1, "%s: wrong number of words", tests[i].text);
+	}
+}
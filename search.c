@@ -0,0 +1,957 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * An inverted index mapping each word of a letter to the letters
+ * containing it.
+ * Letters are identified by the unique part of their maildir file
+ * name, the part before the ':', as maildir letters are never modified
+ * in place and only have their flags changed by renaming them.
+ * Phrases are not indexed: a query for a phrase finds the letters
+ * containing every word of the phrase, which the caller then checks
+ * with search_match_*.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "search.h"
+
+#define SEARCH_MAGIC "mailzsi1"
+
+static size_t doc_key_len(const char *);
+static uint32_t *doc_slot(struct search *, const char *, size_t);
+static int doctab_grow(struct search *, size_t);
+static int get32(FILE *, uint32_t *);
+static int getvar(FILE *, uint32_t *);
+static uint32_t hash(const char *, size_t);
+static int put32(FILE *, uint32_t);
+static int putvar(FILE *, uint32_t);
+static void search_compact(struct search *);
+static int tok_feed(struct search_tok *, int);
+static struct search_word *word_get(struct search *, const char *, size_t,
+	int);
+static int word_post(struct search_word *, uint32_t);
+static uint32_t *word_slot(struct search *, const char *, size_t);
+static int wordtab_grow(struct search *);
+
+static size_t
+doc_key_len(const char *name)
+{
+	return strcspn(name, ":");
+}
+
+static uint32_t *
+doc_slot(struct search *s, const char *name, size_t len)
+{
+	size_t i, mask;
+
+	mask = s->doctabsz - 1;
+	for (i = hash(name, len) & mask;; i = (i + 1) & mask) {
+		const struct search_doc *d;
+
+		if (s->doctab[i] == 0)
+			return &s->doctab[i];
+		d = &s->docs[s->doctab[i] - 1];
+		if (doc_key_len(d->name) == len && !memcmp(d->name, name, len))
+			return &s->doctab[i];
+	}
+}
+
+/*
+ * Make room in the document table for at least want documents.
+ */
+static int
+doctab_grow(struct search *s, size_t want)
+{
+	uint32_t *tab;
+	size_t i, sz;
+
+	if (want < s->doctabsz / 2)
+		return 0;
+
+	sz = s->doctabsz == 0 ? 64 : s->doctabsz;
+	while (want >= sz / 2) {
+		if (sz > SIZE_MAX / 2 / sizeof(*tab)) {
+			errno = ENOMEM;
+			return -1;
+		}
+		sz *= 2;
+	}
+
+	if ((tab = calloc(sz, sizeof(*tab))) == NULL)
+		return -1;
+	free(s->doctab);
+	s->doctab = tab;
+	s->doctabsz = sz;
+
+	for (i = 0; i < s->ndoc; i++) {
+		const char *name;
+
+		name = s->docs[i].name;
+		*doc_slot(s, name, doc_key_len(name)) = i + 1;
+	}
+
+	return 0;
+}
+
+static int
+get32(FILE *fp, uint32_t *v)
+{
+	if (fread(v, sizeof(*v), 1, fp) != 1)
+		return -1;
+	return 0;
+}
+
+static int
+getvar(FILE *fp, uint32_t *v)
+{
+	uint32_t r;
+	int ch, shift;
+
+	r = 0;
+	shift = 0;
+	do {
+		if ((ch = getc(fp)) == EOF || shift > 28)
+			return -1;
+		r |= (uint32_t)(ch & 0x7f) << shift;
+		shift += 7;
+	} while (ch & 0x80);
+
+	*v = r;
+	return 0;
+}
+
+/*
+ * FNV-1a
+ */
+static uint32_t
+hash(const char *s, size_t n)
+{
+	uint32_t h;
+	size_t i;
+
+	h = 2166136261u;
+	for (i = 0; i < n; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static int
+put32(FILE *fp, uint32_t v)
+{
+	if (fwrite(&v, sizeof(v), 1, fp) != 1)
+		return -1;
+	return 0;
+}
+
+static int
+putvar(FILE *fp, uint32_t v)
+{
+	while (v >= 0x80) {
+		if (putc((v & 0x7f) | 0x80, fp) == EOF)
+			return -1;
+		v >>= 7;
+	}
+	if (putc(v, fp) == EOF)
+		return -1;
+	return 0;
+}
+
+/*
+ * Drop the letters removed by search_update_end, renumbering the
+ * remaining letters.
+ */
+static void
+search_compact(struct search *s)
+{
+	uint32_t *map;
+	size_t i, j, n;
+
+	if (s->ndead == 0)
+		return;
+
+	if ((map = reallocarray(NULL, s->ndoc, sizeof(*map))) == NULL) {
+		/* the index is still correct, just larger */
+		return;
+	}
+
+	for (i = 0, n = 0; i < s->ndoc; i++) {
+		if (!s->docs[i].live) {
+			free(s->docs[i].name);
+			map[i] = UINT32_MAX;
+			continue;
+		}
+		map[i] = n;
+		s->docs[n++] = s->docs[i];
+	}
+	s->ndoc = n;
+	s->ndead = 0;
+
+	for (i = 0; i < s->nword; i++) {
+		struct search_word *w;
+
+		w = &s->words[i];
+		for (j = 0, n = 0; j < w->npost; j++) {
+			if (map[w->post[j]] != UINT32_MAX)
+				w->post[n++] = map[w->post[j]];
+		}
+		w->npost = n;
+	}
+	free(map);
+
+	memset(s->doctab, 0, s->doctabsz * sizeof(*s->doctab));
+	for (i = 0; i < s->ndoc; i++) {
+		const char *name;
+
+		name = s->docs[i].name;
+		*doc_slot(s, name, doc_key_len(name)) = i + 1;
+	}
+}
+
+/*
+ * Start indexing the letter named name, which must not already be
+ * in the index.
+ * Its text is then given with search_doc_text, and search_doc_end
+ * is called once all of it has been given.
+ * Returns 0 on success, returns -1 and sets errno on failure.
+ */
+int
+search_doc_begin(struct search *s, const char *name)
+{
+	struct search_doc *d;
+	uint32_t *slot;
+
+	if (s->ndoc >= UINT32_MAX - 1) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	if (s->ndoc == s->docsz) {
+		size_t sz;
+
+		sz = s->docsz == 0 ? 64 : s->docsz * 2;
+		d = reallocarray(s->docs, sz, sizeof(*s->docs));
+		if (d == NULL)
+			return -1;
+		s->docs = d;
+		s->docsz = sz;
+	}
+
+	if (doctab_grow(s, s->ndoc + 1) == -1)
+		return -1;
+
+	d = &s->docs[s->ndoc];
+	if ((d->name = strdup(name)) == NULL)
+		return -1;
+	d->live = 1;
+	d->seen = 1;
+
+	slot = doc_slot(s, name, doc_key_len(name));
+	*slot = ++s->ndoc;
+
+	s->doc = s->ndoc - 1;
+	memset(&s->tok, 0, sizeof(s->tok));
+	s->dirty = 1;
+	return 0;
+}
+
+/*
+ * Finish indexing the letter started by search_doc_begin.
+ * Returns 0 on success, returns -1 and sets errno on failure.
+ */
+int
+search_doc_end(struct search *s)
+{
+	return search_doc_text(s, " ", 1);
+}
+
+/*
+ * Add n bytes of text to the letter started by search_doc_begin.
+ * Returns 0 on success, returns -1 and sets errno on failure.
+ */
+int
+search_doc_text(struct search *s, const char *buf, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		struct search_word *w;
+
+		if (!tok_feed(&s->tok, (unsigned char)buf[i]))
+			continue;
+
+		w = word_get(s, s->tok.word, strlen(s->tok.word), 1);
+		if (w == NULL)
+			return -1;
+		if (word_post(w, s->doc) == -1)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Frees the memory associated with s.
+ */
+void
+search_free(struct search *s)
+{
+	size_t i;
+
+	for (i = 0; i < s->ndoc; i++)
+		free(s->docs[i].name);
+	free(s->docs);
+	free(s->doctab);
+
+	for (i = 0; i < s->nword; i++) {
+		free(s->words[i].word);
+		free(s->words[i].post);
+	}
+	free(s->words);
+	free(s->wordtab);
+}
+
+/*
+ * Initializes an empty index.
+ */
+void
+search_init(struct search *s)
+{
+	memset(s, 0, sizeof(*s));
+}
+
+/*
+ * Read an index written by search_save into the empty index s.
+ * Returns 0 on success, returns -1 if the index could not be read or
+ * is malformed, in which case s must still be freed with search_free.
+ */
+int
+search_load(struct search *s, FILE *fp)
+{
+	uint32_t i, j, ndoc, nword;
+	char magic[sizeof(SEARCH_MAGIC) - 1];
+
+	if (fread(magic, sizeof(magic), 1, fp) != 1)
+		return -1;
+	if (memcmp(magic, SEARCH_MAGIC, sizeof(magic)) != 0)
+		return -1;
+
+	if (get32(fp, &ndoc) == -1)
+		return -1;
+	for (i = 0; i < ndoc; i++) {
+		char *name;
+		uint32_t len;
+		uint32_t id;
+
+		if (getvar(fp, &len) == -1 || len == 0 || len > 4096)
+			return -1;
+		if ((name = malloc(len + 1)) == NULL)
+			return -1;
+		if (fread(name, len, 1, fp) != 1 || memchr(name, '\0', len)) {
+			free(name);
+			return -1;
+		}
+		name[len] = '\0';
+
+		if (search_lookup(s, name, &id) || search_doc_begin(s, name) == -1) {
+			free(name);
+			return -1;
+		}
+		free(name);
+	}
+
+	if (get32(fp, &nword) == -1)
+		return -1;
+	for (i = 0; i < nword; i++) {
+		struct search_word *w;
+		uint32_t doc, len, npost;
+		char word[SEARCH_WORD_MAX];
+
+		if (getvar(fp, &len) == -1 || len == 0 || len > sizeof(word))
+			return -1;
+		if (fread(word, len, 1, fp) != 1)
+			return -1;
+		if (word_get(s, word, len, 0) != NULL)
+			return -1;
+		if ((w = word_get(s, word, len, 1)) == NULL)
+			return -1;
+
+		if (getvar(fp, &npost) == -1 || npost == 0 || npost > ndoc)
+			return -1;
+		w->post = reallocarray(NULL, npost, sizeof(*w->post));
+		if (w->post == NULL)
+			return -1;
+		w->postsz = npost;
+
+		doc = 0;
+		for (j = 0; j < npost; j++) {
+			uint32_t delta;
+
+			if (getvar(fp, &delta) == -1)
+				return -1;
+			if (j != 0 && delta == 0)
+				return -1;
+			if (delta >= ndoc - doc)
+				return -1;
+			doc += delta;
+			w->post[w->npost++] = doc;
+		}
+	}
+
+	if (getc(fp) != EOF || ferror(fp))
+		return -1;
+
+	s->dirty = 0;
+	return 0;
+}
+
+/*
+ * Find the letter with the same unique name as name.
+ * Returns 1 and sets *id if it is in the index, otherwise returns 0.
+ */
+int
+search_lookup(struct search *s, const char *name, uint32_t *id)
+{
+	uint32_t slot;
+
+	if (s->doctabsz == 0)
+		return 0;
+	if ((slot = *doc_slot(s, name, doc_key_len(name))) == 0)
+		return 0;
+	if (!s->docs[slot - 1].live)
+		return 0;
+	*id = slot - 1;
+	return 1;
+}
+
+/*
+ * Finish matching the text given to search_match_text.
+ * Returns 1 if every term of the query was found in the text,
+ * otherwise returns 0.
+ */
+int
+search_match_end(struct search_match *m)
+{
+	search_match_text(m, " ", 1);
+
+	return m->found == (1u << m->query->nterm) - 1;
+}
+
+/*
+ * Initializes m to check text against the terms of query, including
+ * the order of the words of each phrase.
+ */
+void
+search_match_init(struct search_match *m, const struct search_query *query)
+{
+	memset(m, 0, sizeof(*m));
+	m->query = query;
+}
+
+void
+search_match_text(struct search_match *m, const char *buf, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		size_t t;
+
+		if (!tok_feed(&m->tok, (unsigned char)buf[i]))
+			continue;
+
+		memcpy(m->ring[m->nseen % SEARCH_PHRASE_MAX], m->tok.word,
+		    sizeof(m->tok.word));
+		m->nseen++;
+
+		for (t = 0; t < m->query->nterm; t++) {
+			const struct search_term *term;
+			size_t k, start;
+
+			if (m->found & (1u << t))
+				continue;
+
+			term = &m->query->terms[t];
+			if (m->nseen < term->nword)
+				continue;
+
+			start = m->nseen - term->nword;
+			for (k = 0; k < term->nword; k++) {
+				if (strcmp(m->ring[(start + k) % SEARCH_PHRASE_MAX],
+				    term->words[k]) != 0)
+					break;
+			}
+			if (k == term->nword)
+				m->found |= 1u << t;
+		}
+	}
+}
+
+/*
+ * Parse a query made of words and double quoted phrases, every one
+ * of which must be found in a letter for it to match.
+ * Text is split into words the same way as letters, so an unquoted
+ * argument such as "foo-bar" is treated as the phrase "foo bar".
+ * Returns 0 on success and -1 if the query is empty, has an
+ * unterminated quote, or has too many terms or words.
+ */
+int
+search_query_parse(struct search_query *q, const char *text)
+{
+	const char *end, *p;
+
+	q->nterm = 0;
+	for (p = text;;) {
+		struct search_term *term;
+		struct search_tok tok;
+		int quoted;
+
+		p += strspn(p, " \t");
+		if (*p == '\0')
+			break;
+
+		if ((quoted = (*p == '"'))) {
+			p++;
+			if ((end = strchr(p, '"')) == NULL)
+				return -1;
+		}
+		else
+			end = p + strcspn(p, " \t");
+
+		if (q->nterm == SEARCH_TERM_MAX)
+			return -1;
+		term = &q->terms[q->nterm];
+		term->nword = 0;
+
+		memset(&tok, 0, sizeof(tok));
+		for (; p <= end; p++) {
+			if (!tok_feed(&tok, p == end ? ' ' : (unsigned char)*p))
+				continue;
+			if (term->nword == SEARCH_PHRASE_MAX)
+				return -1;
+			memcpy(term->words[term->nword++], tok.word,
+			    sizeof(tok.word));
+		}
+
+		if (term->nword != 0)
+			q->nterm++;
+
+		p = end;
+		if (quoted)
+			p++;
+	}
+
+	if (q->nterm == 0)
+		return -1;
+	return 0;
+}
+
+/*
+ * Returns 1 if the letters found by search_query_run for q must be
+ * checked with search_match_*, as q contains a phrase.
+ */
+int
+search_query_phrase(const struct search_query *q)
+{
+	size_t i;
+
+	for (i = 0; i < q->nterm; i++) {
+		if (q->terms[i].nword > 1)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Find the letters containing every word of q.
+ * On success returns 0 and sets *res to an array of *nres ascending
+ * letter ids, which must be freed.
+ * Returns -1 and sets errno on failure.
+ */
+int
+search_query_run(struct search *s, const struct search_query *q,
+	uint32_t **res, size_t *nres)
+{
+	const struct search_word *lists[SEARCH_TERM_MAX * SEARCH_PHRASE_MAX];
+	uint32_t *docs;
+	size_t i, j, n, nlist;
+
+	*res = NULL;
+	*nres = 0;
+
+	nlist = 0;
+	for (i = 0; i < q->nterm; i++) {
+		for (j = 0; j < q->terms[i].nword; j++) {
+			const struct search_word *w;
+			const char *word;
+
+			word = q->terms[i].words[j];
+			w = word_get(s, word, strlen(word), 0);
+			if (w == NULL || w->npost == 0)
+				return 0;
+			lists[nlist++] = w;
+		}
+	}
+
+	/* Intersect the shortest lists first. */
+	for (i = 1; i < nlist; i++) {
+		const struct search_word *w;
+
+		w = lists[i];
+		for (j = i; j > 0 && lists[j - 1]->npost > w->npost; j--)
+			lists[j] = lists[j - 1];
+		lists[j] = w;
+	}
+
+	docs = reallocarray(NULL, lists[0]->npost, sizeof(*docs));
+	if (docs == NULL)
+		return -1;
+
+	for (i = 0, n = 0; i < lists[0]->npost; i++) {
+		if (s->docs[lists[0]->post[i]].live)
+			docs[n++] = lists[0]->post[i];
+	}
+
+	for (i = 1; i < nlist && n != 0; i++) {
+		const uint32_t *post;
+		size_t k, m, npost;
+
+		post = lists[i]->post;
+		npost = lists[i]->npost;
+		for (j = 0, k = 0, m = 0; j < n && k < npost;) {
+			if (docs[j] < post[k])
+				j++;
+			else if (docs[j] > post[k])
+				k++;
+			else {
+				docs[m++] = docs[j];
+				j++;
+				k++;
+			}
+		}
+		n = m;
+	}
+
+	if (n == 0) {
+		free(docs);
+		return 0;
+	}
+
+	*res = docs;
+	*nres = n;
+	return 0;
+}
+
+/*
+ * Write s to fp, dropping letters removed by search_update_end.
+ * Returns 0 on success and -1 on failure.
+ */
+int
+search_save(struct search *s, FILE *fp)
+{
+	size_t i, j, nword;
+
+	search_compact(s);
+
+	if (fwrite(SEARCH_MAGIC, sizeof(SEARCH_MAGIC) - 1, 1, fp) != 1)
+		return -1;
+
+	if (put32(fp, s->ndoc) == -1)
+		return -1;
+	for (i = 0; i < s->ndoc; i++) {
+		size_t len;
+
+		len = strlen(s->docs[i].name);
+		if (putvar(fp, len) == -1)
+			return -1;
+		if (fwrite(s->docs[i].name, len, 1, fp) != 1)
+			return -1;
+	}
+
+	for (i = 0, nword = 0; i < s->nword; i++) {
+		if (s->words[i].npost != 0)
+			nword++;
+	}
+	if (put32(fp, nword) == -1)
+		return -1;
+
+	for (i = 0; i < s->nword; i++) {
+		const struct search_word *w;
+		size_t len;
+		uint32_t prev;
+
+		w = &s->words[i];
+		if (w->npost == 0)
+			continue;
+
+		len = strlen(w->word);
+		if (putvar(fp, len) == -1)
+			return -1;
+		if (fwrite(w->word, len, 1, fp) != 1)
+			return -1;
+
+		if (putvar(fp, w->npost) == -1)
+			return -1;
+		prev = 0;
+		for (j = 0; j < w->npost; j++) {
+			if (putvar(fp, w->post[j] - prev) == -1)
+				return -1;
+			prev = w->post[j];
+		}
+	}
+
+	if (fflush(fp) == EOF)
+		return -1;
+
+	s->dirty = 0;
+	return 0;
+}
+
+/*
+ * Mark the letter named name as still present in the maildir,
+ * updating the name it is stored under if its flags changed.
+ * Returns 1 if the letter is in the index and 0 if it must be added
+ * with search_doc_begin.
+ * Returns -1 and sets errno on failure.
+ */
+int
+search_seen(struct search *s, const char *name)
+{
+	struct search_doc *d;
+	uint32_t slot;
+
+	if (s->doctabsz == 0)
+		return 0;
+	if ((slot = *doc_slot(s, name, doc_key_len(name))) == 0)
+		return 0;
+
+	d = &s->docs[slot - 1];
+	if (strcmp(d->name, name) != 0) {
+		char *copy;
+
+		if ((copy = strdup(name)) == NULL)
+			return -1;
+		free(d->name);
+		d->name = copy;
+		s->dirty = 1;
+	}
+	if (!d->live) {
+		d->live = 1;
+		s->ndead--;
+		s->dirty = 1;
+	}
+	d->seen = 1;
+
+	return 1;
+}
+
+/*
+ * Start checking which letters are still in the maildir.
+ * Every letter present must then be given to search_seen, or added
+ * with search_doc_begin, before calling search_update_end.
+ */
+void
+search_update_begin(struct search *s)
+{
+	size_t i;
+
+	for (i = 0; i < s->ndoc; i++)
+		s->docs[i].seen = 0;
+}
+
+/*
+ * Remove the letters which were not seen since search_update_begin.
+ */
+void
+search_update_end(struct search *s)
+{
+	size_t i;
+
+	for (i = 0; i < s->ndoc; i++) {
+		if (s->docs[i].live && !s->docs[i].seen) {
+			s->docs[i].live = 0;
+			s->ndead++;
+			s->dirty = 1;
+		}
+	}
+}
+
+/*
+ * Feed one byte of text to tok.
+ * Words are runs of ASCII letters and digits and of non-ASCII bytes,
+ * with ASCII letters folded to lower case.
+ * Returns 1 when the byte ends a word, which is then in tok->word
+ * until the next call.
+ */
+static int
+tok_feed(struct search_tok *tok, int ch)
+{
+	int done;
+
+	if (ch >= 0x80 || isalnum(ch)) {
+		if (tok->len == SEARCH_WORD_MAX) {
+			tok->overlong = 1;
+			return 0;
+		}
+		if (ch >= 'A' && ch <= 'Z')
+			ch += 'a' - 'A';
+		tok->word[tok->len++] = ch;
+		return 0;
+	}
+
+	if (tok->len == 0)
+		return 0;
+
+	tok->word[tok->len] = '\0';
+	done = !tok->overlong;
+	tok->len = 0;
+	tok->overlong = 0;
+	return done;
+}
+
+/*
+ * Find the word of length len, adding it if create is set.
+ * Returns NULL if the word was not found or could not be added.
+ */
+static struct search_word *
+word_get(struct search *s, const char *word, size_t len, int create)
+{
+	struct search_word *w;
+	uint32_t *slot;
+
+	if (s->wordtabsz != 0) {
+		slot = word_slot(s, word, len);
+		if (*slot != 0)
+			return &s->words[*slot - 1];
+	}
+
+	if (!create)
+		return NULL;
+
+	if (s->nword >= UINT32_MAX - 1) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	if (s->nword == s->wordsz) {
+		size_t sz;
+
+		sz = s->wordsz == 0 ? 1024 : s->wordsz * 2;
+		w = reallocarray(s->words, sz, sizeof(*s->words));
+		if (w == NULL)
+			return NULL;
+		s->words = w;
+		s->wordsz = sz;
+	}
+
+	if (wordtab_grow(s) == -1)
+		return NULL;
+
+	w = &s->words[s->nword];
+	if ((w->word = malloc(len + 1)) == NULL)
+		return NULL;
+	memcpy(w->word, word, len);
+	w->word[len] = '\0';
+	w->post = NULL;
+	w->npost = 0;
+	w->postsz = 0;
+
+	*word_slot(s, word, len) = ++s->nword;
+	return w;
+}
+
+/*
+ * Record that the letter doc contains w.
+ * Letters are added in ascending order, so the list stays sorted.
+ */
+static int
+word_post(struct search_word *w, uint32_t doc)
+{
+	if (w->npost != 0 && w->post[w->npost - 1] == doc)
+		return 0;
+
+	if (w->npost == w->postsz) {
+		uint32_t *post;
+		size_t sz;
+
+		sz = w->postsz == 0 ? 4 : w->postsz * 2;
+		if ((post = reallocarray(w->post, sz, sizeof(*post))) == NULL)
+			return -1;
+		w->post = post;
+		w->postsz = sz;
+	}
+
+	w->post[w->npost++] = doc;
+	return 0;
+}
+
+static uint32_t *
+word_slot(struct search *s, const char *word, size_t len)
+{
+	size_t i, mask;
+
+	mask = s->wordtabsz - 1;
+	for (i = hash(word, len) & mask;; i = (i + 1) & mask) {
+		const struct search_word *w;
+
+		if (s->wordtab[i] == 0)
+			return &s->wordtab[i];
+		w = &s->words[s->wordtab[i] - 1];
+		if (!strncmp(w->word, word, len) && w->word[len] == '\0')
+			return &s->wordtab[i];
+	}
+}
+
+/*
+ * Make room in the word table for one more word.
+ */
+static int
+wordtab_grow(struct search *s)
+{
+	uint32_t *tab;
+	size_t i, sz;
+
+	if (s->nword + 1 < s->wordtabsz / 2)
+		return 0;
+
+	sz = s->wordtabsz == 0 ? 2048 : s->wordtabsz;
+	if (sz > SIZE_MAX / 2 / sizeof(*tab)) {
+		errno = ENOMEM;
+		return -1;
+	}
+	sz *= 2;
+
+	if ((tab = calloc(sz, sizeof(*tab))) == NULL)
+		return -1;
+	free(s->wordtab);
+	s->wordtab = tab;
+	s->wordtabsz = sz;
+
+	for (i = 0; i < s->nword; i++) {
+		const char *word;
+
+		word = s->words[i].word;
+		*word_slot(s, word, strlen(word)) = i + 1;
+	}
+
+	return 0;
+}
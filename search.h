@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+/* Longest indexed word, words longer than this are not indexed. */
+#define SEARCH_WORD_MAX 64
+/* Most words in a single phrase of a query. */
+#define SEARCH_PHRASE_MAX 8
+/* Most terms in a query. */
+#define SEARCH_TERM_MAX 16
+
+struct search_doc {
+	char *name;
+	int live;
+	int seen;
+};
+
+struct search_word {
+	char *word;
+	uint32_t *post;
+	size_t npost;
+	size_t postsz;
+};
+
+struct search_tok {
+	char word[SEARCH_WORD_MAX + 1];
+	size_t len;
+	int overlong;
+};
+
+struct search {
+	struct search_doc *docs;
+	size_t ndoc;
+	size_t docsz;
+	size_t ndead;
+	uint32_t *doctab;
+	size_t doctabsz;
+	struct search_word *words;
+	size_t nword;
+	size_t wordsz;
+	uint32_t *wordtab;
+	size_t wordtabsz;
+	struct search_tok tok;
+	uint32_t doc;
+	int dirty;
+};
+
+struct search_term {
+	char words[SEARCH_PHRASE_MAX][SEARCH_WORD_MAX + 1];
+	size_t nword;
+};
+
+struct search_query {
+	struct search_term terms[SEARCH_TERM_MAX];
+	size_t nterm;
+};
+
+struct search_match {
+	const struct search_query *query;
+	struct search_tok tok;
+	char ring[SEARCH_PHRASE_MAX][SEARCH_WORD_MAX + 1];
+	size_t nseen;
+	unsigned int found;
+};
+
+int search_doc_begin(struct search *, const char *);
+int search_doc_end(struct search *);
+int search_doc_text(struct search *, const char *, size_t);
+void search_free(struct search *);
+void search_init(struct search *);
+int search_load(struct search *, FILE *);
+int search_lookup(struct search *, const char *, uint32_t *);
+int search_save(struct search *, FILE *);
+int search_seen(struct search *, const char *);
+void search_update_begin(struct search *);
+void search_update_end(struct search *);
+
+int search_match_end(struct search_match *);
+void search_match_init(struct search_match *, const struct search_query *);
+void search_match_text(struct search_match *, const char *, size_t);
+
+int search_query_parse(struct search_query *, const char *);
+int search_query_phrase(const struct search_query *);
+int search_query_run(struct search *, const struct search_query *,
+	uint32_t **, size_t *);
+
+#endif /* SEARCH_H */
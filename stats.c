@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Time spent in each phase of reading the mailboxes and counts of
+ * the work done, reported by mailz -v.
+ * Spans are measured with the monotonic clock, and only if enabled.
+ */
+
+#include <sys/time.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+static const char *phases[STATS_NPHASE] = {
+	[STATS_SETUP]	= "setup",
+	[STATS_SPAWN]	= "spawn",
+	[STATS_OPEN]	= "open",
+	[STATS_WAIT]	= "wait",
+	[STATS_PARSE]	= "parse",
+	[STATS_SORT]	= "sort",
+};
+
+static const char *counters[STATS_NCOUNTER] = {
+	[STATS_LETTERS]	= "letters",
+	[STATS_BYTES]	= "bytes",
+	[STATS_FDS]	= "fds",
+	[STATS_PROCS]	= "processes",
+};
+
+void
+stats_add(struct stats *stats, enum stats_counter counter, uint64_t n)
+{
+	stats->count[counter] += n;
+}
+
+/*
+ * Start a span, ended by stats_end.
+ */
+void
+stats_begin(const struct stats *stats, struct timespec *ts)
+{
+	if (stats->enabled)
+		clock_gettime(CLOCK_MONOTONIC, ts);
+}
+
+/*
+ * Add the time since the span ts was begun to phase.
+ */
+void
+stats_end(struct stats *stats, enum stats_phase phase,
+	const struct timespec *ts)
+{
+	struct timespec now, diff;
+
+	if (!stats->enabled)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	timespecsub(&now, ts, &diff);
+	stats->ns[phase] += (uint64_t)diff.tv_sec * 1000000000 + diff.tv_nsec;
+}
+
+void
+stats_init(struct stats *stats, int enabled)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->enabled = enabled;
+}
+
+/*
+ * Add time measured elsewhere, such as by mailz-content, to phase.
+ */
+void
+stats_ns(struct stats *stats, enum stats_phase phase, uint64_t ns)
+{
+	stats->ns[phase] += ns;
+}
+
+int
+stats_print(const struct stats *stats, FILE *fp)
+{
+	size_t i;
+
+	for (i = 0; i < STATS_NPHASE; i++) {
+		if (fprintf(fp, "%-10s %10llu.%03llu ms\n", phases[i],
+		    (unsigned long long)(stats->ns[i] / 1000000),
+		    (unsigned long long)(stats->ns[i] / 1000 % 1000)) < 0)
+			return -1;
+	}
+	for (i = 0; i < STATS_NCOUNTER; i++) {
+		if (fprintf(fp, "%-10s %14llu\n", counters[i],
+		    (unsigned long long)stats->count[i]) < 0)
+			return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2026 Henry Ford <fordhenry2299@gmail.com>
+
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+enum stats_phase {
+	STATS_SETUP,
+	STATS_SPAWN,
+	STATS_OPEN,
+	STATS_WAIT,
+	STATS_PARSE,
+	STATS_SORT,
+	STATS_NPHASE
+};
+
+enum stats_counter {
+	STATS_LETTERS,
+	STATS_BYTES,
+	STATS_FDS,
+	STATS_PROCS,
+	STATS_NCOUNTER
+};
+
+struct stats {
+	uint64_t ns[STATS_NPHASE];
+	uint64_t count[STATS_NCOUNTER];
+	int enabled;
+};
+
+void stats_add(struct stats *, enum stats_counter, uint64_t);
+void stats_begin(const struct stats *, struct timespec *);
+void stats_end(struct stats *, enum stats_phase, const struct timespec *);
+void stats_init(struct stats *, int);
+void stats_ns(struct stats *, enum stats_phase, uint64_t);
+int stats_print(const struct stats *, FILE *);
+
+#endif /* STATS_H */